@@ -1,11 +1,17 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <istream>
 #include <ostream>
 #include <string>
 #include <string_view>
 #include <span>
+#include <typeindex>
+#include <array>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <set>
 #include <vector>
 #include <optional>
@@ -147,48 +153,159 @@ namespace apcf {
 	class KeySpan : public std::span<const char> {
 	private:
 		friend Key;
+		friend ConfigHierarchy;
 		size_t depth_;
 
+		KeySpan(const char* data, size_t size, size_t depth);
+
 	public:
 		KeySpan();
 		explicit KeySpan(const Key&);
 		KeySpan(const Key&, size_t end);
 		KeySpan(const char* data, size_t size);
 
+		/** Returns the number of segments of the span, in O(1). */
+		size_t getDepth() const noexcept { return depth_; }
+
 		bool operator<(KeySpan r) const noexcept;
 		bool operator==(KeySpan r) const noexcept;
 	};
 
 	class Key : public std::string {
 		friend KeySpan;
+		friend TrieConfig;
+		friend ConfigBuilder;
+
+	public:
+		using separator_offset_t = uint32_t;
+
+		/** How many separator offsets are stored within the key itself;
+		 * the others are found again when needed, by scanning the key
+		 * from the last stored one. */
+		static constexpr size_t inlineSeparatorCount = 5;
+
+	private:
+		/* Offsets of the first separators within the key, computed upon
+		 * construction; the mutators of the std::string base are hidden
+		 * below, so that these cannot become stale. */
+		separator_offset_t separatorCount_ = 0;
+		std::array<separator_offset_t, inlineSeparatorCount> separators_ = { };
+
+		void indexSeparators_();
+		size_t separator_(size_t index) const noexcept;
+
+		/* Appends a segment, or truncates the key to the given depth,
+		 * without validating the result. */
+		void pushSegment_(std::string_view);
+		void truncate_(size_t depth);
+
+		/* Constructs a key without validating it, for callers that
+		 * guarantee its validity; only asserted in debug builds. */
+		struct Trusted_ { };
+		Key(Trusted_, std::string);
 
 	public:
 		Key(): std::string() { }
 		Key(std::string);
 		Key(std::initializer_list<const char*>);
 		explicit Key(const KeySpan&);
+
+		/** Joins a group name and a key relative to it, with an implicit
+		 * separator; neither of them is validated again. */
+		Key(const Key& group, const Key& relKey);
 		Key(const char* cStr): Key(std::string(cStr)) { }
 		Key(const char* str, size_t len): Key(std::string(str, len)) { }
 
-		Key(const Key&) = default;
-		Key(Key&&) = default;
+		Key(const Key&);
+		Key(Key&&) noexcept;
+		~Key();
 
-		Key& operator=(const Key&) = default;
-		Key& operator=(Key&&) = default;
+		Key& operator=(const Key&);
+		Key& operator=(Key&&) noexcept;
 		Key& operator=(const std::string&) = delete;
 		Key& operator=(std::string&&) = delete;
 
+		/** Keys are immutable: the mutators of the std::string base are
+		 * hidden, and its accessors only give const access. */
+		template<typename... Args> Key& append(Args&&...) = delete;
+		template<typename... Args> Key& assign(Args&&...) = delete;
+		template<typename... Args> Key& insert(Args&&...) = delete;
+		template<typename... Args> Key& erase(Args&&...) = delete;
+		template<typename... Args> Key& replace(Args&&...) = delete;
+		template<typename... Args> void resize(Args&&...) = delete;
+		template<typename T> Key& operator+=(T&&) = delete;
+		void push_back(char) = delete;
+		void pop_back() = delete;
+		void clear() = delete;
+		void swap(std::string&) = delete;
+
+		const char& operator[](size_t index) const noexcept { return std::string::operator[](index); }
+		const char& at(size_t index) const { return std::string::at(index); }
+		const char& front() const noexcept { return std::string::front(); }
+		const char& back() const noexcept { return std::string::back(); }
+		const char* data() const noexcept { return std::string::data(); }
+		const_iterator begin() const noexcept { return std::string::begin(); }
+		const_iterator end() const noexcept { return std::string::end(); }
+		const_reverse_iterator rbegin() const noexcept { return std::string::rbegin(); }
+		const_reverse_iterator rend() const noexcept { return std::string::rend(); }
+
+		/** Returns a copy of the key, without the last `offset` segments;
+		 * `ancestor(0)` is the key itself, and the ancestor of a
+		 * top-level key is the empty key. */
 		Key ancestor(size_t offset) const;
 		Key parent() const { return ancestor(1); };
 
-		size_t getDepth() const;
+		/** Returns the number of segments of the key, in O(1). */
+		size_t getDepth() const noexcept { return size_t(separatorCount_) + 1; }
 
 		std::string basename() const;
 
+		/** Returns a view of the segments in the range `[first, last)`;
+		 * this takes O(1) time, unless either bound lies deeper than
+		 * `inlineSeparatorCount` segments. */
+		KeySpan segments(size_t first, size_t last) const;
+
+		/** Non-allocating equivalent of `ancestor(offset)`. */
+		KeySpan ancestorSpan(size_t offset) const;
+		KeySpan parentSpan() const { return ancestorSpan(1); }
+
+		/** Non-allocating equivalent of `basename()`. */
+		KeySpan basenameSpan() const;
+
 		const std::string& asString() const { return *this; }
 	};
 
 
+	/** A list of keys, sorted once upon construction, so that they can be
+	 * looked up together in a single ordered pass (see `Config::getBatch`);
+	 * the results are reported in the original order of the keys. */
+	class KeyBatch {
+	private:
+		std::vector<Key> keys_;
+		std::vector<size_t> positions_;
+
+	public:
+		KeyBatch();
+		KeyBatch(std::span<const Key>);
+		KeyBatch(std::initializer_list<Key> keys): KeyBatch(std::span<const Key>(keys.begin(), keys.size())) { }
+
+		KeyBatch(const KeyBatch&);
+		KeyBatch(KeyBatch&&) noexcept;
+		~KeyBatch();
+
+		KeyBatch& operator=(const KeyBatch&);
+		KeyBatch& operator=(KeyBatch&&) noexcept;
+
+		size_t size() const noexcept { return keys_.size(); }
+
+		/** Returns the keys, in sorted order. */
+		std::span<const Key> sortedKeys() const noexcept { return keys_; }
+
+		/** Returns the original position of the i-th sorted key. */
+		size_t positionOf(size_t sortedIndex) const noexcept { return positions_[sortedIndex]; }
+	};
+
+
 	struct SerializationRules {
 		enum FlagBits : unsigned {
 			eNull              = 0b0000000,
@@ -283,7 +400,7 @@ namespace apcf {
 		static RawData moveString(char* valuesPtr, size_t n);
 
 		RawData(const RawData&);  RawData& operator=(const RawData&);
-		RawData(RawData&&);  RawData& operator=(RawData&&);
+		RawData(RawData&&) noexcept;  RawData& operator=(RawData&&) noexcept;
 
 		~RawData();
 
@@ -312,9 +429,131 @@ namespace apcf {
 
 	class Config {
 	private:
-		std::map<Key, RawData> data_;
+		friend FlatConfig;
+		friend ConfigView;
+		friend ConcurrentConfig;
+		friend IncrementalConfig;
+		friend ConfigBuilder;
+		friend ConfigDiff diff(const Config&, const Config&, const Key&);
+		friend QueryColumn<const RawData*> query(const Config&, const KeyPattern&);
+
+		/* Map nodes never move, so the index can refer to their keys and values directly. */
+		using Index = std::unordered_map<std::string_view, RawData*>;
+
+		/* The comparator is transparent, so that entries can be looked up
+		 * by composite keys without joining them first. */
+		std::map<Key, RawData, std::less<>> data_;
+		std::optional<Index> index_;
+
+		/* Incremented whenever entries are added or removed, which is when
+		 * handles need to look their keys up again: assigning a value to an
+		 * existing entry does not move it. */
+		uint64_t nodeGeneration_ = 0;
+
+		/* Incremented by every modification of the entries. */
+		uint64_t generation_ = 0;
+
+		struct Subscriptions_;
+		struct Generations_;
+		struct Fallbacks_;
+		struct ChangeLog_;
+
+		/* Only allocated once something subscribes or is memoized, so
+		 * that unobserved Configs only test pointers when modified. */
+		std::unique_ptr<Subscriptions_> subscriptions_;
+		mutable std::unique_ptr<Generations_> generations_;
+		std::unique_ptr<Fallbacks_> fallbacks_;
+
+		std::map<Key, RawData, std::less<>>::const_iterator groupBegin_(const Key& group) const;
+		std::map<Key, RawData, std::less<>>::const_iterator groupEnd_(const Key& group) const;
+		const RawData* findInGroup_(const Key& group, const Key& relKey) const;
+		const RawData* findDefinedInGroup_(const Key& group, const Key& relKey) const noexcept;
+
+		/* Adds a newly inserted entry to the index, if there is one. */
+		void indexEntry_(std::map<Key, RawData, std::less<>>::iterator);
+
+		/* Removes an entry that is about to be erased or extracted from
+		 * the index, if there is one. */
+		void unindexEntry_(std::map<Key, RawData, std::less<>>::const_iterator);
+
+		bool isObserved_() const noexcept;
+
+		/* Empties a Config whose nodes were moved out, for handles and
+		 * memos to not refer to them anymore; nothing is notified. */
+		void clearMovedOut_() noexcept;
+
+		/* Looks the key up through the fallback table, which is rebuilt
+		 * first if the entries changed since it was last built. */
+		const RawData* getWithFallbacks_(std::string_view key) const;
+
+		/* Invokes the callbacks subscribed to the given keys, which must
+		 * be sorted and unique, and to the keys that fall back to them. */
+		void notify_(const std::vector<Key>& changedKeys) const;
+
+		/* Adds the undefined keys whose values are resolved through the
+		 * given ones by fallbacks, recursively; the result is sorted. */
+		std::vector<Key> withFallbackDependents_(const std::vector<Key>& changedKeys) const;
+
+		/* Returns the memoized value of the given type, if it was built
+		 * since the subtree last changed; `generationDst` is set to the
+		 * generation of the subtree. */
+		std::shared_ptr<const void> findMemo_(const Key& prefix, std::type_index, uint64_t* generationDst) const;
+		void storeMemo_(const Key& prefix, std::type_index, uint64_t generation, std::shared_ptr<const void>) const;
 
 	public:
+		using SubscriptionId = uint64_t;
+
+		/** Receives the changed keys under the subscribed prefix, sorted,
+		 * including the keys of removed entries. */
+		using ChangeCallback = std::function<void (const Config&, std::span<const Key> changedKeys)>;
+
+		/** A key that has been looked up once: its value can then be read
+		 * in O(1), as a pointer into the entry.
+		 * The key is looked up again, transparently, after entries have
+		 * been added to or removed from the Config; handles must not
+		 * outlive the Config they were resolved by. */
+		class Handle {
+		private:
+			friend Config;
+			const Config* cfg_;
+			Key key_;
+			mutable const RawData* value_;
+			mutable uint64_t generation_;
+
+			Handle(const Config&, Key);
+
+			void refresh_() const;
+			std::optional<const RawData*> found_() const;
+
+		public:
+			Handle(const Handle&);
+			Handle(Handle&&) noexcept;
+			~Handle();
+
+			Handle& operator=(const Handle&);
+			Handle& operator=(Handle&&) noexcept;
+
+			const Key& key() const noexcept { return key_; }
+
+			/** Returns the current value of the entry, or `nullptr`; looking
+			 * the key up again may build the fallback table, which allocates. */
+			const RawData* get() const {
+				if(generation_ != cfg_->nodeGeneration_) refresh_();
+				return value_;
+			}
+
+			std::optional<bool>           getBool() const;
+			std::optional<int_t>          getInt() const;
+			std::optional<float_t>        getFloat() const;
+			std::optional<string_t>       getString() const;
+			std::optional<array_span_t>   getArray() const;
+
+			std::optional<std::string_view> getStringView() const;
+			const bool*                     getBoolPtr() const;
+			const int_t*                    getIntPtr() const;
+			const float_t*                  getFloatPtr() const;
+		};
+
 		static Config parse(const std::string& str) { return parse(str.data(), str.size()); }
 		static Config parse(const char* cStr);
 		static Config parse(const char* charSeqPtr, size_t length);
@@ -324,32 +563,85 @@ namespace apcf {
 		static Config read(std::istream&, size_t count);
 		static Config read(std::istream&& tmp) { auto& tmpProxy = tmp; return read(tmpProxy); }
 
+		Config();
+		Config(const Config&);
+		Config(Config&&) noexcept;
+		~Config();
+
+		Config& operator=(const Config&);
+
+		/** Unlike move construction, move assignment notifies the
+		 * subscribers of both Configs (see `subscribe`), so it may
+		 * allocate and throw. */
+		Config& operator=(Config&&);
+
 		std::string serialize(SerializationRules = { }) const;
 		void write(io::Writer&, SerializationRules = { }) const;
 		void write(io::Writer&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
 		void write(std::ostream&, SerializationRules = { }) const;
 		void write(std::ostream&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
 
-		/** Copy every entry of the given Config. */
+		/** Builds a hash index of every key, which `get` and the typed getters
+		 * use for constant time lookups; `set` and `merge` keep it up to date.
+		 * Ordered operations, such as iteration and `getSubconfig`,
+		 * are unaffected.
+		 * Copies of an indexed Config are indexed as well. */
+		void buildIndex();
+
+		/** Frees the hash index, if any. */
+		void dropIndex() noexcept;
+
+		bool isIndexed() const noexcept { return index_.has_value(); }
+
+		/** Copy every entry of the given Config, in a single ordered pass
+		 * over both. */
 		void merge(const Config&);
 
-		/** Copy every entry of the given Config. */
+		/** Move every entry of the given Config, which is left empty:
+		 * its nodes are spliced into this one, so that nothing is copied.
+		 * Merging a Config into itself does nothing. */
 		void merge(Config&&);
 
 		/** Copy every entry of the given Config, with their keys prefixed
 		 * by the given group name and an implicit separator. */
 		void mergeAsGroup(const Key& groupName, const Config&);
 
-		/** Copy every entry of the given Config, with their keys prefixed
-		 * by the given group name and an implicit separator. */
+		/** Move every entry of the given Config, which is left empty,
+		 * with their keys prefixed by the given group name and an
+		 * implicit separator; a Config merged into itself is copied
+		 * into the group instead. */
 		void mergeAsGroup(const Key& groupName, Config&&);
 
+		/** Removes the entry, if any; returns whether there was one. */
+		bool erase(const Key&);
+
+		/** Removes every entry within the given group, in O(log n + k);
+		 * returns the number of removed entries. */
+		size_t eraseSubtree(const Key& group);
+
+		/** Moves every entry within the given group into a new Config,
+		 * removing the group name from their keys (as `getSubconfig` does).
+		 * The nodes are extracted in O(log n + k): values are never copied. */
+		Config extractSubtree(const Key& group);
+
+		/** Moves every entry within the group `from` into the group `to`,
+		 * replacing the entries they collide with; the nodes are
+		 * re-keyed and moved, values are never copied.
+		 * Returns the number of moved entries. */
+		size_t moveSubtree(const Key& from, const Key& to);
+
 		Config& operator<<(const Config& r) { merge(r); return *this; }
 		Config& operator<<(Config&& r) { merge(std::move(r)); return *this; }
 		Config& operator>>(Config& r) const { return r.operator<<(*this); }
 
-		std::map<apcf::Key, apcf::RawData>::const_iterator begin() const;
-		std::map<apcf::Key, apcf::RawData>::const_iterator end() const;
+		/** The iterator over the sorted entries; since the storage uses a
+		 * transparent comparator, this is not the iterator type of a
+		 * `std::map<Key, RawData>`, and should be spelled through this
+		 * alias rather than through the map type. */
+		using const_iterator = std::map<apcf::Key, apcf::RawData, std::less<>>::const_iterator;
+
+		const_iterator begin() const;
+		const_iterator end() const;
 
 		size_t entryCount() const;
 
@@ -365,19 +657,144 @@ namespace apcf {
 		 * The group name is followed by an implicit separator. */
 		Config getSubconfig(const Key& group) const;
 
-		std::optional<const RawData*> get(const Key&) const noexcept;
+		/** Like `getSubconfig`, but nothing is copied: the returned view
+		 * refers to this Config, and is only valid as long as the latter is. */
+		ConfigView getView(const Key& group) const;
+
+		/** Looks the key up once, for the returned handle to read its
+		 * value repeatedly; the key does not need to be defined yet. */
+		Handle resolve(Key) const;
+
+		/** Looks the key up, through fallbacks if there are any: the
+		 * lookup then builds the fallback table if it is outdated, which
+		 * allocates, and may therefore throw. */
+		std::optional<const RawData*> get(const Key&) const;
 		std::optional<bool>           getBool(const Key&) const;
 		std::optional<int_t>          getInt(const Key&) const;
 		std::optional<float_t>        getFloat(const Key&) const;
 		std::optional<string_t>       getString(const Key&) const;
 		std::optional<array_span_t>   getArray(const Key&) const;
 
+		/** Like `get`, but ignores fallbacks: only the defined entries,
+		 * which iteration and serialization see, are looked up. */
+		std::optional<const RawData*> getDefined(const Key&) const noexcept;
+
+		/** Counterparts of `getString`, `getBool`, `getInt` and `getFloat`
+		 * that never allocate: values are not converted, so a value of
+		 * another type is an InvalidValue error, and an undefined key yields
+		 * `std::nullopt` or `nullptr`.
+		 * The results point into the Config, and are only valid until the
+		 * entry is changed or removed. */
+		std::optional<std::string_view> getStringView(const Key&) const;
+		const bool*                     getBoolPtr(const Key&) const;
+		const int_t*                    getIntPtr(const Key&) const;
+		const float_t*                  getFloatPtr(const Key&) const;
+
+		/** Looks up every key of the batch in a single ordered pass over the
+		 * entries: `dst[i]` is set to the value of the i-th key of the batch
+		 * (in its original order), or to `nullptr` if there is none.
+		 * `dst` must have as many elements as the batch. */
+		void getBatch(const KeyBatch&, std::span<const RawData*> dst) const;
+
+		std::vector<const RawData*>                getBatch(const KeyBatch&) const;
+		std::vector<std::optional<bool>>           getBoolBatch(const KeyBatch&) const;
+		std::vector<std::optional<int_t>>          getIntBatch(const KeyBatch&) const;
+		std::vector<std::optional<float_t>>        getFloatBatch(const KeyBatch&) const;
+		std::vector<std::optional<string_t>>       getStringBatch(const KeyBatch&) const;
+		std::vector<std::optional<array_span_t>>   getArrayBatch(const KeyBatch&) const;
+		std::vector<std::optional<std::string_view>> getStringViewBatch(const KeyBatch&) const;
+
 		void set      (Key, RawData) noexcept;
 		void setBool  (Key, bool value) noexcept;
 		void setInt   (Key, int_t value) noexcept;
 		void setFloat (Key, float_t value) noexcept;
 		void setString(Key, string_t value) noexcept;
 		void setArray (Key, array_t value) noexcept;
+
+		/** Invokes the callback after `set`, `merge`, `mergeAsGroup` or an
+		 * assignment (such as a reload) change the value of any key that
+		 * is equal to the prefix or within it as a group; an empty prefix
+		 * matches every key.
+		 * Every modification invokes each callback at most once, with
+		 * every relevant key; values that are set to an equivalent value
+		 * are not considered changed.
+		 *
+		 * Dispatching looks up each prefix of every changed key, so its
+		 * cost does not depend on the number of subscriptions.
+		 * Subscriptions belong to this Config object: they are neither
+		 * copied nor moved with its entries.
+		 * Callbacks invoked by `set` must not throw.
+		 *
+		 * Reloading a Config is done by assigning the new version to it:
+		 * copy and move assignments notify the keys whose values differ
+		 * between both versions, and a move assignment also notifies the
+		 * subscribers of the moved-from Config that all of its keys were
+		 * removed. Move construction notifies nobody: the moved-from
+		 * Config is left empty, and only its memos are invalidated. */
+		SubscriptionId subscribe(Key prefix, ChangeCallback);
+
+		void unsubscribe(SubscriptionId) noexcept;
+
+		size_t subscriptionCount() const noexcept;
+
+		/** Incremented by every modification of the entries, even ones
+		 * that change no value. */
+		uint64_t generation() const noexcept { return generation_; }
+
+		/** Returns the generation of the last modification that changed
+		 * the value of the key, or of any key within it as a group.
+		 * Subtrees are tracked from the first time they are queried,
+		 * which yields the current generation.
+		 * Tracking is not thread-safe, and not copied or moved with the
+		 * entries. */
+		uint64_t generation(const Key& prefix) const;
+
+		/** Returns the value that `build(*this)` returned for the subtree,
+		 * if it did not change since then; otherwise, builds it again.
+		 * Each subtree holds one value per type. */
+		template<typename T, typename Builder>
+		std::shared_ptr<const T> memo(const Key& prefix, Builder&& build) const {
+			uint64_t generation;
+			auto found = findMemo_(prefix, typeid(T), &generation);
+			if(found != nullptr) return std::static_pointer_cast<const T>(std::move(found));
+			auto r = std::make_shared<const T>(std::forward<Builder>(build)(*this));
+			storeMemo_(prefix, typeid(T), generation, r);
+			return r;
+		}
+
+		/** Frees every memoized value, and stops tracking subtrees. */
+		void dropMemos() noexcept;
+
+		/** Makes undefined keys within `group.<name>`, for any name, resolve
+		 * to the same keys within `group.<defaultName>`: for instance,
+		 * `hosts.a.port` falls back to `hosts.default.port`.
+		 *
+		 * Fallbacks apply to `get`, the typed getters, batches, views and
+		 * handles; iteration, serialization and hierarchies only see the
+		 * defined entries.
+		 * The keys resolved by fallbacks are precomputed into a table at
+		 * the first lookup after entries are added or removed (setting
+		 * existing entries keeps it valid), after which looking up any
+		 * key costs a single hash lookup; lookups are therefore not
+		 * thread-safe until the table is built, as by `resolveFallbacks`.
+		 * Like subscriptions, fallbacks belong to this Config object: they
+		 * are neither copied nor moved with its entries.
+		 * Subscriptions and memos see the keys whose values change through
+		 * a fallback as changed, for the subgroups that define entries or
+		 * are observed. */
+		void addGroupFallback(Key group, Key defaultName);
+
+		/** Makes undefined keys within the group `derived` resolve to the
+		 * same keys within the group `base`, including the ones that
+		 * `base` inherits; explicit inheritance takes precedence over
+		 * group fallbacks, and cycles are ignored. */
+		void addInheritance(Key derived, Key base);
+
+		void clearFallbacks() noexcept;
+
+		/** Builds the fallback table, if there are fallbacks and the
+		 * table is outdated. */
+		void resolveFallbacks() const;
 	};
 
 
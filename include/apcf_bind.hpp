@@ -0,0 +1,207 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <tuple>
+
+
+
+namespace apcf {
+
+	/** Associates a struct member with a key, relative to the struct.
+	 * See `Binding`. */
+	template<auto member>
+	struct BoundField {
+		const char* key;
+	};
+
+	template<auto member>
+	constexpr BoundField<member> field(const char* key) { return { key }; }
+
+
+	/** Specializations of this template describe how the members of a
+	 * struct are bound to keys, by defining a `fields` tuple; members
+	 * that are bound structs themselves are bound to groups.
+	 *
+	 * ```
+	 * template<> struct apcf::Binding<Server> {
+	 *    static constexpr auto fields = std::make_tuple(
+	 *       apcf::field<&Server::host>("host"),
+	 *       apcf::field<&Server::port>("port") );
+	 * };
+	 * ```
+	 *
+	 * Bound members may be of type bool, int_t, float_t, string_t,
+	 * array_t or RawData, or a bound struct. */
+	template<typename T>
+	struct Binding;
+
+	template<typename T>
+	concept BoundStruct = requires { Binding<T>::fields; };
+
+
+	/** Keys that could not be bound, reported after a struct is read. */
+	struct BindReport {
+		std::vector<Key> unknownKeys; ///< Defined in the source, but not bound to any member.
+		std::vector<Key> missingKeys; ///< Bound to a member, but not defined in the source.
+	};
+
+
+	/** Converts a value as the `get*` functions of Config do, and assigns
+	 * it to the member of a bound struct; `key` is only used to describe
+	 * errors. */
+	void bindValue(bool& dst, RawData&&, const Key& key);
+	void bindValue(int_t& dst, RawData&&, const Key& key);
+	void bindValue(float_t& dst, RawData&&, const Key& key);
+	void bindValue(string_t& dst, RawData&&, const Key& key);
+	void bindValue(array_t& dst, RawData&&, const Key& key);
+	void bindValue(RawData& dst, RawData&&, const Key& key);
+
+
+	/** The flattened, type-erased form of a binding: every bound member
+	 * of a struct (and of its nested structs), sorted by key. */
+	class BindingTable {
+	public:
+		/** Returns the address of a member, given the address of its owner. */
+		using Accessor = void* (*)(void* owner);
+
+		/** Assigns a value to a member, given the address of the latter. */
+		using Assigner = void (*)(void* member, RawData&&, const Key&);
+
+		struct Field {
+			Key key;
+			std::vector<Accessor> path;
+			Assigner assign;
+
+			Field(Key, std::vector<Accessor> path, Assigner);
+			Field(const Field&);
+			Field(Field&&) noexcept;
+			~Field();
+
+			Field& operator=(const Field&);
+			Field& operator=(Field&&) noexcept;
+		};
+
+	private:
+		std::vector<Field> fields_;
+
+	public:
+		BindingTable();
+		BindingTable(const BindingTable&);
+		BindingTable(BindingTable&&) noexcept;
+		~BindingTable();
+
+		BindingTable& operator=(const BindingTable&);
+		BindingTable& operator=(BindingTable&&) noexcept;
+
+		/** Fields may be added in any order; `find` is only valid
+		 * after `sort` has been called. */
+		void addField(Key, std::vector<Accessor> path, Assigner);
+		void sort();
+
+		/** Returns the index of the field bound to the given key,
+		 * or `size()` if there is none. */
+		size_t find(const Key&) const noexcept;
+
+		size_t size() const noexcept { return fields_.size(); }
+		const Field& operator[](size_t index) const noexcept { return fields_[index]; }
+	};
+
+
+	/** Parses a configuration straight into the object described by the
+	 * given table, without building a Config.
+	 * Redefined keys are assigned more than once, the last value wins. */
+	BindReport readBound(const BindingTable&, void* dst, io::Reader&);
+
+
+
+	namespace bind_impl {
+
+		template<typename>
+		struct MemberTraits;
+
+		template<typename Owner_, typename Type_>
+		struct MemberTraits<Type_ Owner_::*> {
+			using Owner = Owner_;
+			using Type = Type_;
+		};
+
+
+		template<auto member>
+		void* accessMember(void* owner) {
+			using Owner = typename MemberTraits<decltype(member)>::Owner;
+			return &(static_cast<Owner*>(owner)->*member);
+		}
+
+		template<typename T>
+		void assignMember(void* dst, RawData&& value, const Key& key) {
+			bindValue(*static_cast<T*>(dst), std::move(value), key);
+		}
+
+
+		template<BoundStruct T>
+		void addFields(BindingTable&, const std::string& prefix, const std::vector<BindingTable::Accessor>& path);
+
+		template<auto member>
+		void addField(
+				BindingTable& table,
+				const std::string& prefix, const std::vector<BindingTable::Accessor>& path,
+				BoundField<member> field
+		) {
+			using Type = typename MemberTraits<decltype(member)>::Type;
+			auto memberPath = path;
+			memberPath.push_back(&accessMember<member>);
+			std::string key = prefix.empty()? std::string(field.key) : (prefix + '.' + field.key);
+			if constexpr(BoundStruct<Type>) {
+				addFields<Type>(table, key, memberPath);
+			} else {
+				table.addField(Key(std::move(key)), std::move(memberPath), &assignMember<Type>);
+			}
+		}
+
+		template<BoundStruct T>
+		void addFields(BindingTable& table, const std::string& prefix, const std::vector<BindingTable::Accessor>& path) {
+			std::apply(
+				[&](auto... fields) { (addField(table, prefix, path, fields), ...); },
+				Binding<T>::fields );
+		}
+
+	}
+
+
+	/** Returns the binding table of the given struct, which is
+	 * built upon the first call. */
+	template<BoundStruct T>
+	const BindingTable& bindingTableOf() {
+		static const BindingTable table = []() {
+			BindingTable r;
+			bind_impl::addFields<T>(r, { }, { });
+			r.sort();
+			return r;
+		} ();
+		return table;
+	}
+
+
+	template<BoundStruct T>
+	BindReport bindRead(T& dst, io::Reader& in) {
+		return readBound(bindingTableOf<T>(), &dst, in);
+	}
+
+	template<BoundStruct T>
+	BindReport bindRead(T& dst, io::Reader&& tmp) {
+		auto& tmpProxy = tmp;
+		return bindRead(dst, tmpProxy);
+	}
+
+	template<BoundStruct T>
+	BindReport bindRead(T& dst, std::istream& in) {
+		return bindRead(dst, io::StdStreamReader(in));
+	}
+
+	template<BoundStruct T>
+	BindReport bindParse(T& dst, const std::string& str) {
+		return bindRead(dst, io::StringReader(std::span<const char>(str.data(), str.size())));
+	}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** Collects entries in any order, then builds a Config from all of
+	 * them at once: the entries are sorted a single time, and moved into
+	 * the Config rather than inserted one by one.
+	 *
+	 * Keys that are added more than once take the value that was added
+	 * last, as if `Config::set` had been called for every entry. */
+	class ConfigBuilder {
+	public:
+		enum class KeyCheck {
+			/** Keys added as strings are validated, like `Key` does. */
+			eValidate,
+
+			/** Keys added as strings are assumed to be valid; invalid
+			 * ones are only detected by debug builds. */
+			eTrust
+		};
+
+	private:
+		std::vector<std::pair<Key, RawData>> entries_;
+		KeyCheck keyCheck_;
+
+	public:
+		explicit ConfigBuilder(KeyCheck = KeyCheck::eValidate);
+
+		ConfigBuilder(const ConfigBuilder&);
+		ConfigBuilder(ConfigBuilder&&) noexcept;
+		~ConfigBuilder();
+
+		ConfigBuilder& operator=(const ConfigBuilder&);
+		ConfigBuilder& operator=(ConfigBuilder&&) noexcept;
+
+		void reserve(size_t entryCount) { entries_.reserve(entryCount); }
+
+		/** The number of added entries, including redefinitions. */
+		size_t size() const noexcept { return entries_.size(); }
+
+		/** Appends an entry, taking ownership of both the key and the
+		 * value; keys constructed as `Key` are not validated again. */
+		void add(Key, RawData);
+		void add(std::string key, RawData);
+		void add(const char* key, RawData value) { add(std::string(key), std::move(value)); }
+
+		/** Sorts the entries, keeping the last value of every key, and
+		 * moves them into a new Config in O(n log n); the builder is left
+		 * empty, and can be reused. */
+		Config build();
+	};
+
+}
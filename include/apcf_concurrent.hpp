@@ -0,0 +1,81 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+
+
+namespace apcf {
+
+	/** A mutable config that any number of threads can read and write
+	 * concurrently, meant to be filled by parallel producers and then
+	 * frozen into a Config.
+	 *
+	 * Entries are distributed across shards by the hash of their keys,
+	 * each shard with its own lock: threads only contend when they access
+	 * keys of the same shard. Entries are unordered until they are frozen.
+	 *
+	 * Getters return copies, since any entry may be replaced as soon as
+	 * its shard is unlocked. */
+	class ConcurrentConfig {
+	private:
+		struct KeyHash {
+			using is_transparent = void;
+			size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>()(key); }
+		};
+
+		struct Shard_;
+
+		std::unique_ptr<Shard_[]> shards_;
+		unsigned shardBits_;
+
+		Shard_& shardOf_(std::string_view key) const noexcept;
+
+	public:
+		/** The number of shards is rounded up to a power of two. */
+		explicit ConcurrentConfig(size_t minShardCount = 64);
+
+		/** Distributes the entries of the given Config. */
+		explicit ConcurrentConfig(const Config&, size_t minShardCount = 64);
+
+		ConcurrentConfig(const ConcurrentConfig&) = delete;
+		ConcurrentConfig(ConcurrentConfig&&) noexcept;
+		~ConcurrentConfig();
+
+		ConcurrentConfig& operator=(const ConcurrentConfig&) = delete;
+		ConcurrentConfig& operator=(ConcurrentConfig&&) noexcept;
+
+		size_t shardCount() const noexcept { return size_t(1) << shardBits_; }
+
+		/** Counts the entries of every shard, locking one at a time: the
+		 * result is only exact if no other thread is inserting entries. */
+		size_t entryCount() const;
+
+		/** Moves every entry into a new Config, leaving this one empty:
+		 * each shard is sorted on its own, then all of them are merged
+		 * in a single ordered pass.
+		 * Entries set concurrently may or may not be moved. */
+		Config freeze();
+
+		std::optional<RawData>  get(const Key&) const;
+		std::optional<bool>     getBool(const Key&) const;
+		std::optional<int_t>    getInt(const Key&) const;
+		std::optional<float_t>  getFloat(const Key&) const;
+		std::optional<string_t> getString(const Key&) const;
+		std::optional<array_t>  getArray(const Key&) const;
+
+		void set      (Key, RawData);
+		void setBool  (Key, bool value);
+		void setInt   (Key, int_t value);
+		void setFloat (Key, float_t value);
+		void setString(Key, string_t value);
+		void setArray (Key, array_t value);
+
+		/** Returns whether an entry was erased. */
+		bool erase(const Key&);
+	};
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** The entries that differ between two configs; nothing is copied, so
+	 * the pointers are only valid as long as both configs are (and are
+	 * not modified).
+	 * Each vector is sorted by key. */
+	struct ConfigDiff {
+		using Entry = std::pair<const Key, RawData>;
+
+		/** Entries of the latter config, whose keys the former lacks. */
+		std::vector<const Entry*> added;
+
+		/** Entries of the former config, whose keys the latter lacks. */
+		std::vector<const Entry*> removed;
+
+		/** Pairs of entries with the same key but different values,
+		 * from the former and the latter config respectively. */
+		std::vector<std::pair<const Entry*, const Entry*>> changed;
+
+		ConfigDiff();
+		ConfigDiff(const ConfigDiff&);
+		ConfigDiff(ConfigDiff&&) noexcept;
+		~ConfigDiff();
+
+		ConfigDiff& operator=(const ConfigDiff&);
+		ConfigDiff& operator=(ConfigDiff&&) noexcept;
+
+		bool empty() const noexcept { return added.empty() && removed.empty() && changed.empty(); }
+	};
+
+
+	/** Compares two values structurally, without serializing them:
+	 * strings are compared byte by byte, arrays element by element, and
+	 * the comparison stops at the first difference.
+	 * Unlike `==`, NaN is equivalent to NaN. */
+	bool equivalent(const RawData&, const RawData&) noexcept;
+
+	/** Compares two configs in a single ordered pass over both. */
+	ConfigDiff diff(const Config& former, const Config& latter);
+
+	/** Like `diff(former, latter)`, but only compares the entries within
+	 * the given group. */
+	ConfigDiff diff(const Config& former, const Config& latter, const Key& group);
+
+}
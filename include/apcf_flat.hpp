@@ -0,0 +1,141 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <iterator>
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** A read-mostly alternative to Config, with its entries stored in
+	 * two sorted contiguous arrays (keys and values) instead of a
+	 * node-based tree: lookups are binary searches over contiguous
+	 * memory, and iteration is a linear scan.
+	 *
+	 * Keys that are not already in the arrays are inserted into a small
+	 * sorted buffer, which is merged into the arrays once its size exceeds
+	 * the square root of theirs; iteration transparently visits both. */
+	class FlatConfig {
+	public:
+		class const_iterator {
+		private:
+			friend FlatConfig;
+			const FlatConfig* cfg_;
+			size_t main_;
+			size_t delta_;
+
+			const_iterator(const FlatConfig* cfg, size_t main, size_t delta): cfg_(cfg), main_(main), delta_(delta) { }
+
+			bool isDelta_() const noexcept {
+				if(delta_ >= cfg_->deltaKeys_.size()) return false;
+				if(main_ >= cfg_->keys_.size()) return true;
+				return cfg_->deltaKeys_[delta_] < cfg_->keys_[main_];
+			}
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using difference_type = std::ptrdiff_t;
+			using value_type = std::pair<const Key&, const RawData&>;
+			using reference = value_type;
+
+			struct pointer {
+				value_type entry;
+				const value_type* operator->() const noexcept { return &entry; }
+			};
+
+			const_iterator() = default;
+
+			reference operator*() const noexcept {
+				if(isDelta_()) return { cfg_->deltaKeys_[delta_], cfg_->deltaValues_[delta_] };
+				else           return { cfg_->keys_[main_], cfg_->values_[main_] };
+			}
+			pointer operator->() const noexcept { return { **this }; }
+
+			const_iterator& operator++() noexcept {
+				// The two arrays never share a key, see `FlatConfig::set`
+				if(isDelta_()) ++ delta_;
+				else           ++ main_;
+				return *this;
+			}
+			const_iterator operator++(int) noexcept { auto r = *this; ++ *this; return r; }
+
+			bool operator==(const const_iterator& r) const noexcept { return (main_ == r.main_) && (delta_ == r.delta_); }
+		};
+
+	private:
+		std::vector<Key> keys_;
+		std::vector<RawData> values_;
+		std::vector<Key> deltaKeys_;
+		std::vector<RawData> deltaValues_;
+
+		void mergeDelta_();
+
+	public:
+		static FlatConfig parse(const std::string& str) { return parse(str.data(), str.size()); }
+		static FlatConfig parse(const char* cStr);
+		static FlatConfig parse(const char* charSeqPtr, size_t length);
+		static FlatConfig read(io::Reader&);
+		static FlatConfig read(io::Reader&& tmp) { auto& tmpProxy = tmp; return read(tmpProxy); }
+		static FlatConfig read(std::istream&);
+		static FlatConfig read(std::istream&, size_t count);
+		static FlatConfig read(std::istream&& tmp) { auto& tmpProxy = tmp; return read(tmpProxy); }
+
+		FlatConfig();
+		FlatConfig(const FlatConfig&);
+		FlatConfig(FlatConfig&&) noexcept;
+		~FlatConfig();
+
+		explicit FlatConfig(const Config&);
+		explicit FlatConfig(Config&&);
+
+		FlatConfig& operator=(const FlatConfig&);
+		FlatConfig& operator=(FlatConfig&&) noexcept;
+
+		/** Copies every entry into a new Config. */
+		Config toConfig() const&;
+
+		/** Moves every entry into a new Config. */
+		Config toConfig() &&;
+
+		std::string serialize(SerializationRules = { }) const;
+		void write(io::Writer&, SerializationRules = { }) const;
+		void write(io::Writer&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+		void write(std::ostream&, SerializationRules = { }) const;
+		void write(std::ostream&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+
+		const_iterator begin() const noexcept { return const_iterator(this, 0, 0); }
+		const_iterator end() const noexcept { return const_iterator(this, keys_.size(), deltaKeys_.size()); }
+
+		size_t entryCount() const noexcept { return keys_.size() + deltaKeys_.size(); }
+
+		/** Returns the FlatConfig's hierarchy, which can be used to implement logic
+		 * that depends on the relationships between keys. */
+		ConfigHierarchy getHierarchy() const;
+
+		/** Merges the buffered insertions into the main arrays, so that
+		 * every subsequent lookup is a single binary search. */
+		void compact();
+
+		std::optional<const RawData*> get(const Key&) const noexcept;
+		std::optional<bool>           getBool(const Key&) const;
+		std::optional<int_t>          getInt(const Key&) const;
+		std::optional<float_t>        getFloat(const Key&) const;
+		std::optional<string_t>       getString(const Key&) const;
+		std::optional<array_span_t>   getArray(const Key&) const;
+
+		std::optional<std::string_view> getStringView(const Key&) const;
+		const bool*                     getBoolPtr(const Key&) const;
+		const int_t*                    getIntPtr(const Key&) const;
+		const float_t*                  getFloatPtr(const Key&) const;
+
+		void set      (Key, RawData) noexcept;
+		void setBool  (Key, bool value) noexcept;
+		void setInt   (Key, int_t value) noexcept;
+		void setFloat (Key, float_t value) noexcept;
+		void setString(Key, string_t value) noexcept;
+		void setArray (Key, array_t value) noexcept;
+	};
+
+}
@@ -11,6 +11,7 @@ namespace apcf {
 
 	class Key;
 	class KeySpan;
+	class KeyBatch;
 
 	struct SerializationRules;
 	class RawString;
@@ -18,7 +19,18 @@ namespace apcf {
 	struct RawData;
 
 	class Config;
+	class FlatConfig;
+	class TrieConfig;
+	class ConfigView;
+	class PersistentConfig;
+	class ConcurrentConfig;
+	class IncrementalConfig;
+	class LayeredConfig;
+	class ConfigBuilder;
 	class ConfigHierarchy;
+	struct ConfigDiff;
+	class KeyPattern;
+	template<typename T> struct QueryColumn;
 
 	class ConfigError;
 	class InvalidKey;
@@ -1,48 +1,191 @@
-#include <apcf_fwd.hpp>
+#pragma once
 
+#include <apcf.hpp>
+
+#include <cstdint>
+#include <iterator>
 #include <map>
-#include <set>
+#include <optional>
+#include <string>
+#include <vector>
 
 
 
 namespace apcf {
 
+	/** The relationships between the keys of a config, built in a single
+	 * pass over its sorted keys.
+	 *
+	 * Nodes are stored in one array, and the children of each node are a
+	 * contiguous range of a second one; the name of every node is a span
+	 * of the keys, which are copied once into a single buffer.
+	 *
+	 * Chains of single children are compressed upon construction, so
+	 * that autocompleting a node takes O(1) time; the compressed
+	 * hierarchy is available through `getCompressedSubkeys`.
+	 *
+	 * Indices and offsets are 32 bits wide: building a hierarchy of more
+	 * nodes, or of keys longer than 4 GiB in total, throws
+	 * `std::length_error`. */
 	class ConfigHierarchy {
+	public:
+		using node_index_t = uint32_t;
+
+		struct Node {
+			/** The full key of the node, as a range of the name buffer. */
+			node_index_t nameBegin;
+			node_index_t nameSize;
+			node_index_t depth;
+
+			/** The range of the children array holding the node's children. */
+			node_index_t childrenBegin;
+			node_index_t childrenEnd;
+
+			/** The first node down the chain of single children starting
+			 * from this one, which may be this one. */
+			node_index_t autocompleted;
+		};
+
+		static constexpr node_index_t rootIndex = 0;
+
+		/** The keys of the children of a node, sorted; the range refers
+		 * to the hierarchy, and is only valid as long as the latter is
+		 * neither modified nor destroyed. */
+		class Subkeys {
+		private:
+			friend ConfigHierarchy;
+			const ConfigHierarchy* hierarchy_;
+			const node_index_t* begin_;
+			const node_index_t* end_;
+
+			Subkeys(const ConfigHierarchy* hierarchy, const node_index_t* begin, const node_index_t* end):
+					hierarchy_(hierarchy), begin_(begin), end_(end)
+			{ }
+
+		public:
+			class const_iterator {
+			private:
+				friend Subkeys;
+				const ConfigHierarchy* hierarchy_;
+				const node_index_t* cur_;
+
+				const_iterator(const ConfigHierarchy* hierarchy, const node_index_t* cur): hierarchy_(hierarchy), cur_(cur) { }
+
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using difference_type = std::ptrdiff_t;
+				using value_type = KeySpan;
+				using reference = KeySpan;
+				using pointer = void;
+
+				const_iterator(): hierarchy_(nullptr), cur_(nullptr) { }
+
+				KeySpan operator*() const noexcept { return hierarchy_->nodeKey(*cur_); }
+				node_index_t nodeIndex() const noexcept { return *cur_; }
+
+				const_iterator& operator++() noexcept { ++ cur_; return *this; }
+				const_iterator operator++(int) noexcept { auto r = *this; ++ cur_; return r; }
+
+				bool operator==(const const_iterator& r) const noexcept { return cur_ == r.cur_; }
+			};
+
+			Subkeys(): hierarchy_(nullptr), begin_(nullptr), end_(nullptr) { }
+
+			const_iterator begin() const noexcept { return const_iterator(hierarchy_, begin_); }
+			const_iterator end() const noexcept { return const_iterator(hierarchy_, end_); }
+
+			size_t size() const noexcept { return size_t(end_ - begin_); }
+			bool empty() const noexcept { return begin_ == end_; }
+
+			KeySpan operator[](size_t index) const noexcept { return hierarchy_->nodeKey(begin_[index]); }
+		};
+
 	private:
 		friend Config;
-		std::map<Key, std::set<Key>> tree_;
 
-		bool collapse_(KeySpan, KeySpan parent);
+		/* The keys the nodes' names refer to. */
+		std::string names_;
+
+		/* The first node is the root, whose key is empty. */
+		std::vector<Node> nodes_;
+		std::vector<node_index_t> children_;
+
+		/* The autocompleted nodes of the children, in the same ranges. */
+		std::vector<node_index_t> compressedChildren_;
+
+		/* Returns the keys of the nodes without children, which are
+		 * enough to build the hierarchy again. */
+		std::vector<std::string> leafKeys_() const;
+
+		/* Builds the hierarchy from keys that are sorted, or at least
+		 * grouped: every key within a group must follow the previous one. */
+		template<typename Range, typename GetKey> void build_(const Range&, GetKey&&);
 
 	public:
-		ConfigHierarchy() = default;
-		ConfigHierarchy(const ConfigHierarchy&) = default;
-		ConfigHierarchy(ConfigHierarchy&&) = default;
+		ConfigHierarchy();
+		ConfigHierarchy(const ConfigHierarchy&);
+		ConfigHierarchy(ConfigHierarchy&&) noexcept;
+		~ConfigHierarchy();
 
+		ConfigHierarchy(const Config&);
+		ConfigHierarchy(const FlatConfig&);
+		ConfigHierarchy(const TrieConfig&);
+		ConfigHierarchy(const ConfigView&);
+		ConfigHierarchy(const PersistentConfig&);
+		ConfigHierarchy(const LayeredConfig&);
+
+		/** Builds the hierarchy of the keys of a map, as it was built
+		 * before hierarchies could be built from configs directly. */
 		ConfigHierarchy(const std::map<Key, RawData>&);
 
-		ConfigHierarchy& operator=(const ConfigHierarchy&) = default;
-		ConfigHierarchy& operator=(ConfigHierarchy&&) = default;
+		/** Builds the hierarchy of the given keys, in any order; keys
+		 * may be repeated. */
+		explicit ConfigHierarchy(std::vector<Key> keys);
+
+		ConfigHierarchy& operator=(const ConfigHierarchy&);
+		ConfigHierarchy& operator=(ConfigHierarchy&&) noexcept;
 
-		/** Insert every level of the given key into the hierarchy. */
+		/** Insert every level of the given key into the hierarchy.
+		 * The hierarchy is built again, which takes linear time, so
+		 * inserting keys one at a time takes quadratic time. */
+		[[deprecated("Build the hierarchy from every key at once instead")]]
 		void putKey(const Key&);
 
-		/** Returns a (reference to a) set of all the keys within the
-		 * hierarchy whose "parent" key matches the given argument.
+		size_t nodeCount() const noexcept { return nodes_.size(); }
+		const Node& node(node_index_t index) const noexcept { return nodes_[index]; }
+		KeySpan nodeKey(node_index_t index) const noexcept;
+
+		/** Returns the index of the node with the given key, looking it up
+		 * one segment at a time. */
+		std::optional<node_index_t> findNode(KeySpan) const noexcept;
+
+		/** Returns the keys within the hierarchy whose "parent" key
+		 * matches the given argument.
 		 *
 		 * Note that the returned subkeys do not necessarily have an
 		 * associated value: if a Config contains entries with keys
 		 * "a.b" and "a.c.d", the subkeys of "a" are "a.b" and "a.c". */
-		const std::set<Key>& getSubkeys(const Key&) const;
+		Subkeys getSubkeys(const Key&) const;
+		Subkeys getSubkeys(KeySpan) const;
+		Subkeys getSubkeys(node_index_t) const noexcept;
+
+		/** Returns the subkeys of a node, each of them autocompleted,
+		 * so that none of them has exactly one subkey; they are in the
+		 * order of the subkeys they replace. */
+		Subkeys getCompressedSubkeys(const Key&) const;
+		Subkeys getCompressedSubkeys(KeySpan) const;
+		Subkeys getCompressedSubkeys(node_index_t) const noexcept;
 
 		/** If the given key has exactely one subkey, recursively replaces
 		 * the argument with it; returns the first subkey that has zero
 		 * or multiple subkeys.
 		 *
-		 * The returned reference may point to a Key instance owned by the
-		 * ConfigHierarchy, so it should be copied (rather than referenced)
-		 * if the latter is modified or destroyed. */
-		const Key& autocomplete(const Key&) const;
+		 * The returned span may refer to the argument or to the
+		 * ConfigHierarchy, so it should be copied into a Key if either
+		 * is modified or destroyed. */
+		KeySpan autocomplete(const Key&) const;
+		KeySpan autocomplete(KeySpan) const;
+		node_index_t autocomplete(node_index_t index) const noexcept { return nodes_[index].autocompleted; }
 	};
 
 }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** Keeps the text of a config along with the Config it defines, so
+	 * that editing the text only re-parses the top-level entries and
+	 * groups that the edit touches.
+	 *
+	 * The text is indexed by top-level definition: each one is a byte
+	 * range, along with the keys it defines.
+	 * A key that is defined more than once still takes the value of its
+	 * last definition, even when the definitions are in different groups
+	 * and only some of them are re-parsed.
+	 *
+	 * Edits that cannot be parsed on their own, such as one that moves a
+	 * closing brace past the touched definitions, fall back to parsing the
+	 * whole text. */
+	class IncrementalConfig {
+	public:
+		struct Segment {
+			size_t begin;
+
+			/** The keys of the entries defined within the segment,
+			 * sorted and without duplicates. */
+			std::vector<Key> keys;
+
+			Segment(size_t begin, std::vector<Key> keys);
+			Segment(const Segment&);
+			Segment(Segment&&) noexcept;
+			~Segment();
+
+			Segment& operator=(const Segment&);
+			Segment& operator=(Segment&&) noexcept;
+		};
+
+	private:
+		std::string text_;
+		Config cfg_;
+		std::vector<Segment> segments_;
+
+		/* The number of segments defining each key, for keys defined by
+		 * more than one: the views refer to the keys of `cfg_`. */
+		std::unordered_map<std::string_view, size_t> redefinitions_;
+
+		size_t segmentEnd_(size_t index) const noexcept;
+		size_t segmentAt_(size_t offset) const noexcept;
+
+		/* Returns the value of the last definition of the key within the
+		 * first `segmentsEnd` segments, which must define it. */
+		RawData lastDefinition_(std::string_view key, size_t segmentsEnd) const;
+
+		void parseAll_(std::string text);
+
+		/* Replaces the segments from `first` to `last` (included) with
+		 * the given text; returns `false`, changing nothing, if the text
+		 * cannot be parsed on its own. */
+		bool reparse_(size_t first, size_t last, std::string_view regionText, size_t oldRegionSize);
+
+	public:
+		IncrementalConfig();
+		explicit IncrementalConfig(std::string text);
+
+		IncrementalConfig(const IncrementalConfig&);
+		IncrementalConfig(IncrementalConfig&&) noexcept;
+		~IncrementalConfig();
+
+		IncrementalConfig& operator=(const IncrementalConfig&);
+		IncrementalConfig& operator=(IncrementalConfig&&);
+
+		const std::string& text() const noexcept { return text_; }
+		const Config& config() const noexcept { return cfg_; }
+
+		/** The top-level definitions, in order: each one ends where the
+		 * next one begins, the last one at the end of the text. */
+		const std::vector<Segment>& segments() const noexcept { return segments_; }
+
+		/** Replaces `length` bytes of the text, starting at `offset`,
+		 * then re-parses the definitions that were touched.
+		 * Returns the number of bytes that were parsed.
+		 *
+		 * If the edited text cannot be parsed, the exception is
+		 * propagated and nothing is changed. */
+		size_t edit(size_t offset, size_t length, std::string_view replacement);
+
+		/** Replaces the whole text, only re-parsing the definitions
+		 * between the longest common prefix and suffix of both texts.
+		 * Returns the number of bytes that were parsed. */
+		size_t update(std::string_view newText);
+	};
+
+}
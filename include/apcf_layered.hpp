@@ -0,0 +1,156 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** Resolves keys through an ordered stack of Config layers, from the
+	 * topmost one down, without merging them: replacing a layer costs
+	 * O(1), and leaves every other one untouched.
+	 *
+	 * Layers are either shared, owned or explicitly borrowed (see
+	 * `borrowLayer`); borrowed layers must outlive the LayeredConfig.
+	 * Iteration and serialization present the merged entries in order,
+	 * through a single pass over every layer. */
+	class LayeredConfig {
+	public:
+		using Entry = std::pair<const Key, RawData>;
+
+		class const_iterator {
+		private:
+			friend LayeredConfig;
+			using MapIter = std::map<Key, RawData, std::less<>>::const_iterator;
+
+			struct Cursor {
+				MapIter cur;
+				MapIter end;
+			};
+
+			/* From the bottom layer to the top one. */
+			std::vector<Cursor> cursors_;
+			const Entry* current_;
+
+			explicit const_iterator(const std::vector<std::shared_ptr<const Config>>& layers);
+
+			void seek_() noexcept;
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using difference_type = std::ptrdiff_t;
+			using value_type = Entry;
+			using reference = const Entry&;
+			using pointer = const Entry*;
+
+			const_iterator();
+			const_iterator(const const_iterator&);
+			const_iterator(const_iterator&&) noexcept;
+			~const_iterator();
+
+			const_iterator& operator=(const const_iterator&);
+			const_iterator& operator=(const_iterator&&) noexcept;
+
+			reference operator*() const noexcept { return *current_; }
+			pointer operator->() const noexcept { return current_; }
+
+			const_iterator& operator++();
+			const_iterator operator++(int) { auto r = *this; ++ *this; return r; }
+
+			bool operator==(const const_iterator& r) const noexcept { return current_ == r.current_; }
+		};
+
+	private:
+		/* From the bottom layer to the top one. */
+		std::vector<std::shared_ptr<const Config>> layers_;
+
+		/* Maps each key that was looked up to its value in the topmost
+		 * layer defining it, or `nullptr`. */
+		mutable std::optional<std::unordered_map<std::string, const RawData*>> cache_;
+
+		const RawData* resolve_(const Key&) const;
+
+	public:
+		LayeredConfig();
+		LayeredConfig(const LayeredConfig&);
+		LayeredConfig(LayeredConfig&&) noexcept;
+		~LayeredConfig();
+
+		LayeredConfig& operator=(const LayeredConfig&);
+		LayeredConfig& operator=(LayeredConfig&&) noexcept;
+
+		size_t layerCount() const noexcept { return layers_.size(); }
+
+		/** Layers are indexed from the bottom one, which is overridden
+		 * by every other. */
+		const Config& layer(size_t index) const { return *layers_.at(index); }
+
+		/** Adds a layer on top of the others.
+		 * Lvalues are neither copied nor borrowed implicitly: they must
+		 * either be copied into an rvalue, or passed to `borrowLayer`. */
+		void pushLayer(std::shared_ptr<const Config>);
+		void pushLayer(Config&&);
+		void pushLayer(const Config&) = delete;
+
+		/** Adds a layer on top of the others, referring to the given
+		 * Config, which must outlive the LayeredConfig. */
+		void borrowLayer(const Config& borrowed);
+		void borrowLayer(const Config&&) = delete;
+
+		/** Replaces a layer, leaving the others untouched; lvalues are
+		 * handled as by `pushLayer`. */
+		void setLayer(size_t index, std::shared_ptr<const Config>);
+		void setLayer(size_t index, Config&&);
+		void setLayer(size_t index, const Config&) = delete;
+
+		/** Replaces a layer with a reference to the given Config, which
+		 * must outlive the LayeredConfig. */
+		void setBorrowedLayer(size_t index, const Config& borrowed);
+		void setBorrowedLayer(size_t index, const Config&&) = delete;
+
+		/** Caches the layer resolving each looked up key, which speeds up
+		 * repeated lookups when there are many layers.
+		 * The cache is cleared when a layer is added or replaced; layers
+		 * modified in place require `invalidateCache` to be called.
+		 * Lookups modify the cache, so a cached LayeredConfig must not be
+		 * read by more than one thread at a time. */
+		void enableCache();
+		void disableCache() noexcept;
+		void invalidateCache() noexcept;
+		bool isCached() const noexcept { return cache_.has_value(); }
+
+		/** Copies the merged entries into a new Config. */
+		Config flatten() const;
+
+		std::string serialize(SerializationRules = { }) const;
+		void write(io::Writer&, SerializationRules = { }) const;
+		void write(io::Writer&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+		void write(std::ostream&, SerializationRules = { }) const;
+		void write(std::ostream&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+
+		const_iterator begin() const { return const_iterator(layers_); }
+		const_iterator end() const { return const_iterator(); }
+
+		/** Counts the merged entries, which requires iterating over them. */
+		size_t entryCount() const;
+
+		ConfigHierarchy getHierarchy() const;
+
+		std::optional<const RawData*> get(const Key&) const;
+		std::optional<bool>           getBool(const Key&) const;
+		std::optional<int_t>          getInt(const Key&) const;
+		std::optional<float_t>        getFloat(const Key&) const;
+		std::optional<string_t>       getString(const Key&) const;
+		std::optional<array_span_t>   getArray(const Key&) const;
+
+		std::optional<std::string_view> getStringView(const Key&) const;
+		const bool*                     getBoolPtr(const Key&) const;
+		const int_t*                    getIntPtr(const Key&) const;
+		const float_t*                  getFloatPtr(const Key&) const;
+	};
+
+}
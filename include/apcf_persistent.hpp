@@ -0,0 +1,149 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** An immutable alternative to Config, stored as a balanced search
+	 * tree whose nodes are shared between versions: copying costs O(1),
+	 * and `set` or `erase` return a new version in O(log n), which only
+	 * allocates the nodes on the path to the changed entry.
+	 *
+	 * Iteration visits the entries in the same (lexical) order as Config. */
+	class PersistentConfig {
+	public:
+		using Entry = std::pair<const Key, RawData>;
+
+		/** A node of the tree; nodes are never modified, and may be
+		 * shared by any number of versions. */
+		struct Node {
+			std::shared_ptr<const Entry> entry;
+			std::shared_ptr<const Node> left;
+			std::shared_ptr<const Node> right;
+			size_t height;
+
+			~Node();
+		};
+
+		class const_iterator {
+		private:
+			friend PersistentConfig;
+
+			/* The nodes whose entries and right subtrees are yet to be
+			 * visited, the last one being the current node. */
+			std::vector<const Node*> stack_;
+
+			explicit const_iterator(const Node* root);
+
+			void pushLeftSpine_(const Node*);
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using difference_type = std::ptrdiff_t;
+			using value_type = Entry;
+			using reference = const Entry&;
+			using pointer = const Entry*;
+
+			const_iterator();
+			const_iterator(const const_iterator&);
+			const_iterator(const_iterator&&) noexcept;
+			~const_iterator();
+
+			const_iterator& operator=(const const_iterator&);
+			const_iterator& operator=(const_iterator&&) noexcept;
+
+			reference operator*() const noexcept { return *stack_.back()->entry; }
+			pointer operator->() const noexcept { return stack_.back()->entry.get(); }
+
+			const_iterator& operator++();
+			const_iterator operator++(int) { auto r = *this; ++ *this; return r; }
+
+			bool operator==(const const_iterator& r) const noexcept;
+		};
+
+	private:
+		std::shared_ptr<const Node> root_;
+		size_t size_;
+
+		PersistentConfig(std::shared_ptr<const Node> root, size_t size);
+
+		const Entry* find_(const Key&) const noexcept;
+
+	public:
+		static PersistentConfig parse(const std::string& str) { return parse(str.data(), str.size()); }
+		static PersistentConfig parse(const char* cStr);
+		static PersistentConfig parse(const char* charSeqPtr, size_t length);
+		static PersistentConfig read(io::Reader&);
+		static PersistentConfig read(io::Reader&& tmp) { auto& tmpProxy = tmp; return read(tmpProxy); }
+		static PersistentConfig read(std::istream&);
+		static PersistentConfig read(std::istream&, size_t count);
+		static PersistentConfig read(std::istream&& tmp) { auto& tmpProxy = tmp; return read(tmpProxy); }
+
+		PersistentConfig();
+		PersistentConfig(const PersistentConfig&);
+		PersistentConfig(PersistentConfig&&) noexcept;
+		~PersistentConfig();
+
+		/** Builds a perfectly balanced tree, in linear time. */
+		explicit PersistentConfig(const Config&);
+
+		PersistentConfig& operator=(const PersistentConfig&);
+		PersistentConfig& operator=(PersistentConfig&&) noexcept;
+
+		/** Copies every entry into a new Config. */
+		Config toConfig() const;
+
+		std::string serialize(SerializationRules = { }) const;
+		void write(io::Writer&, SerializationRules = { }) const;
+		void write(io::Writer&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+		void write(std::ostream&, SerializationRules = { }) const;
+		void write(std::ostream&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+
+		const_iterator begin() const { return const_iterator(root_.get()); }
+		const_iterator end() const { return const_iterator(); }
+
+		size_t entryCount() const noexcept { return size_; }
+
+		/** Returns the root of the tree, or `nullptr` if there are no entries. */
+		const Node* root() const noexcept { return root_.get(); }
+
+		/** Whether both versions share the same tree, in O(1): if they do,
+		 * they have the same entries; if they do not, they may still have
+		 * equal entries. */
+		bool identical(const PersistentConfig& r) const noexcept { return root_ == r.root_; }
+
+		ConfigHierarchy getHierarchy() const;
+
+		std::optional<const RawData*> get(const Key&) const noexcept;
+		std::optional<bool>           getBool(const Key&) const;
+		std::optional<int_t>          getInt(const Key&) const;
+		std::optional<float_t>        getFloat(const Key&) const;
+		std::optional<string_t>       getString(const Key&) const;
+		std::optional<array_span_t>   getArray(const Key&) const;
+
+		std::optional<std::string_view> getStringView(const Key&) const;
+		const bool*                     getBoolPtr(const Key&) const;
+		const int_t*                    getIntPtr(const Key&) const;
+		const float_t*                  getFloatPtr(const Key&) const;
+
+		/** Returns a new version with the given entry set, which shares
+		 * every node that is not on the path to it with this one. */
+		[[nodiscard]] PersistentConfig set      (Key, RawData) const;
+		[[nodiscard]] PersistentConfig setBool  (Key, bool value) const;
+		[[nodiscard]] PersistentConfig setInt   (Key, int_t value) const;
+		[[nodiscard]] PersistentConfig setFloat (Key, float_t value) const;
+		[[nodiscard]] PersistentConfig setString(Key, string_t value) const;
+		[[nodiscard]] PersistentConfig setArray (Key, array_t value) const;
+
+		/** Returns a new version without the given entry, or this same
+		 * version if there is no such entry. */
+		[[nodiscard]] PersistentConfig erase(const Key&) const;
+	};
+
+}
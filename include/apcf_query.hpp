@@ -0,0 +1,105 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** A glob over the segments of keys: `*` matches exactly one segment,
+	 * `**` one or more; other segments are matched literally.
+	 * For instance, `servers.*.port` matches `servers.a.port`, and
+	 * `tenants.**.rps` matches both `tenants.a.rps` and `tenants.a.b.rps`. */
+	class KeyPattern {
+	public:
+		enum class SegmentType { eLiteral, eOne, eMany };
+
+		struct Segment {
+			SegmentType type;
+			std::string literal;
+		};
+
+	private:
+		std::vector<Segment> segments_;
+		size_t captureCount_;
+
+	public:
+		/** Throws `InvalidKey` if a literal segment is not a valid key,
+		 * or if a segment is empty. */
+		explicit KeyPattern(std::string_view pattern);
+		KeyPattern(const char* pattern): KeyPattern(std::string_view(pattern)) { }
+
+		KeyPattern(const KeyPattern&);
+		KeyPattern(KeyPattern&&) noexcept;
+		~KeyPattern();
+
+		KeyPattern& operator=(const KeyPattern&);
+		KeyPattern& operator=(KeyPattern&&) noexcept;
+
+		const std::vector<Segment>& segments() const noexcept { return segments_; }
+
+		/** The number of wildcard segments. */
+		size_t captureCount() const noexcept { return captureCount_; }
+
+		/** Matches a whole key; each wildcard's capture is appended to
+		 * `capturesDst`, if not null. */
+		bool matches(std::string_view key, std::vector<std::string_view>* capturesDst = nullptr) const;
+	};
+
+
+	/** The entries matched by a query, in key order, as parallel columns.
+	 * Keys and captures refer to the keys of the config, and are only
+	 * valid as long as its entries are. */
+	template<typename T>
+	struct QueryColumn {
+		std::vector<std::string_view> keys;
+
+		/** The segments matched by each wildcard, `captureCount` per
+		 * entry; a `**` capture spans every segment it matched. */
+		std::vector<std::string_view> captures;
+		size_t captureCount = 0;
+
+		std::vector<T> values;
+
+		QueryColumn();
+		QueryColumn(const QueryColumn&);
+		QueryColumn(QueryColumn&&) noexcept;
+		~QueryColumn();
+
+		QueryColumn& operator=(const QueryColumn&);
+		QueryColumn& operator=(QueryColumn&&) noexcept;
+
+		size_t size() const noexcept { return keys.size(); }
+
+		std::span<const std::string_view> capturesOf(size_t index) const noexcept {
+			return std::span<const std::string_view>(captures.data() + (index * captureCount), captureCount);
+		}
+	};
+
+	/* Only instantiated for the types of the query functions. */
+	extern template struct QueryColumn<const RawData*>;
+	extern template struct QueryColumn<int_t>;
+	extern template struct QueryColumn<float_t>;
+	extern template struct QueryColumn<std::string_view>;
+
+	using QueryResult = QueryColumn<const RawData*>;
+
+
+	/** Visits only the subtrees that can match: literal segments narrow
+	 * the range of entries in O(log n), `*` segments skip from one
+	 * subgroup to the next, and only `**` segments visit every entry
+	 * within their group. */
+	QueryResult query(const Config&, const KeyPattern&);
+
+	/** Typed counterparts of `query`, with the same conversions as the
+	 * typed getters: a value that cannot be converted is an InvalidValue
+	 * error. */
+	QueryColumn<int_t>            queryInt(const Config&, const KeyPattern&);
+	QueryColumn<float_t>          queryFloat(const Config&, const KeyPattern&);
+	QueryColumn<std::string_view> queryStringView(const Config&, const KeyPattern&);
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+
+
+namespace apcf {
+
+	/** Holds the current version of a Config, which a writer can replace
+	 * while any number of threads are reading it.
+	 *
+	 * Readers take a Snapshot: this only costs a few atomic operations on
+	 * a hazard slot that each thread reuses, so no lock is taken and no
+	 * shared reference count is touched.
+	 * Replaced versions are destroyed once no snapshot refers to them
+	 * anymore, either by the writer or by a reader releasing the last
+	 * snapshot of one.
+	 *
+	 * Every snapshot must be released before the SharedConfig is
+	 * destroyed. */
+	class SharedConfig {
+	private:
+		struct Slot_;
+
+	public:
+		/** An immutable version of the Config, which is kept alive as
+		 * long as the snapshot is. */
+		class Snapshot {
+		private:
+			friend SharedConfig;
+			SharedConfig* owner_;
+			Slot_* slot_;
+			const Config* cfg_;
+
+			Snapshot(SharedConfig&, Slot_*, const Config*);
+
+		public:
+			Snapshot(const Snapshot&) = delete;
+			Snapshot(Snapshot&&) noexcept;
+			~Snapshot();
+
+			Snapshot& operator=(const Snapshot&) = delete;
+			Snapshot& operator=(Snapshot&&) = delete;
+
+			const Config& get() const noexcept { return *cfg_; }
+			const Config& operator*() const noexcept { return *cfg_; }
+			const Config* operator->() const noexcept { return cfg_; }
+		};
+
+	private:
+		std::atomic<const Config*> current_;
+		std::atomic<Slot_*> slots_;
+		std::atomic<bool> hasRetired_;
+		std::mutex writerMtx_;
+		std::vector<const Config*> retired_;
+		uint64_t id_;
+
+		Slot_* acquireSlot_();
+		void release_(Slot_*) noexcept;
+
+		/* Both functions require `writerMtx_` to be locked: the former
+		 * publishes a new version and retires the current one, the latter
+		 * destroys every retired version that no slot refers to. */
+		void replace_(std::unique_ptr<const Config>);
+		void reclaim_() noexcept;
+
+	public:
+		SharedConfig();
+		explicit SharedConfig(Config);
+
+		SharedConfig(const SharedConfig&) = delete;
+		SharedConfig(SharedConfig&&) = delete;
+		~SharedConfig();
+
+		SharedConfig& operator=(const SharedConfig&) = delete;
+		SharedConfig& operator=(SharedConfig&&) = delete;
+
+		/** Returns the current version; safe to call from any thread. */
+		Snapshot snapshot();
+
+		/** Atomically replaces the current version: snapshots taken
+		 * before the call keep referring to the previous one. */
+		void publish(Config);
+
+		/** Copies the current version, lets `fn` modify the copy, then
+		 * publishes it; concurrent updates are serialized, so that none
+		 * of them is lost. */
+		void update(const std::function<void (Config&)>& fn);
+
+		/** Returns the number of replaced versions that are still
+		 * referred to by a snapshot, and cannot be destroyed yet. */
+		size_t retiredCount();
+	};
+
+}
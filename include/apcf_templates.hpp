@@ -13,6 +13,22 @@ namespace apcf {
 	template<> std::optional<float_t> getCfgValue<float_t>(const Config& cfg, const Key& key) { return cfg.getFloat(key); }
 	template<> std::optional<string_t> getCfgValue<string_t>(const Config& cfg, const Key& key) { return cfg.getString(key); }
 	template<> std::optional<array_span_t> getCfgValue<array_span_t>(const Config& cfg, const Key& key) { return cfg.getArray(key); }
+	template<> std::optional<std::string_view> getCfgValue<std::string_view>(const Config& cfg, const Key& key) { return cfg.getStringView(key); }
+
+	template<typename T> const T* getCfgValuePtr(const Config&, const Key&);
+
+	template<> const bool* getCfgValuePtr<bool>(const Config& cfg, const Key& key) { return cfg.getBoolPtr(key); }
+	template<> const int_t* getCfgValuePtr<int_t>(const Config& cfg, const Key& key) { return cfg.getIntPtr(key); }
+	template<> const float_t* getCfgValuePtr<float_t>(const Config& cfg, const Key& key) { return cfg.getFloatPtr(key); }
+
+	template<typename T> std::vector<std::optional<T>> getCfgValues(const Config&, const KeyBatch&);
+
+	template<> std::vector<std::optional<bool>> getCfgValues<bool>(const Config& cfg, const KeyBatch& keys) { return cfg.getBoolBatch(keys); }
+	template<> std::vector<std::optional<int_t>> getCfgValues<int_t>(const Config& cfg, const KeyBatch& keys) { return cfg.getIntBatch(keys); }
+	template<> std::vector<std::optional<float_t>> getCfgValues<float_t>(const Config& cfg, const KeyBatch& keys) { return cfg.getFloatBatch(keys); }
+	template<> std::vector<std::optional<string_t>> getCfgValues<string_t>(const Config& cfg, const KeyBatch& keys) { return cfg.getStringBatch(keys); }
+	template<> std::vector<std::optional<array_span_t>> getCfgValues<array_span_t>(const Config& cfg, const KeyBatch& keys) { return cfg.getArrayBatch(keys); }
+	template<> std::vector<std::optional<std::string_view>> getCfgValues<std::string_view>(const Config& cfg, const KeyBatch& keys) { return cfg.getStringViewBatch(keys); }
 
 	template<typename T> void setCfgValue(Config&, const Key&, T);
 
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <iterator>
+#include <vector>
+
+
+
+namespace apcf {
+
+	/** An alternative to Config, with its entries stored in a tree of key
+	 * segments: every prefix shared by multiple keys is stored once, and
+	 * operations on whole groups (such as `getSubconfig`) only visit the
+	 * group itself.
+	 *
+	 * Iteration visits the entries in the same (lexical) order as Config. */
+	class TrieConfig {
+	public:
+		/** A node of the tree, which may or may not have a value;
+		 * its children are mapped to their last key segment. */
+		class Node {
+		public:
+			using ChildMap = std::map<std::string, Node, std::less<>>;
+
+		private:
+			friend TrieConfig;
+			ChildMap children_;
+			std::optional<RawData> value_;
+
+		public:
+			const ChildMap& children() const noexcept { return children_; }
+			const RawData* value() const noexcept { return value_.has_value()? &value_.value() : nullptr; }
+		};
+
+		class const_iterator {
+		private:
+			friend TrieConfig;
+
+			struct Frame {
+				const Node* node;
+				Node::ChildMap::const_iterator next;
+				size_t pendingBase;
+			};
+
+			/* The subtree of a node may only be visited after its siblings
+			 * that extend its last segment with a '-', which is the only
+			 * key character that precedes the separator: `pending_` holds
+			 * the nodes whose subtrees have been deferred. */
+			std::vector<Frame> frames_;
+			std::vector<Node::ChildMap::const_iterator> pending_;
+			Key key_;
+			const RawData* value_;
+
+			const_iterator(): value_(nullptr) { }
+			explicit const_iterator(const Node& root);
+
+			void descend_(Node::ChildMap::const_iterator);
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using difference_type = std::ptrdiff_t;
+			using value_type = std::pair<const Key&, const RawData&>;
+			using reference = value_type;
+
+			struct pointer {
+				value_type entry;
+				const value_type* operator->() const noexcept { return &entry; }
+			};
+
+			const_iterator(const const_iterator&);
+			const_iterator(const_iterator&&) noexcept;
+			~const_iterator();
+
+			const_iterator& operator=(const const_iterator&);
+			const_iterator& operator=(const_iterator&&) noexcept;
+
+			reference operator*() const noexcept { return { key_, *value_ }; }
+			pointer operator->() const noexcept { return { **this }; }
+
+			const_iterator& operator++();
+			const_iterator operator++(int) { auto r = *this; ++ *this; return r; }
+
+			bool operator==(const const_iterator& r) const noexcept { return value_ == r.value_; }
+		};
+
+	private:
+		Node root_;
+		size_t size_;
+
+		const Node* findNode_(const Key&) const noexcept;
+		static void pushSegment_(Key&, std::string_view segment);
+		static void truncate_(Key&, size_t depth);
+
+	public:
+		static TrieConfig parse(const std::string& str) { return parse(str.data(), str.size()); }
+		static TrieConfig parse(const char* cStr);
+		static TrieConfig parse(const char* charSeqPtr, size_t length);
+		static TrieConfig read(io::Reader&);
+		static TrieConfig read(io::Reader&& tmp) { auto& tmpProxy = tmp; return read(tmpProxy); }
+		static TrieConfig read(std::istream&);
+		static TrieConfig read(std::istream&, size_t count);
+		static TrieConfig read(std::istream&& tmp) { auto& tmpProxy = tmp; return read(tmpProxy); }
+
+		TrieConfig();
+		TrieConfig(const TrieConfig&);
+		TrieConfig(TrieConfig&&) noexcept;
+		~TrieConfig();
+
+		explicit TrieConfig(const Config&);
+
+		TrieConfig& operator=(const TrieConfig&);
+		TrieConfig& operator=(TrieConfig&&) noexcept;
+
+		/** Copies every entry into a new Config. */
+		Config toConfig() const;
+
+		/** Serializes the entries by walking the tree directly, unless the
+		 * given rules specify a hierarchy or `eExpandKeys`. */
+		std::string serialize(SerializationRules = { }) const;
+		void write(io::Writer&, SerializationRules = { }) const;
+		void write(io::Writer&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+		void write(std::ostream&, SerializationRules = { }) const;
+		void write(std::ostream&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+
+		const_iterator begin() const { return const_iterator(root_); }
+		const_iterator end() const noexcept { return const_iterator(); }
+
+		size_t entryCount() const noexcept { return size_; }
+
+		/** Returns the root of the tree, whose structure mirrors the
+		 * hierarchy of the keys. */
+		const Node& root() const noexcept { return root_; }
+
+		/** Returns the TrieConfig's hierarchy, as a ConfigHierarchy;
+		 * `root()` already exposes the same relationships. */
+		ConfigHierarchy getHierarchy() const;
+
+		/** Filters each key with the given group name,
+		 * removing the latter from the former.
+		 * The group name is followed by an implicit separator. */
+		TrieConfig getSubconfig(const Key& group) const;
+
+		std::optional<const RawData*> get(const Key&) const noexcept;
+		std::optional<bool>           getBool(const Key&) const;
+		std::optional<int_t>          getInt(const Key&) const;
+		std::optional<float_t>        getFloat(const Key&) const;
+		std::optional<string_t>       getString(const Key&) const;
+		std::optional<array_span_t>   getArray(const Key&) const;
+
+		std::optional<std::string_view> getStringView(const Key&) const;
+		const bool*                     getBoolPtr(const Key&) const;
+		const int_t*                    getIntPtr(const Key&) const;
+		const float_t*                  getFloatPtr(const Key&) const;
+
+		void set      (const Key&, RawData) noexcept;
+		void setBool  (const Key&, bool value) noexcept;
+		void setInt   (const Key&, int_t value) noexcept;
+		void setFloat (const Key&, float_t value) noexcept;
+		void setString(const Key&, string_t value) noexcept;
+		void setArray (const Key&, array_t value) noexcept;
+	};
+
+}
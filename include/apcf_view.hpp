@@ -0,0 +1,106 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <iterator>
+
+
+
+namespace apcf {
+
+	/** A read-only view of the entries of a Config within a group, whose
+	 * keys are presented relative to the group name; nothing is copied,
+	 * so the view is only valid as long as the Config is.
+	 *
+	 * Entries added to the Config after the view was created are visible
+	 * through the view. */
+	class ConfigView {
+	public:
+		class const_iterator {
+		private:
+			friend ConfigView;
+			std::map<Key, RawData, std::less<>>::const_iterator cur_;
+			size_t groupDepth_;
+
+			const_iterator(std::map<Key, RawData, std::less<>>::const_iterator cur, size_t groupDepth): cur_(cur), groupDepth_(groupDepth) { }
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using difference_type = std::ptrdiff_t;
+			using value_type = std::pair<KeySpan, const RawData&>;
+			using reference = value_type;
+
+			struct pointer {
+				value_type entry;
+				const value_type* operator->() const noexcept { return &entry; }
+			};
+
+			const_iterator() = default;
+
+			reference operator*() const noexcept {
+				return { cur_->first.segments(groupDepth_, cur_->first.getDepth()), cur_->second };
+			}
+
+			pointer operator->() const noexcept { return { **this }; }
+
+			const_iterator& operator++() noexcept { ++ cur_; return *this; }
+			const_iterator operator++(int) noexcept { auto r = *this; ++ *this; return r; }
+
+			bool operator==(const const_iterator& r) const noexcept { return cur_ == r.cur_; }
+		};
+
+	private:
+		const Config* cfg_;
+		Key group_;
+
+		size_t groupDepth_() const noexcept { return group_.empty()? 0 : group_.getDepth(); }
+
+	public:
+		/** Creates a view of the entries of `cfg` within `group`; the view
+		 * of the empty group contains every entry. */
+		ConfigView(const Config& cfg, Key group);
+
+		const Key& group() const noexcept { return group_; }
+		const Config& config() const noexcept { return *cfg_; }
+
+		/** Copies every entry into a new Config, with relative keys;
+		 * equivalent to `config().getSubconfig(group())`. */
+		Config toConfig() const;
+
+		std::string serialize(SerializationRules = { }) const;
+		void write(io::Writer&, SerializationRules = { }) const;
+		void write(io::Writer&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+		void write(std::ostream&, SerializationRules = { }) const;
+		void write(std::ostream&& tmp, SerializationRules sr = { }) const { auto& tmpProxy = tmp; return write(tmpProxy, sr); }
+
+		/** Each call is a lookup of the group's bounds, in O(log n). */
+		const_iterator begin() const;
+		const_iterator end() const;
+
+		/** Counts the entries of the group, in linear time. */
+		size_t entryCount() const;
+
+		/** Returns the view's hierarchy, with relative keys. */
+		ConfigHierarchy getHierarchy() const;
+
+		/** Returns a view of a subgroup of this view's group. */
+		ConfigView getView(const Key& relGroup) const;
+
+		std::optional<const RawData*> get(const Key&) const;
+
+		/** Like `get`, but ignores the fallbacks of the Config. */
+		std::optional<const RawData*> getDefined(const Key&) const noexcept;
+
+		std::optional<bool>           getBool(const Key&) const;
+		std::optional<int_t>          getInt(const Key&) const;
+		std::optional<float_t>        getFloat(const Key&) const;
+		std::optional<string_t>       getString(const Key&) const;
+		std::optional<array_span_t>   getArray(const Key&) const;
+
+		std::optional<std::string_view> getStringView(const Key&) const;
+		const bool*                     getBoolPtr(const Key&) const;
+		const int_t*                    getIntPtr(const Key&) const;
+		const float_t*                  getFloatPtr(const Key&) const;
+	};
+
+}
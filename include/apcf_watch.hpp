@@ -0,0 +1,126 @@
+#pragma once
+
+#include <apcf.hpp>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <vector>
+
+
+
+#ifdef __linux__
+
+namespace apcf {
+
+	/** The keys of the entries that differ between two versions of a
+	 * config, each vector being sorted. */
+	struct ConfigChanges {
+		std::vector<Key> added;
+		std::vector<Key> removed;
+		std::vector<Key> changed;
+
+		ConfigChanges();
+		ConfigChanges(const ConfigChanges&);
+		ConfigChanges(ConfigChanges&&) noexcept;
+		~ConfigChanges();
+
+		ConfigChanges& operator=(const ConfigChanges&);
+		ConfigChanges& operator=(ConfigChanges&&) noexcept;
+
+		bool empty() const noexcept { return added.empty() && removed.empty() && changed.empty(); }
+	};
+
+
+	/** Reloads config files when they are written, using inotify.
+	 *
+	 * The directory of each file is watched rather than the file itself,
+	 * so that files replaced by a rename (as most editors do) are still
+	 * detected.
+	 * Events are only processed by `poll`, on the calling thread: bursts
+	 * of writes are debounced, then each written file is re-parsed and
+	 * compared with its previous version, and the callbacks are invoked
+	 * with the keys that actually changed.
+	 * If the kernel's event queue overflows, every watched file is
+	 * reloaded, since the lost events cannot be told apart. */
+	class ConfigWatcher {
+	public:
+		using Callback = std::function<void (const std::string& path, const Config& current, const ConfigChanges&)>;
+
+	private:
+		struct File_ {
+			std::string path;
+			std::string name;
+			int watchDescriptor;
+			bool pending;
+			Config cfg;
+
+			File_(std::string path, std::string name, int watchDescriptor, Config);
+			File_(File_&&) noexcept;
+			~File_();
+
+			File_& operator=(File_&&);
+		};
+
+		int fd_;
+		std::chrono::milliseconds debounce_;
+		std::chrono::milliseconds maxDebounce_;
+
+		/* A deque, so that the configs returned by `watch` are never moved. */
+		std::deque<File_> files_;
+		std::vector<Callback> callbacks_;
+
+		const File_* find_(const std::string& path) const noexcept;
+		bool waitEvents_(std::chrono::milliseconds timeout);
+		void readEvents_();
+		size_t reloadPending_();
+
+	public:
+		/** Files are reloaded once no event has been received for
+		 * `debounce` after the first one, or once `maxDebounce` has passed
+		 * since then, even if the files are still being written. */
+		explicit ConfigWatcher(
+			std::chrono::milliseconds debounce = std::chrono::milliseconds(50),
+			std::chrono::milliseconds maxDebounce = std::chrono::milliseconds(1000) );
+
+		ConfigWatcher(const ConfigWatcher&) = delete;
+		ConfigWatcher(ConfigWatcher&&) = delete;
+		~ConfigWatcher();
+
+		ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+		ConfigWatcher& operator=(ConfigWatcher&&) = delete;
+
+		/** Parses the file and starts watching it; watching the same
+		 * path twice has no effect.
+		 * The returned reference stays valid as long as the watcher,
+		 * and always refers to the last loaded version. */
+		const Config& watch(const std::string& path);
+
+		/** Returns the last successfully parsed version of a watched
+		 * file; throws `std::out_of_range` if the file is not watched. */
+		const Config& config(const std::string& path) const;
+
+		/** Callbacks are invoked by `poll`, in the order they were
+		 * added, for each file that changed. */
+		void onChange(Callback);
+
+		/** The inotify file descriptor, which becomes readable when
+		 * `poll` has events to process; it can be added to an event loop. */
+		int fileDescriptor() const noexcept { return fd_; }
+
+		/** Waits up to `timeout` for a watched file to be written (a
+		 * negative timeout waits indefinitely), then reloads every file
+		 * written until the debounce interval passes without events, or
+		 * until the maximum debounce time is reached; files that are
+		 * written after that are reloaded by the next call.
+		 *
+		 * Returns the number of files whose entries changed.
+		 * If a file cannot be parsed, the exception is propagated and
+		 * the file keeps its previous version; files that were not
+		 * reloaded yet are reloaded by the next call. */
+		size_t poll(std::chrono::milliseconds timeout);
+	};
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 
 
 
@@ -103,6 +104,15 @@ namespace apcf {
 			if(err < str.size()) throw InvalidKey(str, err);
 		}
 		std::string::operator=(std::move(str));
+		indexSeparators_();
+	}
+
+
+	Key::Key(Trusted_, std::string str):
+			std::string(std::move(str))
+	{
+		assert(apcf_util::findKeyError(*this) >= size());
+		indexSeparators_();
 	}
 
 
@@ -112,15 +122,16 @@ namespace apcf {
 			auto iter = initLs.begin();
 			auto end = initLs.end();
 			if(initLs.size() > 0) {
-				this->append(*(iter++)); }
+				std::string::append(*(iter++)); }
 			while(iter != end) {
-				this->push_back(GRAMMAR_KEY_SEPARATOR);
-				this->append(*(iter++));
+				std::string::push_back(GRAMMAR_KEY_SEPARATOR);
+				std::string::append(*(iter++));
 			}
 		} {
 			size_t err = apcf_util::findKeyError(*this);
 			if(err < this->size()) throw InvalidKey(*this, err);
 		}
+		indexSeparators_();
 	}
 
 
@@ -133,43 +144,126 @@ namespace apcf {
 				assert(err == size());
 			}
 		#endif
+		indexSeparators_();
+		assert(empty() || (getDepth() == keySpan.getDepth()));
 	}
 
 
-	Key Key::ancestor(size_t offset) const {
-		size_t cursor = size()-1;
-		{
-			size_t separators = 0;
-			if(empty()) return Key();
-			while((separators > offset) && (cursor > 0)) {
-				if((*this)[cursor] == GRAMMAR_KEY_SEPARATOR) {
-					++separators;
-				}
-				--cursor;
-			}
-		} {
-			return std::string(begin(), begin() + cursor + 1);
+	Key::Key(const Key& group, const Key& relKey) {
+		if(group.empty() || relKey.empty()) {
+			*this = group.empty()? relKey : group;
+			return;
+		}
+		size_t relOffset = group.size() + 1;
+		reserve(relOffset + relKey.size());
+		std::string::append(group);
+		std::string::push_back(GRAMMAR_KEY_SEPARATOR);
+		std::string::append(relKey);
+		separatorCount_ = group.separatorCount_ + 1 + relKey.separatorCount_;
+		// Only the stored separators are needed, and those of either key are enough
+		size_t stored = std::min<size_t>(separatorCount_, inlineSeparatorCount);
+		for(size_t i = 0; i < stored; ++i) {
+			if(i < group.separatorCount_) separators_[i] = group.separators_[i];
+			else if(i == group.separatorCount_) separators_[i] = group.size();
+			else separators_[i] = relKey.separators_[i - group.separatorCount_ - 1] + relOffset;
 		}
 	}
 
 
-	size_t Key::getDepth() const {
-		size_t r = 1;
-		for(char c : *this) {
-			r += c == GRAMMAR_KEY_SEPARATOR;
+	Key::Key(const Key&) = default;
+	Key::Key(Key&&) noexcept = default;
+	Key::~Key() = default;
+
+	Key& Key::operator=(const Key&) = default;
+	Key& Key::operator=(Key&&) noexcept = default;
+
+
+	void Key::indexSeparators_() {
+		assert(size() <= std::numeric_limits<separator_offset_t>::max());
+		separatorCount_ = 0;
+		separators_ = { };
+		const char* beg = std::string::data();
+		const char* end = beg + size();
+		const char* cur = beg;
+		while((cur = static_cast<const char*>(std::memchr(cur, GRAMMAR_KEY_SEPARATOR, end - cur))) != nullptr) {
+			if(separatorCount_ < inlineSeparatorCount) separators_[separatorCount_] = cur - beg;
+			++ separatorCount_;
+			++ cur;
 		}
+	}
+
+
+	size_t Key::separator_(size_t index) const noexcept {
+		assert(index < separatorCount_);
+		if(index < inlineSeparatorCount) return separators_[index];
+		const char* beg = std::string::data();
+		const char* end = beg + size();
+		const char* cur = beg + separators_[inlineSeparatorCount - 1];
+		for(size_t i = inlineSeparatorCount - 1; i < index; ++i) {
+			cur = static_cast<const char*>(std::memchr(cur + 1, GRAMMAR_KEY_SEPARATOR, end - (cur + 1)));
+			assert(cur != nullptr);
+		}
+		return cur - beg;
+	}
+
+
+	void Key::pushSegment_(std::string_view segment) {
+		if(! empty()) {
+			if(separatorCount_ < inlineSeparatorCount) separators_[separatorCount_] = size();
+			++ separatorCount_;
+			std::string::push_back(GRAMMAR_KEY_SEPARATOR);
+		}
+		std::string::append(segment);
+	}
+
+
+	void Key::truncate_(size_t depth) {
+		if(depth == 0) {
+			std::string::clear();
+			separatorCount_ = 0;
+		} else if(depth < getDepth()) {
+			std::string::resize(separator_(depth - 1));
+			separatorCount_ = depth - 1;
+		}
+	}
+
+
+	Key Key::ancestor(size_t offset) const {
+		Key r;
+		if(offset >= getDepth()) return r;
+		size_t depth = getDepth() - offset;
+		KeySpan span = segments(0, depth);
+		r.std::string::assign(span.data(), span.size());
+		r.separatorCount_ = depth - 1;
+		std::copy_n(separators_.begin(), std::min<size_t>(depth - 1, inlineSeparatorCount), r.separators_.begin());
 		return r;
 	}
 
 
 	std::string Key::basename() const {
-		size_t cursor = size()-1;
-		if(empty()) return "";
-		while(((*this)[cursor] != GRAMMAR_KEY_SEPARATOR) && (cursor > 0)) {
-			--cursor;
-		}
-		if(cursor > 0) ++cursor;
-		return substr(cursor);
+		KeySpan span = basenameSpan();
+		return std::string(span.data(), span.size());
+	}
+
+
+	KeySpan Key::segments(size_t first, size_t last) const {
+		assert(first <= last);
+		assert(last <= getDepth());
+		if(first >= last) return KeySpan(data() + size(), 0, 1);
+		size_t beg = (first == 0)? 0 : separator_(first-1) + 1;
+		size_t end = (last == getDepth())? size() : separator_(last-1);
+		return KeySpan(data() + beg, end - beg, last - first);
+	}
+
+
+	KeySpan Key::ancestorSpan(size_t offset) const {
+		if(offset >= getDepth()) return KeySpan(data(), 0, 1);
+		return segments(0, getDepth() - offset);
+	}
+
+
+	KeySpan Key::basenameSpan() const {
+		return segments(getDepth() - 1, getDepth());
 	}
 
 
@@ -177,13 +271,24 @@ namespace apcf {
 	KeySpan::KeySpan(): depth_(1) { }
 
 	KeySpan::KeySpan(const Key& key):
-			KeySpan(key.data(), key.size())
+			KeySpan(key.data(), key.size(), key.getDepth())
 	{ }
 
 	KeySpan::KeySpan(const Key& key, size_t end):
-			KeySpan(key.data(), end)
+			std::span<const char>(key.data(), end),
+			depth_(1)
 	{
 		assert(end <= key.size());
+		// Every separator before `end` delimits a segment; only the stored ones are sorted
+		size_t stored = std::min<size_t>(key.separatorCount_, Key::inlineSeparatorCount);
+		auto storedEnd = key.separators_.begin() + stored;
+		auto sepEnd = std::lower_bound(key.separators_.begin(), storedEnd, end);
+		depth_ += sepEnd - key.separators_.begin();
+		if(sepEnd == storedEnd && stored > 0) {
+			// The other separators are counted the same way `Key::separator_` finds them
+			size_t scanBegin = key.separators_[stored - 1] + 1;
+			if(scanBegin < end) depth_ += std::count(key.data() + scanBegin, key.data() + end, GRAMMAR_KEY_SEPARATOR);
+		}
 	}
 
 	KeySpan::KeySpan(const char* data, size_t size):
@@ -198,6 +303,11 @@ namespace apcf {
 		}
 	}
 
+	KeySpan::KeySpan(const char* data, size_t size, size_t depth):
+			std::span<const char>(data, size),
+			depth_(depth)
+	{ }
+
 	bool KeySpan::operator<(KeySpan r) const noexcept {
 		if(size() == r.size()) {
 			return 0 > strncmp(data(), r.data(), size());
@@ -221,6 +331,26 @@ namespace apcf {
 
 
 
+	KeyBatch::KeyBatch() = default;
+
+	KeyBatch::KeyBatch(std::span<const Key> keys):
+			keys_(keys.begin(), keys.end()),
+			positions_(keys.size())
+	{
+		for(size_t i=0; i < positions_.size(); ++i) positions_[i] = i;
+		std::sort(positions_.begin(), positions_.end(), [&keys](size_t l, size_t r) { return keys[l] < keys[r]; });
+		for(size_t i=0; i < positions_.size(); ++i) keys_[i] = keys[positions_[i]];
+	}
+
+	KeyBatch::KeyBatch(const KeyBatch&) = default;
+	KeyBatch::KeyBatch(KeyBatch&&) noexcept = default;
+	KeyBatch::~KeyBatch() = default;
+
+	KeyBatch& KeyBatch::operator=(const KeyBatch&) = default;
+	KeyBatch& KeyBatch::operator=(KeyBatch&&) noexcept = default;
+
+
+
 	RawData::RawData(const char* cStr):
 			type(DataType::eString)
 	{
@@ -318,7 +448,7 @@ namespace apcf {
 	}
 
 
-	RawData::RawData(RawData&& mv):
+	RawData::RawData(RawData&& mv) noexcept:
 			type(mv.type),
 			data(mv.data)
 	{
@@ -333,7 +463,7 @@ namespace apcf {
 		#endif
 	}
 
-	RawData& RawData::operator=(RawData&& mv) {
+	RawData& RawData::operator=(RawData&& mv) noexcept {
 		this->~RawData();
 		return *new (this) RawData(std::move(mv));
 	}
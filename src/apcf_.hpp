@@ -1,10 +1,25 @@
 #pragma once
 
 #include <apcf.hpp>
+#include <apcf_flat.hpp>
+#include <apcf_trie.hpp>
+#include <apcf_view.hpp>
+#include <apcf_bind.hpp>
+#include <apcf_shared.hpp>
+#include <apcf_persistent.hpp>
+#include <apcf_concurrent.hpp>
+#include <apcf_diff.hpp>
+#include <apcf_incremental.hpp>
+#include <apcf_layered.hpp>
+#include <apcf_query.hpp>
+#include <apcf_builder.hpp>
+#include <apcf_watch.hpp>
 #include <apcf_hierarchy.hpp>
 
 #include <limits>
+#include <deque>
 #include <cassert>
+#include <typeindex>
 #include <string>
 #include <map>
 #include <set>
@@ -198,15 +213,156 @@ namespace apcf_util {
 
 
 
+namespace apcf_config {
+
+	/* Conversions shared by the `get*` functions of every kind of config;
+	 * `key` is only used to describe errors. */
+	std::optional<bool>               asBool(std::optional<const apcf::RawData*>, const apcf::Key& key);
+	std::optional<apcf::int_t>        asInt(std::optional<const apcf::RawData*>, const apcf::Key& key);
+	std::optional<apcf::float_t>      asFloat(std::optional<const apcf::RawData*>, const apcf::Key& key);
+	std::optional<apcf::string_t>     asString(std::optional<const apcf::RawData*>, const apcf::Key& key);
+	std::optional<apcf::array_span_t> asArray(std::optional<const apcf::RawData*>, const apcf::Key& key);
+
+	/* Non-converting, non-allocating counterparts of the above. */
+	std::optional<std::string_view> asStringView(std::optional<const apcf::RawData*>, const apcf::Key& key);
+	const bool*                     asBoolPtr(std::optional<const apcf::RawData*>, const apcf::Key& key);
+	const apcf::int_t*              asIntPtr(std::optional<const apcf::RawData*>, const apcf::Key& key);
+	const apcf::float_t*            asFloatPtr(std::optional<const apcf::RawData*>, const apcf::Key& key);
+
+}
+
+
+
+namespace apcf_config {
+
+	/* Hashes keys and prefixes, which can then be looked up as views. */
+	struct PrefixHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>()(key); }
+	};
+
+
+	/* Invokes `fn` with every prefix of the key: the empty one, each
+	 * enclosing group, then the key itself. */
+	template<typename Fn>
+	void forEachPrefix(std::string_view key, Fn&& fn) {
+		fn(std::string_view());
+		for(size_t i = key.find(GRAMMAR_KEY_SEPARATOR); i != key.npos; i = key.find(GRAMMAR_KEY_SEPARATOR, i + 1)) {
+			fn(key.substr(0, i));
+		}
+		fn(key);
+	}
+
+}
+
+
+
+namespace apcf {
+
+	struct Config::Subscriptions_ {
+		struct Subscription {
+			Key prefix;
+			std::shared_ptr<const ChangeCallback> callback;
+
+			Subscription(Key prefix, std::shared_ptr<const ChangeCallback>);
+			Subscription(Subscription&&) noexcept;
+			~Subscription();
+
+			Subscription& operator=(Subscription&&) noexcept;
+		};
+
+		/* Ordered by ID, which is the order of subscription. */
+		std::map<SubscriptionId, Subscription> byId;
+
+		std::unordered_map<Key, std::vector<SubscriptionId>, apcf_config::PrefixHash, std::equal_to<>> byPrefix;
+
+		SubscriptionId nextId = 0;
+
+		Subscriptions_();
+		~Subscriptions_();
+	};
+
+
+	struct Config::Generations_ {
+		struct Memo {
+			uint64_t generation;
+			std::shared_ptr<const void> value;
+		};
+
+		struct Subtree {
+			uint64_t generation;
+			std::unordered_map<std::type_index, Memo> memos;
+
+			explicit Subtree(uint64_t generation);
+			Subtree(Subtree&&) noexcept;
+			~Subtree();
+
+			Subtree& operator=(Subtree&&) noexcept;
+		};
+
+		std::unordered_map<Key, Subtree, apcf_config::PrefixHash, std::equal_to<>> subtrees;
+
+		Generations_();
+		~Generations_();
+	};
+
+
+	struct Config::Fallbacks_ {
+		/* Derived and base groups, in order of declaration. */
+		std::vector<std::pair<Key, Key>> inheritances;
+
+		/* Groups and the names of their default subgroups. */
+		std::vector<std::pair<Key, Key>> groupDefaults;
+
+		/* Maps every defined or inherited key to its value; the views
+		 * refer either to the keys of the Config, or to `inheritedKeys`,
+		 * whose elements never move. */
+		std::unordered_map<std::string_view, const RawData*> table;
+		std::deque<std::string> inheritedKeys;
+
+		/* The generation of the Config the table was built for. */
+		std::optional<uint64_t> tableGeneration;
+
+		Fallbacks_();
+		~Fallbacks_();
+
+		void buildTable(const Config&);
+	};
+
+
+	inline bool Config::isObserved_() const noexcept {
+		return (subscriptions_ != nullptr && ! subscriptions_->byId.empty()) || generations_ != nullptr;
+	}
+
+}
+
+
+
 namespace apcf_parse {
 
 	void fwd(apcf::io::Reader& reader, const std::string& expected);
 
 
+	using Entry = std::pair<apcf::Key, apcf::RawData>;
+	using EntryVector = std::vector<Entry>;
+
+
+	/** Receives the entries of a parse pass, in order of definition,
+	 * in place of `ParseData::entries`. */
+	struct EntrySink {
+		virtual void putEntry(apcf::Key&&, apcf::RawData&&) = 0;
+
+		/** Called after each top-level entry or group, once the
+		 * whitespaces and comments that follow it have been skipped. */
+		virtual void endTopLevelDefinition() { }
+	};
+
+
 	struct ParseData {
-		apcf::Config cfg;
+		EntryVector entries;
 		apcf::io::Reader& src;
 		std::vector<apcf::Key> keyStack;
+		EntrySink* sink = nullptr;
 	};
 
 
@@ -255,7 +411,15 @@ namespace apcf_parse {
 	apcf::RawData parseValue(ParseData&);
 
 
-	apcf::Config parse(ParseData&);
+	/** Appends every parsed entry to `ParseData::entries` (or passes it
+	 * to `ParseData::sink`, if any), in order of definition:
+	 * redefinitions are left to `sortAndDedupe`. */
+	void parse(ParseData&);
+
+	/** Stable-sorts the entries by key, then discards every entry that is
+	 * followed by another one with the same key, so that the last
+	 * definition of a key wins. */
+	void sortAndDedupe(EntryVector&);
 
 }
 
@@ -306,13 +470,13 @@ namespace apcf_serialize {
 
 	void serializeLineEntry(
 			SerializeData& sd,
-			const apcf::Key& key,
+			apcf::KeySpan key,
 			const apcf::RawData& entryValue
 	);
 
 	void serializeLineGroupBeg(
 			SerializeData& sd,
-			const apcf::Key& key
+			apcf::KeySpan key
 	);
 
 	void serializeLineGroupEnd(
@@ -320,17 +484,42 @@ namespace apcf_serialize {
 	);
 
 
+	/** Returns a pointer to the value mapped to the given key,
+	 * or `nullptr` if there is none; every storage type that can be
+	 * serialized has an overload. */
+	const apcf::RawData* findValue(const apcf::Config&, const apcf::Key&);
+	const apcf::RawData* findValue(const apcf::FlatConfig&, const apcf::Key&);
+	const apcf::RawData* findValue(const apcf::TrieConfig&, const apcf::Key&);
+	const apcf::RawData* findValue(const apcf::ConfigView&, const apcf::Key&);
+	const apcf::RawData* findValue(const apcf::PersistentConfig&, const apcf::Key&);
+	const apcf::RawData* findValue(const apcf::LayeredConfig&, const apcf::Key&);
+
+
+	template<typename Storage>
 	struct SerializeHierarchyParams {
 		SerializeData* sd;
-		const std::map<apcf::Key, apcf::RawData>* map;
+		const Storage* storage;
 		const apcf::ConfigHierarchy* hierarchy;
 	};
 
+	/* A node of the hierarchy to serialize, along with its value. */
+	struct HierarchyEntry {
+		apcf::ConfigHierarchy::node_index_t index;
+		apcf::Key key;
+		const apcf::RawData* value;
+	};
+
+	template<typename Storage>
 	void serializeHierarchy(
-			SerializeHierarchyParams& state,
-			const apcf::Key& key, const apcf::Key& parent
+			SerializeHierarchyParams<Storage>& state,
+			const HierarchyEntry& entry, size_t parentDepth
 	);
 
-	void serialize(SerializeData& sd, const std::map<apcf::Key, apcf::RawData>& hierarchyMap);
+	template<typename Storage>
+	void serialize(SerializeData& sd, const Storage& storage);
+
+	/** Equivalent to `serialize(sd, trie)` without a custom hierarchy,
+	 * but walks the tree instead of building one. */
+	void serializeTrie(SerializeData& sd, const apcf::TrieConfig& trie);
 
 }
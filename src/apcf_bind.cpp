@@ -0,0 +1,138 @@
+#include "apcf_.hpp"
+
+#include <apcf_bind.hpp>
+
+#include <algorithm>
+
+
+
+namespace {
+
+	/* Assigns every parsed entry to the member it is bound to, as soon as
+	 * it is parsed. */
+	class BindSink : public apcf_parse::EntrySink {
+	public:
+		const apcf::BindingTable& table;
+		void* dst;
+		std::vector<bool> assigned;
+		apcf::BindReport report;
+
+		BindSink(const apcf::BindingTable& table, void* dst):
+				table(table),
+				dst(dst),
+				assigned(table.size(), false)
+		{ }
+
+		void putEntry(apcf::Key&& key, apcf::RawData&& value) override {
+			size_t index = table.find(key);
+			if(index >= table.size()) {
+				report.unknownKeys.push_back(std::move(key));
+				return;
+			}
+			const auto& field = table[index];
+			void* member = dst;
+			for(auto access : field.path) member = access(member);
+			field.assign(member, std::move(value), key);
+			assigned[index] = true;
+		}
+	};
+
+}
+
+
+
+namespace apcf {
+
+	BindingTable::Field::Field(Key key, std::vector<Accessor> path, Assigner assign):
+			key(std::move(key)),
+			path(std::move(path)),
+			assign(assign)
+	{ }
+
+	BindingTable::Field::Field(const Field&) = default;
+	BindingTable::Field::Field(Field&&) noexcept = default;
+	BindingTable::Field::~Field() = default;
+
+	BindingTable::Field& BindingTable::Field::operator=(const Field&) = default;
+	BindingTable::Field& BindingTable::Field::operator=(Field&&) noexcept = default;
+
+
+	BindingTable::BindingTable() = default;
+	BindingTable::BindingTable(const BindingTable&) = default;
+	BindingTable::BindingTable(BindingTable&&) noexcept = default;
+	BindingTable::~BindingTable() = default;
+
+	BindingTable& BindingTable::operator=(const BindingTable&) = default;
+	BindingTable& BindingTable::operator=(BindingTable&&) noexcept = default;
+
+
+	void BindingTable::addField(Key key, std::vector<Accessor> path, Assigner assign) {
+		fields_.emplace_back(std::move(key), std::move(path), assign);
+	}
+
+
+	void BindingTable::sort() {
+		std::sort(fields_.begin(), fields_.end(), [](const Field& l, const Field& r) { return l.key < r.key; });
+	}
+
+
+	size_t BindingTable::find(const Key& key) const noexcept {
+		auto found = std::lower_bound(fields_.begin(), fields_.end(), key,
+			[](const Field& l, const Key& r) { return l.key < r; });
+		if(found == fields_.end() || found->key != key) return fields_.size();
+		return found - fields_.begin();
+	}
+
+
+	BindReport readBound(const BindingTable& table, void* dst, io::Reader& in) {
+		BindSink sink(table, dst);
+		apcf_parse::ParseData pd = {
+			.entries = { },
+			.src = in,
+			.keyStack = { },
+			.sink = &sink };
+		apcf_parse::parse(pd);
+
+		for(size_t i=0; i < table.size(); ++i) {
+			if(! sink.assigned[i]) sink.report.missingKeys.push_back(table[i].key);
+		}
+		return std::move(sink.report);
+	}
+
+
+	void bindValue(bool& dst, RawData&& value, const Key& key) {
+		dst = apcf_config::asBool(&value, key).value();
+	}
+
+	void bindValue(int_t& dst, RawData&& value, const Key& key) {
+		dst = apcf_config::asInt(&value, key).value();
+	}
+
+	void bindValue(float_t& dst, RawData&& value, const Key& key) {
+		dst = apcf_config::asFloat(&value, key).value();
+	}
+
+	void bindValue(string_t& dst, RawData&& value, const Key& key) {
+		if(value.type == DataType::eString) {
+			dst.assign(value.data.stringValue.data(), value.data.stringValue.length());
+		} else {
+			dst = apcf_config::asString(&value, key).value();
+		}
+	}
+
+	void bindValue(array_t& dst, RawData&& value, const Key&) {
+		dst.clear();
+		if(value.type == DataType::eArray) {
+			auto& array = value.data.arrayValue;
+			dst.reserve(array.size());
+			for(size_t i=0; i < array.size(); ++i) dst.push_back(std::move(array[i]));
+		} else {
+			dst.push_back(std::move(value));
+		}
+	}
+
+	void bindValue(RawData& dst, RawData&& value, const Key&) {
+		dst = std::move(value);
+	}
+
+}
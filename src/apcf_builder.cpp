@@ -0,0 +1,60 @@
+#include "apcf_.hpp"
+
+#include <apcf_builder.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+
+
+namespace apcf {
+
+	ConfigBuilder::ConfigBuilder(KeyCheck keyCheck):
+			keyCheck_(keyCheck)
+	{ }
+
+	ConfigBuilder::ConfigBuilder(const ConfigBuilder&) = default;
+	ConfigBuilder::ConfigBuilder(ConfigBuilder&&) noexcept = default;
+	ConfigBuilder::~ConfigBuilder() = default;
+
+	ConfigBuilder& ConfigBuilder::operator=(const ConfigBuilder&) = default;
+	ConfigBuilder& ConfigBuilder::operator=(ConfigBuilder&&) noexcept = default;
+
+
+	void ConfigBuilder::add(Key key, RawData value) {
+		entries_.emplace_back(std::move(key), std::move(value));
+	}
+
+	void ConfigBuilder::add(std::string key, RawData value) {
+		if(keyCheck_ == KeyCheck::eTrust) {
+			entries_.emplace_back(Key(Key::Trusted_ { }, std::move(key)), std::move(value));
+		} else {
+			entries_.emplace_back(Key(std::move(key)), std::move(value));
+		}
+	}
+
+
+	Config ConfigBuilder::build() {
+		auto entries = std::move(entries_);
+		entries_.clear();
+
+		// Entries are large, sorting their indices moves less memory
+		std::vector<size_t> order;
+		order.resize(entries.size());
+		std::iota(order.begin(), order.end(), size_t(0));
+		auto cmpKeys = [&](size_t l, size_t r) { return entries[l].first < entries[r].first; };
+		if(! std::is_sorted(order.begin(), order.end(), cmpKeys)) {
+			std::stable_sort(order.begin(), order.end(), cmpKeys);
+		}
+
+		// The last of equal keys is the last one added, and every insertion goes right before the end
+		Config r;
+		for(size_t i=0; i < order.size(); ++i) {
+			auto& entry = entries[order[i]];
+			bool redefined = (i+1 < order.size()) && (entry.first == entries[order[i+1]].first);
+			if(! redefined) r.data_.emplace_hint(r.data_.end(), std::move(entry.first), std::move(entry.second));
+		}
+		return r;
+	}
+
+}
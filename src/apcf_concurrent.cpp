@@ -0,0 +1,165 @@
+#include "apcf_.hpp"
+
+#include <apcf_concurrent.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <queue>
+
+
+
+namespace apcf {
+
+	/* Each shard gets its own cache lines, so that locking one does not
+	 * invalidate its neighbours. */
+	struct alignas(64) ConcurrentConfig::Shard_ {
+		mutable std::shared_mutex mtx;
+		std::unordered_map<Key, RawData, KeyHash, std::equal_to<>> entries;
+	};
+
+
+	ConcurrentConfig::ConcurrentConfig(size_t minShardCount):
+			shards_(std::make_unique<Shard_[]>(std::bit_ceil(std::max<size_t>(minShardCount, 1)))),
+			shardBits_(std::bit_width(std::bit_ceil(std::max<size_t>(minShardCount, 1))) - 1)
+	{ }
+
+	ConcurrentConfig::ConcurrentConfig(const Config& cfg, size_t minShardCount):
+			ConcurrentConfig(minShardCount)
+	{
+		for(const auto& entry : cfg) shardOf_(entry.first).entries.emplace(entry.first, entry.second);
+	}
+
+	ConcurrentConfig::ConcurrentConfig(ConcurrentConfig&&) noexcept = default;
+	ConcurrentConfig::~ConcurrentConfig() = default;
+
+	ConcurrentConfig& ConcurrentConfig::operator=(ConcurrentConfig&&) noexcept = default;
+
+
+	ConcurrentConfig::Shard_& ConcurrentConfig::shardOf_(std::string_view key) const noexcept {
+		/* The containers of the shards use the same hash for their buckets:
+		 * the shard is selected by the high bits of a mixed hash instead. */
+		if(shardBits_ == 0) return shards_[0];
+		uint64_t mixed = uint64_t(KeyHash()(key)) * 0x9E3779B97F4A7C15ull;
+		return shards_[mixed >> (64 - shardBits_)];
+	}
+
+
+	size_t ConcurrentConfig::entryCount() const {
+		size_t r = 0;
+		for(size_t i=0; i < shardCount(); ++i) {
+			std::shared_lock lock(shards_[i].mtx);
+			r += shards_[i].entries.size();
+		}
+		return r;
+	}
+
+
+	Config ConcurrentConfig::freeze() {
+		using Run = std::vector<std::pair<Key, RawData>>;
+		constexpr auto cmpKeys = [](const Run::value_type& l, const Run::value_type& r) { return l.first < r.first; };
+
+		std::vector<Run> runs;
+		runs.resize(shardCount());
+		for(size_t i=0; i < shardCount(); ++i) {
+			auto& run = runs[i];
+			{
+				std::unique_lock lock(shards_[i].mtx);
+				auto& entries = shards_[i].entries;
+				run.reserve(entries.size());
+				while(! entries.empty()) {
+					auto node = entries.extract(entries.begin());
+					run.emplace_back(std::move(node.key()), std::move(node.mapped()));
+				}
+			}
+			std::sort(run.begin(), run.end(), cmpKeys);
+		}
+
+		// A key always belongs to the same shard, so the runs have no key in common
+		std::vector<size_t> cursors;
+		cursors.resize(runs.size(), 0);
+		auto cmpRuns = [&](size_t l, size_t r) { return runs[r][cursors[r]].first < runs[l][cursors[l]].first; };
+		std::priority_queue<size_t, std::vector<size_t>, decltype(cmpRuns)> heads(cmpRuns);
+		for(size_t i=0; i < runs.size(); ++i) {
+			if(! runs[i].empty()) heads.push(i);
+		}
+
+		Config r;
+		while(! heads.empty()) {
+			size_t i = heads.top();
+			heads.pop();
+			auto& entry = runs[i][cursors[i]];
+			r.data_.emplace_hint(r.data_.end(), std::move(entry.first), std::move(entry.second));
+			++ cursors[i];
+			if(cursors[i] < runs[i].size()) heads.push(i);
+		}
+		return r;
+	}
+
+
+	std::optional<RawData> ConcurrentConfig::get(const Key& key) const {
+		auto& shard = shardOf_(key);
+		std::shared_lock lock(shard.mtx);
+		auto found = shard.entries.find(key);
+		if(found == shard.entries.end()) return std::nullopt;
+		return found->second;
+	}
+
+	#define GET_LOCKED_(FN_, TYPE_, CONVERSION_) \
+		std::optional<TYPE_> ConcurrentConfig::FN_(const Key& key) const { \
+			auto& shard = shardOf_(key); \
+			std::shared_lock lock(shard.mtx); \
+			auto found = shard.entries.find(key); \
+			if(found == shard.entries.end()) return std::nullopt; \
+			return apcf_config::CONVERSION_(&found->second, key); \
+		}
+	GET_LOCKED_(getBool,   bool,     asBool)
+	GET_LOCKED_(getInt,    int_t,    asInt)
+	GET_LOCKED_(getFloat,  float_t,  asFloat)
+	GET_LOCKED_(getString, string_t, asString)
+	#undef GET_LOCKED_
+
+	std::optional<array_t> ConcurrentConfig::getArray(const Key& key) const {
+		auto& shard = shardOf_(key);
+		std::shared_lock lock(shard.mtx);
+		auto found = shard.entries.find(key);
+		if(found == shard.entries.end()) return std::nullopt;
+		auto span = apcf_config::asArray(&found->second, key).value();
+		return array_t(span.begin(), span.end());
+	}
+
+
+	void ConcurrentConfig::set(Key key, RawData data) {
+		auto& shard = shardOf_(key);
+		std::unique_lock lock(shard.mtx);
+		shard.entries.insert_or_assign(std::move(key), std::move(data));
+	}
+
+	void ConcurrentConfig::setBool(Key key, bool value) {
+		set(std::move(key), RawData(value));
+	}
+
+	void ConcurrentConfig::setInt(Key key, int_t value) {
+		set(std::move(key), RawData(value));
+	}
+
+	void ConcurrentConfig::setFloat(Key key, float_t value) {
+		set(std::move(key), RawData(value));
+	}
+
+	void ConcurrentConfig::setString(Key key, string_t value) {
+		set(std::move(key), RawData(value));
+	}
+
+	void ConcurrentConfig::setArray(Key key, array_t array) {
+		set(std::move(key), RawData::moveArray(array.data(), array.size()));
+	}
+
+
+	bool ConcurrentConfig::erase(const Key& key) {
+		auto& shard = shardOf_(key);
+		std::unique_lock lock(shard.mtx);
+		return shard.entries.erase(key) > 0;
+	}
+
+}
@@ -1,6 +1,6 @@
 #include "apcf_.hpp"
 
-#include <cstring>
+#include <algorithm>
 
 
 
@@ -14,88 +14,57 @@
 
 namespace {
 
-	bool cmpKeyPrefix(const apcf::Key& prefix, const apcf::Key& cmp) {
-		if(cmp.size() < prefix.size() + 1) return false;
-		if(0 != ::strncmp(prefix.data(), cmp.data(), prefix.size())) return false;
-		return cmp[prefix.size()] == '.';
+	/* The key `group + separator + sub`, which can be compared with
+	 * the keys of a Config without being joined first. */
+	struct JoinedKey {
+		std::string_view group;
+		char separator;
+		std::string_view sub;
+	};
+
+	int compareJoinedKey(std::string_view key, const JoinedKey& joined) {
+		size_t groupSize = joined.group.size();
+		size_t cmpSize = std::min(key.size(), groupSize);
+		int cmp = key.substr(0, cmpSize).compare(joined.group.substr(0, cmpSize));
+		if(cmp != 0) return cmp;
+		if(key.size() <= groupSize) return -1;
+		if(key[groupSize] != joined.separator) return (key[groupSize] < joined.separator)? -1 : +1;
+		return key.substr(groupSize + 1).compare(joined.sub);
 	}
 
-}
-
-
-
-namespace apcf {
-
-	void Config::merge(const Config& r) {
-		for(const auto& entry : r.data_) {
-			data_.insert_or_assign(entry.first, entry.second);
-		}
-	}
-
-	void Config::merge(Config&& r) {
-		for(auto& entry : r.data_) {
-			data_.insert_or_assign(std::move(entry.first), std::move(entry.second));
+	bool operator<(const apcf::Key& l, const JoinedKey& r) { return compareJoinedKey(l, r) < 0; }
+	bool operator<(const JoinedKey& l, const apcf::Key& r) { return compareJoinedKey(r, l) > 0; }
+	bool operator==(const apcf::Key& l, const JoinedKey& r) { return compareJoinedKey(l, r) == 0; }
+
+
+	/* Advances `cur` to the first entry of `map` whose key is not less
+	 * than `key`, which must not precede the key of `cur`.
+	 * Close keys (such as ones in the same group) are reached by stepping
+	 * forward, distant ones by a new search, so that merge-joining m
+	 * sorted keys with the map costs O(m + n) when they are dense, and
+	 * still O(m log n) otherwise. */
+	template<typename Map, typename Iter, typename K>
+	Iter seekForward(Map& map, Iter cur, const K& key) {
+		constexpr unsigned maxLinearSteps = 8;
+		auto end = map.end();
+		for(unsigned steps = 0; cur != end && cur->first < key; ++ steps) {
+			if(steps >= maxLinearSteps) return map.lower_bound(key);
+			++ cur;
 		}
+		return cur;
 	}
 
-
-	void Config::mergeAsGroup(const Key& groupKey, const Config& cfg) {
-		for(const auto& entry : cfg) {
-			set(groupKey + '.' + entry.first, entry.second);
-		}
-	}
-
-	void Config::mergeAsGroup(const Key& groupKey, Config&& cfg) {
-		for(const auto& entry : cfg) {
-			set(groupKey + '.' + std::move(entry.first), std::move(entry.second));
-		}
-	}
-
-
-	decltype(Config::data_)::const_iterator Config::begin() const {
-		return data_.begin();
-	}
-
-	decltype(Config::data_)::const_iterator Config::end() const {
-		return data_.end();
-	}
+}
 
 
-	size_t Config::entryCount() const { return data_.size(); }
 
+namespace apcf_config {
 
-	ConfigHierarchy Config::getHierarchy() const {
-		return ConfigHierarchy(data_);
-	}
+	using namespace apcf;
 
 
-	Config Config::getSubconfig(const Key& key) const {
-		Config r;
-		auto cur = data_.lower_bound(key);
-		auto end = data_.end();
-		if(cur != end) {
-			while(cmpKeyPrefix(key, cur->first)) {
-				assert(cur->first.size() > key.size());
-				auto oldSize = cur->first.size();
-				auto newSize = oldSize - (key.size() + 1);
-				r.set(Key(cur->first.data() + oldSize - newSize, newSize), cur->second);
-				++ cur;
-			}
-		}
-		return r;
-	}
-
-
-	std::optional<const RawData*> Config::get(const Key& key) const noexcept {
-		std::optional<const RawData*> r = std::nullopt;
-		auto found = data_.find(key.asString());
-		if(found != data_.end()) r = &found->second;
-		return r;
-	}
-
-	std::optional<bool> Config::getBool(const Key& key) const {
+	std::optional<bool> asBool(std::optional<const RawData*> found, const Key& key) {
 		using namespace std::string_literals;
-		auto found = get(key);
 		if(found.has_value()) {
 			assert((found.value() != nullptr) && (found.value()->type != DataType::eNull));
 			if(found.value()->type != DataType::eBool) {
@@ -109,9 +78,8 @@ namespace apcf {
 		}
 	}
 
-	std::optional<int_t> Config::getInt(const Key& key) const {
+	std::optional<int_t> asInt(std::optional<const RawData*> found, const Key& key) {
 		using namespace std::string_literals;
-		auto found = get(key);
 		if(found.has_value()) {
 			assert((found.value() != nullptr) && (found.value()->type != DataType::eNull));
 			switch(found.value()->type) {
@@ -133,9 +101,8 @@ namespace apcf {
 		}
 	}
 
-	std::optional<float_t> Config::getFloat(const Key& key) const {
+	std::optional<float_t> asFloat(std::optional<const RawData*> found, const Key& key) {
 		using namespace std::string_literals;
-		auto found = get(key);
 		if(found.has_value()) {
 			assert(found.value() != nullptr);
 			switch(found.value()->type) {
@@ -157,9 +124,8 @@ namespace apcf {
 		}
 	}
 
-	std::optional<string_t> Config::getString(const Key& key) const {
+	std::optional<string_t> asString(std::optional<const RawData*> found, const Key& key) {
 		using namespace std::string_literals;
-		auto found = get(key);
 		if(found.has_value()) {
 			assert((found.value() != nullptr) && (found.value()->type != DataType::eNull));
 			const auto& data = found.value()->data;
@@ -195,10 +161,8 @@ namespace apcf {
 		}
 	}
 
-	std::optional<array_span_t> Config::getArray(const Key& key) const {
-		using namespace std::string_literals;
+	std::optional<array_span_t> asArray(std::optional<const RawData*> found, const Key&) {
 		array_span_t r;
-		auto found = get(key);
 		if(found.has_value()) {
 			assert((found.value() != nullptr) && (found.value()->type != DataType::eNull));
 			switch(found.value()->type) {
@@ -219,28 +183,670 @@ namespace apcf {
 	}
 
 
+	std::optional<std::string_view> asStringView(std::optional<const RawData*> found, const Key& key) {
+		using namespace std::string_literals;
+		if(! found.has_value()) return std::nullopt;
+		const RawData& value = *found.value();
+		if(value.type != DataType::eString) {
+			throw InvalidValue(
+				value.serialize(), value.type,
+				INVALID_VALUE_STR(value.type) + " \""s + key.asString() + "\" as a string view");
+		}
+		return std::string_view(value.data.stringValue.data(), value.data.stringValue.length());
+	}
+
+	#define AS_PTR_(FN_, TYPE_, DATA_TYPE_, MEMBER_, DESCRIPTION_) \
+		const TYPE_* FN_(std::optional<const RawData*> found, const Key& key) { \
+			using namespace std::string_literals; \
+			if(! found.has_value()) return nullptr; \
+			const RawData& value = *found.value(); \
+			if(value.type != DataType::DATA_TYPE_) { \
+				throw InvalidValue( \
+					value.serialize(), value.type, \
+					INVALID_VALUE_STR(value.type) + " \""s + key.asString() + "\" as " DESCRIPTION_); \
+			} \
+			return &value.data.MEMBER_; \
+		}
+	AS_PTR_(asBoolPtr,  bool,    eBool,  boolValue,  "a bool value")
+	AS_PTR_(asIntPtr,   int_t,   eInt,   intValue,   "an integer value")
+	AS_PTR_(asFloatPtr, float_t, eFloat, floatValue, "a fractional value")
+	#undef AS_PTR_
+
+}
+
+
+
+namespace apcf {
+
+	/* Collects the keys whose values a modification changes, so that the
+	 * subscriptions and tracked subtrees can be notified once it is
+	 * complete; nothing is collected if there are none. */
+	struct Config::ChangeLog_ {
+		using Iter = decltype(Config::data_)::iterator;
+
+		Config& cfg;
+		bool observed;
+		std::vector<Key> keys;
+
+		explicit ChangeLog_(Config& cfg): cfg(cfg), observed(cfg.isObserved_()) { ++ cfg.generation_; }
+
+		template<typename Value>
+		void assign(Iter entry, Value&& value) {
+			if(observed && ! equivalent(entry->second, value)) keys.push_back(entry->first);
+			entry->second = std::forward<Value>(value);
+		}
+
+		void insert(Iter entry) {
+			if(observed) keys.push_back(entry->first);
+		}
+
+		void remove(decltype(Config::data_)::const_iterator entry) {
+			if(observed) keys.push_back(entry->first);
+		}
+
+		/* The keys must have been collected in order. */
+		void notify() const {
+			if(! keys.empty()) cfg.notify_(keys);
+		}
+
+		/* Returns the keys that replacing the entries of `former` with the
+		 * ones of `latter` changes, if `former` is observed. */
+		static std::vector<Key> between(const Config& former, const Config& latter) {
+			std::vector<Key> r;
+			if(! former.isObserved_()) return r;
+			auto d = diff(former, latter);
+			r.reserve(d.added.size() + d.removed.size() + d.changed.size());
+			for(auto entry : d.added) r.push_back(entry->first);
+			for(auto entry : d.removed) r.push_back(entry->first);
+			for(const auto& entries : d.changed) r.push_back(entries.first->first);
+			std::sort(r.begin(), r.end());
+			return r;
+		}
+
+		/* Returns the keys that moving every entry out of `cfg` removes,
+		 * if `cfg` is observed. */
+		static std::vector<Key> movedOut(const Config& cfg) {
+			std::vector<Key> r;
+			if(! cfg.isObserved_()) return r;
+			r.reserve(cfg.data_.size());
+			for(const auto& entry : cfg.data_) r.push_back(entry.first);
+			return r;
+		}
+
+		static void notifyMovedOut(Config& cfg, const std::vector<Key>& keys) {
+			++ cfg.generation_;
+			if(! keys.empty()) cfg.notify_(keys);
+		}
+
+		/* Invalidates every tracked subtree of a Config whose entries were
+		 * all moved out, without allocating nor invoking any callback. */
+		static void invalidateMovedOut(Config& cfg) noexcept {
+			++ cfg.generation_;
+			if(cfg.generations_ == nullptr) return;
+			for(auto& subtree : cfg.generations_->subtrees) subtree.second.generation = cfg.generation_;
+		}
+	};
+
+
+	Config::Config() = default;
+
+	Config::Config(const Config& cp):
+			data_(cp.data_)
+	{
+		if(cp.isIndexed()) buildIndex();
+	}
+
+	Config::Config(Config&& mv) noexcept:
+			data_(std::move(mv.data_)),
+			index_(std::move(mv.index_)),
+			nodeGeneration_(mv.nodeGeneration_),
+			generation_(mv.generation_)
+	{
+		// The moved-from Config's subscribers are not notified, but its memos are stale
+		mv.clearMovedOut_();
+	}
+
+	Config::~Config() = default;
+
+	Config& Config::operator=(const Config& cp) {
+		if(this != &cp) {
+			auto changed = ChangeLog_::between(*this, cp);
+			data_ = cp.data_;
+			if(cp.isIndexed()) buildIndex();
+			else dropIndex();
+			++ nodeGeneration_;
+			++ generation_;
+			if(! changed.empty()) notify_(changed);
+		}
+		return *this;
+	}
+
+	Config& Config::operator=(Config&& mv) {
+		if(this != &mv) {
+			auto changed = ChangeLog_::between(*this, mv);
+			auto movedOut = ChangeLog_::movedOut(mv);
+			data_ = std::move(mv.data_);
+			index_ = std::move(mv.index_);
+			mv.data_.clear();
+			mv.index_.reset();
+			// Handles resolved by either Config must not mistake one generation for the other
+			nodeGeneration_ = std::max(nodeGeneration_, mv.nodeGeneration_) + 1;
+			++ mv.nodeGeneration_;
+			++ generation_;
+			if(! changed.empty()) notify_(changed);
+			ChangeLog_::notifyMovedOut(mv, movedOut);
+		}
+		return *this;
+	}
+
+
+	void Config::clearMovedOut_() noexcept {
+		data_.clear();
+		index_.reset();
+		++ nodeGeneration_;
+		ChangeLog_::invalidateMovedOut(*this);
+	}
+
+
+	void Config::buildIndex() {
+		Index index;
+		index.reserve(data_.size());
+		for(auto& entry : data_) {
+			index.emplace(std::string_view(entry.first), &entry.second);
+		}
+		index_ = std::move(index);
+	}
+
+	void Config::dropIndex() noexcept {
+		index_.reset();
+	}
+
+
+	void Config::indexEntry_(decltype(data_)::iterator entry) {
+		++ nodeGeneration_;
+		if(index_.has_value()) index_->emplace(std::string_view(entry->first), &entry->second);
+	}
+
+	void Config::unindexEntry_(decltype(data_)::const_iterator entry) {
+		++ nodeGeneration_;
+		if(index_.has_value()) index_->erase(std::string_view(entry->first));
+	}
+
+
+	void Config::merge(const Config& r) {
+		if(&r == this) return;
+		ChangeLog_ changes(*this);
+
+		// Both maps are sorted: every key is inserted right before, or assigned to, the entry found last
+		auto cur = data_.begin();
+		for(const auto& entry : r.data_) {
+			cur = seekForward(data_, cur, entry.first);
+			if(cur != data_.end() && cur->first == entry.first) {
+				changes.assign(cur, entry.second);
+			} else {
+				cur = data_.emplace_hint(cur, entry.first, entry.second);
+				indexEntry_(cur);
+				changes.insert(cur);
+			}
+			++ cur;
+		}
+		changes.notify();
+	}
+
+	void Config::merge(Config&& r) {
+		if(&r == this) return;
+		r.dropIndex();
+		ChangeLog_ changes(*this);
+		auto movedOut = ChangeLog_::movedOut(r);
+		if(data_.empty()) {
+			data_.swap(r.data_);
+			if(isIndexed()) buildIndex();
+			++ nodeGeneration_;
+			++ r.nodeGeneration_;
+			for(auto iter = data_.begin(); iter != data_.end(); ++ iter) changes.insert(iter);
+			changes.notify();
+			ChangeLog_::notifyMovedOut(r, movedOut);
+			return;
+		}
+
+		// Splice the nodes of `r`, so that neither keys nor values are copied
+		auto cur = data_.begin();
+		while(! r.data_.empty()) {
+			auto node = r.data_.extract(r.data_.begin());
+			cur = seekForward(data_, cur, node.key());
+			if(cur != data_.end() && cur->first == node.key()) {
+				changes.assign(cur, std::move(node.mapped()));
+			} else {
+				cur = data_.insert(cur, std::move(node));
+				indexEntry_(cur);
+				changes.insert(cur);
+			}
+			++ cur;
+		}
+		++ r.nodeGeneration_;
+		changes.notify();
+		ChangeLog_::notifyMovedOut(r, movedOut);
+	}
+
+
+	void Config::mergeAsGroup(const Key& groupKey, const Config& cfg) {
+		if(groupKey.empty()) return merge(cfg);
+		// The entries would otherwise be inserted into the map being iterated
+		if(&cfg == this) return mergeAsGroup(groupKey, Config(cfg));
+
+		ChangeLog_ changes(*this);
+
+		// Prefixing the keys preserves their order, and existing keys are compared without being joined
+		auto cur = data_.begin();
+		for(const auto& entry : cfg.data_) {
+			JoinedKey joined = { groupKey, GRAMMAR_KEY_SEPARATOR, entry.first };
+			cur = seekForward(data_, cur, joined);
+			if(cur != data_.end() && cur->first == joined) {
+				changes.assign(cur, entry.second);
+			} else {
+				cur = data_.emplace_hint(cur, Key(groupKey, entry.first), entry.second);
+				indexEntry_(cur);
+				changes.insert(cur);
+			}
+			++ cur;
+		}
+		changes.notify();
+	}
+
+	void Config::mergeAsGroup(const Key& groupKey, Config&& cfg) {
+		if(groupKey.empty()) return merge(std::move(cfg));
+		if(&cfg == this) return mergeAsGroup(groupKey, Config(cfg));
+
+		cfg.dropIndex();
+		ChangeLog_ changes(*this);
+		auto movedOut = ChangeLog_::movedOut(cfg);
+		auto cur = data_.begin();
+		while(! cfg.data_.empty()) {
+			auto node = cfg.data_.extract(cfg.data_.begin());
+			JoinedKey joined = { groupKey, GRAMMAR_KEY_SEPARATOR, node.key() };
+			cur = seekForward(data_, cur, joined);
+			if(cur != data_.end() && cur->first == joined) {
+				changes.assign(cur, std::move(node.mapped()));
+			} else {
+				node.key() = Key(groupKey, node.key());
+				cur = data_.insert(cur, std::move(node));
+				indexEntry_(cur);
+				changes.insert(cur);
+			}
+			++ cur;
+		}
+		++ cfg.nodeGeneration_;
+		changes.notify();
+		ChangeLog_::notifyMovedOut(cfg, movedOut);
+	}
+
+
+	Config::Handle Config::resolve(Key key) const {
+		return Handle(*this, std::move(key));
+	}
+
+
+	bool Config::erase(const Key& key) {
+		auto found = data_.find(key);
+		if(found == data_.end()) return false;
+		ChangeLog_ changes(*this);
+		changes.remove(found);
+		unindexEntry_(found);
+		data_.erase(found);
+		changes.notify();
+		return true;
+	}
+
+
+	size_t Config::eraseSubtree(const Key& group) {
+		ChangeLog_ changes(*this);
+		size_t r = 0;
+		auto end = groupEnd_(group);
+		for(auto cur = groupBegin_(group); cur != end; ++ cur) {
+			changes.remove(cur);
+			unindexEntry_(cur);
+			++ r;
+		}
+		data_.erase(groupBegin_(group), end);
+		changes.notify();
+		return r;
+	}
+
+
+	Config Config::extractSubtree(const Key& group) {
+		Config r;
+		ChangeLog_ changes(*this);
+		size_t groupDepth = group.empty()? 0 : group.getDepth();
+		auto end = groupEnd_(group);
+		auto cur = groupBegin_(group);
+		while(cur != end) {
+			auto next = std::next(cur);
+			changes.remove(cur);
+			unindexEntry_(cur);
+			auto node = data_.extract(cur);
+			node.key() = Key(node.key().segments(groupDepth, node.key().getDepth()));
+			r.data_.insert(r.data_.end(), std::move(node));
+			cur = next;
+		}
+		changes.notify();
+		return r;
+	}
+
+
+	size_t Config::moveSubtree(const Key& from, const Key& to) {
+		if(from == to) return 0;
+		ChangeLog_ changes(*this);
+		size_t fromDepth = from.empty()? 0 : from.getDepth();
+
+		// Every node is extracted first, since the groups may overlap
+		std::vector<decltype(data_)::node_type> nodes;
+		auto end = groupEnd_(from);
+		auto cur = groupBegin_(from);
+		while(cur != end) {
+			auto next = std::next(cur);
+			changes.remove(cur);
+			unindexEntry_(cur);
+			nodes.push_back(data_.extract(cur));
+			cur = next;
+		}
+
+		// Re-keying preserves the order of the nodes, so they are inserted in a single ordered pass
+		auto dst = data_.begin();
+		for(auto& node : nodes) {
+			Key relKey = Key(node.key().segments(fromDepth, node.key().getDepth()));
+			node.key() = to.empty()? std::move(relKey) : Key(to, relKey);
+			dst = seekForward(data_, dst, node.key());
+			if(dst != data_.end() && dst->first == node.key()) {
+				changes.assign(dst, std::move(node.mapped()));
+			} else {
+				dst = data_.insert(dst, std::move(node));
+				indexEntry_(dst);
+				changes.insert(dst);
+			}
+			++ dst;
+		}
+
+		std::sort(changes.keys.begin(), changes.keys.end());
+		changes.keys.erase(std::unique(changes.keys.begin(), changes.keys.end()), changes.keys.end());
+		changes.notify();
+		return nodes.size();
+	}
+
+
+	decltype(Config::data_)::const_iterator Config::begin() const {
+		return data_.begin();
+	}
+
+	decltype(Config::data_)::const_iterator Config::end() const {
+		return data_.end();
+	}
+
+
+	size_t Config::entryCount() const { return data_.size(); }
+
+
+	ConfigHierarchy Config::getHierarchy() const {
+		return ConfigHierarchy(*this);
+	}
+
+
+	decltype(Config::data_)::const_iterator Config::groupBegin_(const Key& group) const {
+		if(group.empty()) return data_.begin();
+		// Every key within the group follows "<group>."
+		return data_.lower_bound(JoinedKey { group, GRAMMAR_KEY_SEPARATOR, { } });
+	}
+
+	decltype(Config::data_)::const_iterator Config::groupEnd_(const Key& group) const {
+		if(group.empty()) return data_.end();
+		// ... and precedes "<group>/", since '/' follows the separator
+		static_assert(GRAMMAR_KEY_SEPARATOR + 1 == '/');
+		return data_.lower_bound(JoinedKey { group, GRAMMAR_KEY_SEPARATOR + 1, { } });
+	}
+
+	const RawData* Config::findInGroup_(const Key& group, const Key& relKey) const {
+		if(group.empty()) return get(relKey).value_or(nullptr);
+		if(fallbacks_ != nullptr) [[unlikely]] return getWithFallbacks_(Key(group, relKey));
+		return findDefinedInGroup_(group, relKey);
+	}
+
+	const RawData* Config::findDefinedInGroup_(const Key& group, const Key& relKey) const noexcept {
+		if(group.empty()) return getDefined(relKey).value_or(nullptr);
+		auto found = data_.find(JoinedKey { group, GRAMMAR_KEY_SEPARATOR, relKey });
+		return (found == data_.end())? nullptr : &found->second;
+	}
+
+
+	Config Config::getSubconfig(const Key& group) const {
+		Config r;
+		size_t groupDepth = group.empty()? 0 : group.getDepth();
+		auto end = groupEnd_(group);
+		for(auto cur = groupBegin_(group); cur != end; ++ cur) {
+			const Key& key = cur->first;
+			r.data_.emplace_hint(r.data_.end(), Key(key.segments(groupDepth, key.getDepth())), cur->second);
+		}
+		return r;
+	}
+
+
+	std::optional<const RawData*> Config::get(const Key& key) const {
+		if(fallbacks_ != nullptr) [[unlikely]] {
+			const RawData* found = getWithFallbacks_(key);
+			if(found == nullptr) return std::nullopt;
+			return found;
+		}
+		return getDefined(key);
+	}
+
+	std::optional<const RawData*> Config::getDefined(const Key& key) const noexcept {
+		std::optional<const RawData*> r = std::nullopt;
+		if(index_.has_value()) {
+			auto found = index_->find(std::string_view(key));
+			if(found != index_->end()) r = found->second;
+		} else {
+			auto found = data_.find(key);
+			if(found != data_.end()) r = &found->second;
+		}
+		return r;
+	}
+
+	std::optional<bool> Config::getBool(const Key& key) const {
+		return apcf_config::asBool(get(key), key);
+	}
+
+	std::optional<int_t> Config::getInt(const Key& key) const {
+		return apcf_config::asInt(get(key), key);
+	}
+
+	std::optional<float_t> Config::getFloat(const Key& key) const {
+		return apcf_config::asFloat(get(key), key);
+	}
+
+	std::optional<string_t> Config::getString(const Key& key) const {
+		return apcf_config::asString(get(key), key);
+	}
+
+	std::optional<array_span_t> Config::getArray(const Key& key) const {
+		return apcf_config::asArray(get(key), key);
+	}
+
+
+	std::optional<std::string_view> Config::getStringView(const Key& key) const {
+		return apcf_config::asStringView(get(key), key);
+	}
+
+	const bool* Config::getBoolPtr(const Key& key) const {
+		return apcf_config::asBoolPtr(get(key), key);
+	}
+
+	const int_t* Config::getIntPtr(const Key& key) const {
+		return apcf_config::asIntPtr(get(key), key);
+	}
+
+	const float_t* Config::getFloatPtr(const Key& key) const {
+		return apcf_config::asFloatPtr(get(key), key);
+	}
+
+
+	void Config::getBatch(const KeyBatch& batch, std::span<const RawData*> dst) const {
+		assert(dst.size() == batch.size());
+		auto keys = batch.sortedKeys();
+
+		if(fallbacks_ != nullptr) [[unlikely]] {
+			for(size_t i=0; i < keys.size(); ++i) dst[batch.positionOf(i)] = getWithFallbacks_(keys[i]);
+			return;
+		}
+
+		if(index_.has_value()) {
+			for(size_t i=0; i < keys.size(); ++i) {
+				auto found = index_->find(std::string_view(keys[i]));
+				dst[batch.positionOf(i)] = (found == index_->end())? nullptr : found->second;
+			}
+			return;
+		}
+
+		// Merge-join the sorted keys with the entries
+		auto cur = data_.begin();
+		auto end = data_.end();
+		for(size_t i=0; i < keys.size(); ++i) {
+			const Key& key = keys[i];
+			cur = seekForward(data_, cur, key);
+			bool found = (cur != end) && (cur->first == key);
+			dst[batch.positionOf(i)] = found? &cur->second : nullptr;
+		}
+	}
+
+	std::vector<const RawData*> Config::getBatch(const KeyBatch& batch) const {
+		std::vector<const RawData*> r;
+		r.resize(batch.size());
+		getBatch(batch, r);
+		return r;
+	}
+
+	#define GET_TYPED_BATCH_(FN_, TYPE_, CONVERSION_) \
+		std::vector<std::optional<TYPE_>> Config::FN_(const KeyBatch& batch) const { \
+			auto values = getBatch(batch); \
+			auto keys = batch.sortedKeys(); \
+			std::vector<std::optional<TYPE_>> r; \
+			r.resize(batch.size()); \
+			for(size_t i=0; i < keys.size(); ++i) { \
+				size_t pos = batch.positionOf(i); \
+				const RawData* value = values[pos]; \
+				if(value != nullptr) r[pos] = apcf_config::CONVERSION_(value, keys[i]); \
+			} \
+			return r; \
+		}
+	GET_TYPED_BATCH_(getBoolBatch,   bool,         asBool)
+	GET_TYPED_BATCH_(getIntBatch,    int_t,        asInt)
+	GET_TYPED_BATCH_(getFloatBatch,  float_t,      asFloat)
+	GET_TYPED_BATCH_(getStringBatch, string_t,     asString)
+	GET_TYPED_BATCH_(getArrayBatch,  array_span_t, asArray)
+	GET_TYPED_BATCH_(getStringViewBatch, std::string_view, asStringView)
+	#undef GET_TYPED_BATCH_
+
+
 	void Config::set(Key key, RawData data) noexcept {
-		data_[key] = std::move(data);
+		if(isObserved_()) [[unlikely]] {
+			ChangeLog_ changes(*this);
+			auto found = data_.find(key);
+			if(found != data_.end()) {
+				changes.assign(found, std::move(data));
+			} else {
+				found = data_.emplace(std::move(key), std::move(data)).first;
+				indexEntry_(found);
+				changes.insert(found);
+			}
+			changes.notify();
+			return;
+		}
+		++ generation_;
+		auto ins = data_.insert_or_assign(std::move(key), std::move(data));
+		if(ins.second) indexEntry_(ins.first);
+	}
+
+	Config::Handle::Handle(const Config& cfg, Key key):
+			cfg_(&cfg),
+			key_(std::move(key))
+	{
+		refresh_();
+	}
+
+	Config::Handle::Handle(const Handle&) = default;
+	Config::Handle::Handle(Handle&&) noexcept = default;
+	Config::Handle::~Handle() = default;
+
+	Config::Handle& Config::Handle::operator=(const Handle&) = default;
+	Config::Handle& Config::Handle::operator=(Handle&&) noexcept = default;
+
+
+	std::optional<const RawData*> Config::Handle::found_() const {
+		auto r = get();
+		if(r == nullptr) return std::nullopt;
+		return r;
+	}
+
+
+	void Config::Handle::refresh_() const {
+		value_ = cfg_->get(key_).value_or(nullptr);
+		generation_ = cfg_->nodeGeneration_;
+	}
+
+
+	std::optional<bool> Config::Handle::getBool() const {
+		return apcf_config::asBool(found_(), key_);
+	}
+
+	std::optional<int_t> Config::Handle::getInt() const {
+		return apcf_config::asInt(found_(), key_);
+	}
+
+	std::optional<float_t> Config::Handle::getFloat() const {
+		return apcf_config::asFloat(found_(), key_);
+	}
+
+	std::optional<string_t> Config::Handle::getString() const {
+		return apcf_config::asString(found_(), key_);
 	}
 
+	std::optional<array_span_t> Config::Handle::getArray() const {
+		return apcf_config::asArray(found_(), key_);
+	}
+
+
+	std::optional<std::string_view> Config::Handle::getStringView() const {
+		return apcf_config::asStringView(found_(), key_);
+	}
+
+	const bool* Config::Handle::getBoolPtr() const {
+		return apcf_config::asBoolPtr(found_(), key_);
+	}
+
+	const int_t* Config::Handle::getIntPtr() const {
+		return apcf_config::asIntPtr(found_(), key_);
+	}
+
+	const float_t* Config::Handle::getFloatPtr() const {
+		return apcf_config::asFloatPtr(found_(), key_);
+	}
+
+
 	void Config::setBool(Key key, bool value) noexcept {
-		data_[key] = RawData(value);
+		set(std::move(key), RawData(value));
 	}
 
 	void Config::setInt(Key key, int_t value) noexcept {
-		data_[key] = RawData(value);
+		set(std::move(key), RawData(value));
 	}
 
 	void Config::setFloat(Key key, float_t value) noexcept {
-		data_[key] = RawData(value);
+		set(std::move(key), RawData(value));
 	}
 
 	void Config::setString(Key key, string_t value) noexcept {
-		data_[key] = RawData(value);
+		set(std::move(key), RawData(value));
 	}
 
 	void Config::setArray(Key key, array_t array) noexcept {
-		data_[key] = RawData::moveArray(array.data(), array.size());
+		set(std::move(key), RawData::moveArray(array.data(), array.size()));
 	}
 
 }
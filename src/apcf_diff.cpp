@@ -0,0 +1,85 @@
+#include "apcf_.hpp"
+
+#include <apcf_diff.hpp>
+
+#include <cmath>
+#include <cstring>
+
+
+
+namespace apcf {
+
+	ConfigDiff::ConfigDiff() = default;
+	ConfigDiff::ConfigDiff(const ConfigDiff&) = default;
+	ConfigDiff::ConfigDiff(ConfigDiff&&) noexcept = default;
+	ConfigDiff::~ConfigDiff() = default;
+
+	ConfigDiff& ConfigDiff::operator=(const ConfigDiff&) = default;
+	ConfigDiff& ConfigDiff::operator=(ConfigDiff&&) noexcept = default;
+
+
+	bool equivalent(const RawData& l, const RawData& r) noexcept {
+		if(l.type != r.type) return false;
+		switch(l.type) {
+			default: [[fallthrough]];
+			case DataType::eNull: return true;
+			case DataType::eBool: return l.data.boolValue == r.data.boolValue;
+			case DataType::eInt: return l.data.intValue == r.data.intValue;
+			case DataType::eFloat: {
+				auto lf = l.data.floatValue;
+				auto rf = r.data.floatValue;
+				return (lf == rf) || (std::isnan(lf) && std::isnan(rf));
+			}
+			case DataType::eString: {
+				const auto& ls = l.data.stringValue;
+				const auto& rs = r.data.stringValue;
+				if(ls.length() != rs.length()) return false;
+				return (ls.data() == rs.data()) || (0 == memcmp(ls.data(), rs.data(), ls.length()));
+			}
+			case DataType::eArray: {
+				const auto& la = l.data.arrayValue;
+				const auto& ra = r.data.arrayValue;
+				if(la.size() != ra.size()) return false;
+				if(la.data() == ra.data()) return true;
+				for(size_t i=0; i < la.size(); ++i) {
+					if(! equivalent(la[i], ra[i])) return false;
+				}
+				return true;
+			}
+		}
+	}
+
+
+	ConfigDiff diff(const Config& former, const Config& latter) {
+		return diff(former, latter, Key());
+	}
+
+
+	ConfigDiff diff(const Config& former, const Config& latter, const Key& group) {
+		ConfigDiff r;
+		if(&former == &latter) return r;
+		auto formerIter = former.groupBegin_(group);
+		auto formerEnd  = former.groupEnd_(group);
+		auto latterIter = latter.groupBegin_(group);
+		auto latterEnd  = latter.groupEnd_(group);
+
+		while(formerIter != formerEnd && latterIter != latterEnd) {
+			int cmp = formerIter->first.compare(latterIter->first);
+			if(cmp < 0) {
+				r.removed.push_back(&*formerIter);
+				++ formerIter;
+			} else if(cmp > 0) {
+				r.added.push_back(&*latterIter);
+				++ latterIter;
+			} else {
+				if(! equivalent(formerIter->second, latterIter->second)) r.changed.emplace_back(&*formerIter, &*latterIter);
+				++ formerIter;
+				++ latterIter;
+			}
+		}
+		for(; formerIter != formerEnd; ++ formerIter) r.removed.push_back(&*formerIter);
+		for(; latterIter != latterEnd; ++ latterIter) r.added.push_back(&*latterIter);
+		return r;
+	}
+
+}
@@ -0,0 +1,254 @@
+#include "apcf_.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+
+
+namespace {
+
+	/* Resolves the entries that each group inherits from its bases, then
+	 * from their own bases, depth first; every group is visited once per
+	 * derived group, so that cycles resolve the same way from any of
+	 * their groups. */
+	class InheritanceResolver {
+	public:
+		using GroupRange = std::pair<
+			std::map<apcf::Key, apcf::RawData, std::less<>>::const_iterator,
+			std::map<apcf::Key, apcf::RawData, std::less<>>::const_iterator >;
+
+		std::unordered_map<std::string, std::vector<std::string>> bases;
+		std::unordered_map<std::string_view, const apcf::RawData*>& table;
+		std::deque<std::string>& inheritedKeys;
+		std::function<GroupRange (const std::string&)> groupRange;
+
+		InheritanceResolver(
+				std::unordered_map<std::string_view, const apcf::RawData*>& table,
+				std::deque<std::string>& inheritedKeys,
+				std::function<GroupRange (const std::string&)> groupRange
+		):
+				table(table),
+				inheritedKeys(inheritedKeys),
+				groupRange(std::move(groupRange))
+		{ }
+
+		void addBase(std::string derived, std::string base) {
+			auto& groupBases = bases[std::move(derived)];
+			if(std::find(groupBases.begin(), groupBases.end(), base) == groupBases.end()) groupBases.push_back(std::move(base));
+		}
+
+		void resolveAll() {
+			std::unordered_set<std::string_view> visited;
+			for(const auto& derived : bases) {
+				visited.clear();
+				visited.insert(derived.first);
+				inheritFrom(derived.first, derived.second, visited);
+			}
+		}
+
+	private:
+		void inherit(const std::string& group, std::string_view relKey, const apcf::RawData* value) {
+			std::string key;
+			key.reserve(group.size() + 1 + relKey.size());
+			key.append(group);
+			key.push_back(GRAMMAR_KEY_SEPARATOR);
+			key.append(relKey);
+			if(table.contains(key)) return;
+			const auto& stored = inheritedKeys.emplace_back(std::move(key));
+			table.emplace(std::string_view(stored), value);
+		}
+
+		void inheritFrom(const std::string& group, const std::vector<std::string>& groupBases, std::unordered_set<std::string_view>& visited) {
+			for(const auto& base : groupBases) {
+				if(! visited.insert(base).second) continue;
+				auto range = groupRange(base);
+				for(auto cur = range.first; cur != range.second; ++ cur) {
+					inherit(group, std::string_view(cur->first).substr(base.size() + 1), &cur->second);
+				}
+				auto baseBases = bases.find(base);
+				if(baseBases != bases.end()) inheritFrom(group, baseBases->second, visited);
+			}
+		}
+	};
+
+
+	bool isWithinGroup(std::string_view key, std::string_view group) {
+		if(group.empty()) return ! key.empty();
+		return (key.size() > group.size()) && key.starts_with(group) && (key[group.size()] == GRAMMAR_KEY_SEPARATOR);
+	}
+
+
+	/* Moves a key from one group to another, given the key relative to
+	 * the former with its leading separator. */
+	std::string regroupKey(std::string_view group, std::string_view separatedRelKey) {
+		if(group.empty()) return std::string(separatedRelKey.substr(1));
+		std::string r;
+		r.reserve(group.size() + separatedRelKey.size());
+		r.append(group);
+		r.append(separatedRelKey);
+		return r;
+	}
+
+}
+
+
+
+namespace apcf {
+
+	Config::Fallbacks_::Fallbacks_() = default;
+	Config::Fallbacks_::~Fallbacks_() = default;
+
+
+	void Config::Fallbacks_::buildTable(const Config& cfg) {
+		table.clear();
+		inheritedKeys.clear();
+		table.reserve(cfg.data_.size());
+		for(const auto& entry : cfg.data_) table.emplace(std::string_view(entry.first), &entry.second);
+
+		InheritanceResolver resolver(table, inheritedKeys, [&](const std::string& group) {
+			return InheritanceResolver::GroupRange(cfg.groupBegin_(Key(group)), cfg.groupEnd_(Key(group)));
+		});
+
+		// Explicit inheritance is declared first, so that it takes precedence
+		for(const auto& inheritance : inheritances) resolver.addBase(inheritance.first, inheritance.second);
+		for(const auto& groupDefault : groupDefaults) {
+			const auto& group = groupDefault.first;
+			const auto& defaultName = groupDefault.second;
+			auto defaultGroup = std::string(Key(group, defaultName));
+			size_t offset = group.empty()? 0 : group.size() + 1;
+			auto end = cfg.groupEnd_(group);
+			for(auto cur = cfg.groupBegin_(group); cur != end; ++ cur) {
+				auto relKey = std::string_view(cur->first).substr(offset);
+				size_t childSize = relKey.find(GRAMMAR_KEY_SEPARATOR);
+				if(childSize == relKey.npos) continue; // Not a group
+				if(relKey.substr(0, childSize) == defaultName) continue;
+				resolver.addBase(std::string(std::string_view(cur->first).substr(0, offset + childSize)), defaultGroup);
+			}
+		}
+		resolver.resolveAll();
+		tableGeneration = cfg.nodeGeneration_;
+	}
+
+
+	void Config::addGroupFallback(Key group, Key defaultName) {
+		if(fallbacks_ == nullptr) fallbacks_ = std::make_unique<Fallbacks_>();
+		fallbacks_->groupDefaults.emplace_back(std::move(group), std::move(defaultName));
+		fallbacks_->tableGeneration.reset();
+		++ nodeGeneration_;
+	}
+
+
+	void Config::addInheritance(Key derived, Key base) {
+		if(fallbacks_ == nullptr) fallbacks_ = std::make_unique<Fallbacks_>();
+		fallbacks_->inheritances.emplace_back(std::move(derived), std::move(base));
+		fallbacks_->tableGeneration.reset();
+		++ nodeGeneration_;
+	}
+
+
+	void Config::clearFallbacks() noexcept {
+		fallbacks_.reset();
+		++ nodeGeneration_;
+	}
+
+
+	void Config::resolveFallbacks() const {
+		// The table refers to the values, so only adding or removing entries outdates it
+		if(fallbacks_ == nullptr || fallbacks_->tableGeneration == nodeGeneration_) return;
+		fallbacks_->buildTable(*this);
+	}
+
+
+	std::vector<Key> Config::withFallbackDependents_(const std::vector<Key>& changedKeys) const {
+		resolveFallbacks();
+		const auto& fb = *fallbacks_;
+		std::vector<Key> r = changedKeys;
+		std::unordered_set<std::string> visited(changedKeys.begin(), changedKeys.end());
+
+		/* Each changed key is paired with its current value, if it still
+		 * exists: keys that fall back to it only change if they still
+		 * resolve to it. */
+		std::vector<std::pair<std::string, const RawData*>> pending;
+		for(const auto& key : changedKeys) {
+			auto found = data_.find(key);
+			pending.emplace_back(key, (found == data_.end())? nullptr : &found->second);
+		}
+
+		auto addDependent = [&](std::string key, const RawData* source) {
+			if(visited.contains(key) || data_.contains(key)) return;
+			if(source != nullptr && getWithFallbacks_(key) != source) return;
+			visited.insert(key);
+			r.emplace_back(key);
+			pending.emplace_back(std::move(key), source);
+		};
+
+		while(! pending.empty()) {
+			auto [key, source] = std::move(pending.back());
+			pending.pop_back();
+
+			for(const auto& inheritance : fb.inheritances) {
+				const auto& base = inheritance.second;
+				if(! isWithinGroup(key, base)) continue;
+				auto separatedRelKey = base.empty()? "." + key : key.substr(base.size());
+				addDependent(regroupKey(inheritance.first, separatedRelKey), source);
+			}
+
+			for(const auto& groupDefault : fb.groupDefaults) {
+				const auto& group = groupDefault.first;
+				const auto& defaultName = groupDefault.second;
+				auto defaultGroup = std::string(Key(group, defaultName));
+				if(! isWithinGroup(key, defaultGroup)) continue;
+				auto separatedRelKey = std::string_view(key).substr(defaultGroup.size());
+				size_t offset = group.empty()? 0 : group.size() + 1;
+
+				// Every other subgroup falls back, including ones that define nothing but are observed
+				auto addSubgroup = [&](std::string_view within) {
+					if(! isWithinGroup(within, group)) return;
+					auto child = within.substr(offset);
+					child = child.substr(0, child.find(GRAMMAR_KEY_SEPARATOR));
+					if(child.empty() || child == std::string_view(defaultName)) return;
+					addDependent(regroupKey(within.substr(0, offset + child.size()), separatedRelKey), source);
+				};
+				auto end = groupEnd_(group);
+				for(auto cur = groupBegin_(group); cur != end; ++ cur) {
+					std::string_view entryKey = cur->first;
+					if(entryKey.find(GRAMMAR_KEY_SEPARATOR, offset) == entryKey.npos) continue; // Not a subgroup
+					addSubgroup(entryKey);
+				}
+				if(subscriptions_ != nullptr) for(const auto& prefix : subscriptions_->byPrefix) addSubgroup(prefix.first);
+				if(generations_ != nullptr) for(const auto& subtree : generations_->subtrees) addSubgroup(subtree.first);
+			}
+		}
+
+		std::sort(r.begin(), r.end());
+		return r;
+	}
+
+
+	const RawData* Config::getWithFallbacks_(std::string_view key) const {
+		resolveFallbacks();
+		const auto& fb = *fallbacks_;
+		auto found = fb.table.find(key);
+		if(found != fb.table.end()) return found->second;
+
+		// Groups that define nothing are not in the table, but still fall back to their default group
+		std::string fallbackKey;
+		for(const auto& groupDefault : fb.groupDefaults) {
+			const auto& group = groupDefault.first;
+			size_t offset = 0;
+			if(! group.empty()) {
+				if(! key.starts_with(group) || key.size() <= group.size() || key[group.size()] != GRAMMAR_KEY_SEPARATOR) continue;
+				offset = group.size() + 1;
+			}
+			size_t childEnd = key.find(GRAMMAR_KEY_SEPARATOR, offset);
+			if(childEnd == key.npos) continue;
+			fallbackKey.assign(key.substr(0, offset));
+			fallbackKey.append(groupDefault.second);
+			fallbackKey.append(key.substr(childEnd));
+			auto fallback = fb.table.find(std::string_view(fallbackKey));
+			if(fallback != fb.table.end()) return fallback->second;
+		}
+		return nullptr;
+	}
+
+}
@@ -0,0 +1,246 @@
+#include "apcf_.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+namespace {
+
+	/* Buffered insertions are merged once there are more than this many of
+	 * them, and their number squared exceeds the number of merged entries. */
+	constexpr size_t minDeltaMergeSize = 16;
+
+
+	template<typename KeyVector>
+	std::optional<size_t> findKeyIndex(const KeyVector& keys, const apcf::Key& key) {
+		auto found = std::lower_bound(keys.begin(), keys.end(), key);
+		if(found == keys.end() || *found != key) return std::nullopt;
+		return size_t(found - keys.begin());
+	}
+
+}
+
+
+
+namespace apcf {
+
+	using namespace apcf_parse;
+
+
+	FlatConfig::FlatConfig() = default;
+	FlatConfig::FlatConfig(const FlatConfig&) = default;
+	FlatConfig::FlatConfig(FlatConfig&&) noexcept = default;
+	FlatConfig::~FlatConfig() = default;
+
+	FlatConfig& FlatConfig::operator=(const FlatConfig&) = default;
+	FlatConfig& FlatConfig::operator=(FlatConfig&&) noexcept = default;
+
+
+	FlatConfig FlatConfig::parse(const char* cStr) {
+		return parse(cStr, strlen(cStr));
+	}
+
+	FlatConfig FlatConfig::parse(const char* charSeqPtr, size_t length) {
+		auto src = io::StringReader(std::span<const char>(charSeqPtr, length));
+		return read(src);
+	}
+
+	FlatConfig FlatConfig::read(io::Reader& in) {
+		ParseData pd = {
+			.entries = { },
+			.src = in,
+			.keyStack = { } };
+		apcf_parse::parse(pd);
+		sortAndDedupe(pd.entries);
+
+		FlatConfig r;
+		r.keys_.reserve(pd.entries.size());
+		r.values_.reserve(pd.entries.size());
+		for(auto& entry : pd.entries) {
+			r.keys_.push_back(std::move(entry.first));
+			r.values_.push_back(std::move(entry.second));
+		}
+		return r;
+	}
+
+	FlatConfig FlatConfig::read(std::istream& in) {
+		return read(in, std::numeric_limits<size_t>::max());
+	}
+
+	FlatConfig FlatConfig::read(std::istream& in, size_t count) {
+		auto src = io::StdStreamReader(in, count);
+		return read(src);
+	}
+
+
+	FlatConfig::FlatConfig(const Config& cfg) {
+		keys_.reserve(cfg.entryCount());
+		values_.reserve(cfg.entryCount());
+		for(const auto& entry : cfg) {
+			keys_.push_back(entry.first);
+			values_.push_back(entry.second);
+		}
+	}
+
+	FlatConfig::FlatConfig(Config&& cfg) {
+		cfg.dropIndex();
+		keys_.reserve(cfg.entryCount());
+		values_.reserve(cfg.entryCount());
+		while(! cfg.data_.empty()) {
+			auto node = cfg.data_.extract(cfg.data_.begin());
+			keys_.push_back(std::move(node.key()));
+			values_.push_back(std::move(node.mapped()));
+		}
+		// As with a move construction, handles and memos of `cfg` must not refer to the extracted nodes
+		cfg.clearMovedOut_();
+	}
+
+
+	Config FlatConfig::toConfig() const& {
+		Config r;
+		for(const auto& entry : *this) {
+			r.data_.emplace_hint(r.data_.end(), entry.first, entry.second);
+		}
+		return r;
+	}
+
+	Config FlatConfig::toConfig() && {
+		compact();
+		Config r;
+		for(size_t i=0; i < keys_.size(); ++i) {
+			r.data_.emplace_hint(r.data_.end(), std::move(keys_[i]), std::move(values_[i]));
+		}
+		keys_.clear();
+		values_.clear();
+		return r;
+	}
+
+
+	ConfigHierarchy FlatConfig::getHierarchy() const {
+		return ConfigHierarchy(*this);
+	}
+
+
+	void FlatConfig::mergeDelta_() {
+		// Merge backwards, so that no element is overwritten before being moved
+		size_t mainCur = keys_.size();
+		size_t deltaCur = deltaKeys_.size();
+		size_t dst = mainCur + deltaCur;
+		keys_.resize(dst);
+		values_.resize(dst);
+		while(deltaCur > 0) {
+			-- dst;
+			if((mainCur > 0) && (deltaKeys_[deltaCur-1] < keys_[mainCur-1])) {
+				-- mainCur;
+				keys_[dst] = std::move(keys_[mainCur]);
+				values_[dst] = std::move(values_[mainCur]);
+			} else {
+				-- deltaCur;
+				keys_[dst] = std::move(deltaKeys_[deltaCur]);
+				values_[dst] = std::move(deltaValues_[deltaCur]);
+			}
+		}
+		deltaKeys_.clear();
+		deltaValues_.clear();
+	}
+
+
+	void FlatConfig::compact() {
+		if(! deltaKeys_.empty()) mergeDelta_();
+	}
+
+
+	std::optional<const RawData*> FlatConfig::get(const Key& key) const noexcept {
+		auto found = findKeyIndex(keys_, key);
+		if(found.has_value()) return &values_[found.value()];
+		if(! deltaKeys_.empty()) {
+			found = findKeyIndex(deltaKeys_, key);
+			if(found.has_value()) return &deltaValues_[found.value()];
+		}
+		return std::nullopt;
+	}
+
+	std::optional<bool> FlatConfig::getBool(const Key& key) const {
+		return apcf_config::asBool(get(key), key);
+	}
+
+	std::optional<int_t> FlatConfig::getInt(const Key& key) const {
+		return apcf_config::asInt(get(key), key);
+	}
+
+	std::optional<float_t> FlatConfig::getFloat(const Key& key) const {
+		return apcf_config::asFloat(get(key), key);
+	}
+
+	std::optional<string_t> FlatConfig::getString(const Key& key) const {
+		return apcf_config::asString(get(key), key);
+	}
+
+	std::optional<array_span_t> FlatConfig::getArray(const Key& key) const {
+		return apcf_config::asArray(get(key), key);
+	}
+
+
+	std::optional<std::string_view> FlatConfig::getStringView(const Key& key) const {
+		return apcf_config::asStringView(get(key), key);
+	}
+
+	const bool* FlatConfig::getBoolPtr(const Key& key) const {
+		return apcf_config::asBoolPtr(get(key), key);
+	}
+
+	const int_t* FlatConfig::getIntPtr(const Key& key) const {
+		return apcf_config::asIntPtr(get(key), key);
+	}
+
+	const float_t* FlatConfig::getFloatPtr(const Key& key) const {
+		return apcf_config::asFloatPtr(get(key), key);
+	}
+
+
+	void FlatConfig::set(Key key, RawData data) noexcept {
+		{ // Existing keys are assigned in place
+			auto found = findKeyIndex(keys_, key);
+			if(found.has_value()) {
+				values_[found.value()] = std::move(data);
+				return;
+			}
+		}
+
+		auto deltaPos = std::lower_bound(deltaKeys_.begin(), deltaKeys_.end(), key);
+		size_t deltaIdx = deltaPos - deltaKeys_.begin();
+		if(deltaPos != deltaKeys_.end() && *deltaPos == key) {
+			deltaValues_[deltaIdx] = std::move(data);
+			return;
+		}
+		deltaKeys_.insert(deltaPos, std::move(key));
+		deltaValues_.insert(deltaValues_.begin() + deltaIdx, std::move(data));
+
+		size_t deltaSize = deltaKeys_.size();
+		if((deltaSize > minDeltaMergeSize) && (deltaSize * deltaSize > keys_.size())) {
+			mergeDelta_();
+		}
+	}
+
+	void FlatConfig::setBool(Key key, bool value) noexcept {
+		set(std::move(key), RawData(value));
+	}
+
+	void FlatConfig::setInt(Key key, int_t value) noexcept {
+		set(std::move(key), RawData(value));
+	}
+
+	void FlatConfig::setFloat(Key key, float_t value) noexcept {
+		set(std::move(key), RawData(value));
+	}
+
+	void FlatConfig::setString(Key key, string_t value) noexcept {
+		set(std::move(key), RawData(value));
+	}
+
+	void FlatConfig::setArray(Key key, array_t array) noexcept {
+		set(std::move(key), RawData::moveArray(array.data(), array.size()));
+	}
+
+}
@@ -1,39 +1,42 @@
 #include "apcf_.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
 
 
 namespace {
 
-	struct AutocompleteRecursiveState {
-		const apcf::ConfigHierarchy* hierarchy;
-		const apcf::Key* returnKey;
-
-		bool recurse() {
-			const auto& subkeys = hierarchy->getSubkeys(*returnKey);
-			if(subkeys.size() == 1) {
-				returnKey = &(*subkeys.begin());
-				return true;
-			} else {
-				return false;
-			}
-		}
+	using node_index_t = apcf::ConfigHierarchy::node_index_t;
 
-		AutocompleteRecursiveState(
-				const apcf::ConfigHierarchy& hierarchy,
-				const apcf::Key& key
-		):
-				hierarchy(&hierarchy),
-				returnKey(&key)
-		{
-			while(recurse()) {
-				// NOP
-			}
-		}
 
-		operator const apcf::Key&() const {
-			return *returnKey;
-		}
-	};
+	/* Entries of views have KeySpan keys, which are viewed the same way
+	 * as Key instances. */
+	std::string_view entryKeyView(const std::string& key) { return key; }
+	std::string_view entryKeyView(apcf::KeySpan key) { return std::string_view(key.data(), key.size()); }
+
+
+	/* Returns the number of leading segments shared by both keys. */
+	size_t sharedDepth(std::string_view prev, std::string_view key) {
+		if(prev.empty()) return 0;
+		auto mismatch = std::mismatch(prev.begin(), prev.end(), key.begin(), key.end());
+		size_t r = std::count(prev.begin(), mismatch.first, GRAMMAR_KEY_SEPARATOR);
+		bool prevSegmentEnds = (mismatch.first  == prev.end()) || (*mismatch.first  == GRAMMAR_KEY_SEPARATOR);
+		bool keySegmentEnds  = (mismatch.second == key.end())  || (*mismatch.second == GRAMMAR_KEY_SEPARATOR);
+		return r + (prevSegmentEnds && keySegmentEnds);
+	}
+
+
+	/* A sibling whose name is followed by a hyphen precedes the
+	 * separator, so in sorted keys "a-b.c" lies between "a" and "a.c":
+	 * the node of "a" may then be reopened later. */
+	bool mayBeReopenedAfter(std::string_view pendingName, std::string_view name) {
+		return
+			(name.size() > pendingName.size()) &&
+			(name[pendingName.size()] == '-') &&
+			(name.substr(0, pendingName.size()) == pendingName);
+	}
 
 }
 
@@ -41,90 +44,238 @@ namespace {
 
 namespace apcf {
 
-	ConfigHierarchy::ConfigHierarchy(const std::map<Key, RawData>& cfg) {
-		for(const auto& entry : cfg) {
-			putKey(entry.first);
+	ConfigHierarchy::ConfigHierarchy():
+			nodes_({ Node { 0, 0, 0, 0, 0, 0 } })
+	{ }
+
+	ConfigHierarchy::ConfigHierarchy(const ConfigHierarchy&) = default;
+	ConfigHierarchy::ConfigHierarchy(ConfigHierarchy&&) noexcept = default;
+	ConfigHierarchy::~ConfigHierarchy() = default;
+
+	ConfigHierarchy& ConfigHierarchy::operator=(const ConfigHierarchy&) = default;
+	ConfigHierarchy& ConfigHierarchy::operator=(ConfigHierarchy&&) noexcept = default;
+
+
+	#define BUILD_FROM_ENTRIES_(STORAGE_) \
+		ConfigHierarchy::ConfigHierarchy(const STORAGE_& cfg) { \
+			build_(cfg, [](const auto& entry) { return entryKeyView(entry.first); }); \
 		}
+		BUILD_FROM_ENTRIES_(Config)
+		BUILD_FROM_ENTRIES_(FlatConfig)
+		BUILD_FROM_ENTRIES_(TrieConfig)
+		BUILD_FROM_ENTRIES_(ConfigView)
+		BUILD_FROM_ENTRIES_(PersistentConfig)
+		BUILD_FROM_ENTRIES_(LayeredConfig)
+	#undef BUILD_FROM_ENTRIES_
+
+	ConfigHierarchy::ConfigHierarchy(const std::map<Key, RawData>& map) {
+		build_(map, [](const auto& entry) { return entryKeyView(entry.first); });
 	}
 
+	ConfigHierarchy::ConfigHierarchy(std::vector<Key> keys) {
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		build_(keys, [](const Key& key) { return std::string_view(key); });
+	}
 
-	void ConfigHierarchy::putKey(const Key& key) {
-		constexpr auto splitKey = [](const Key& key) {
-			constexpr size_t keyBasenameSizeHeuristic = 5;
-			std::vector<KeySpan> r;
-			r.reserve(key.size() / keyBasenameSizeHeuristic);
-			const char* beg = key.data();
-			const char* end = key.data() + key.size();
-			const char* cur = beg;
-
-			assert(beg != end);
-			while(cur != end) {
-				++ cur;
-				while(cur != end && *cur != GRAMMAR_KEY_SEPARATOR) {
-					++ cur;
+
+	template<typename Range, typename GetKey>
+	void ConfigHierarchy::build_(const Range& range, GetKey&& getKey) {
+		names_.clear();
+		nodes_.clear();
+		children_.clear();
+		compressedChildren_.clear();
+		nodes_.push_back(Node { 0, 0, 0, 0, 0, 0 });
+
+		std::vector<node_index_t> parents = { 0 };
+
+		// The nodes of the last key, by depth
+		std::vector<node_index_t> path = { 0 };
+
+		/* Childless nodes of the current parents, by depth, that may get
+		 * children after their siblings; see `mayBeReopenedAfter`. */
+		std::vector<std::vector<node_index_t>> pendingLeaves;
+
+		auto nodeName = [&](node_index_t index) {
+			const auto& node = nodes_[index];
+			return std::string_view(names_.data() + node.nameBegin, node.nameSize);
+		};
+
+		// Offsets are 32 bits wide, which is checked as they grow
+		constexpr size_t maxNodeIndex = std::numeric_limits<node_index_t>::max();
+
+		for(const auto& entry : range) {
+			std::string_view key = getKey(entry);
+			if(key.empty()) continue;
+			size_t depth = sharedDepth(nodeName(path.back()), key);
+			path.resize(depth + 1);
+
+			// Skip the segments of the nodes that already exist, which may be all of them
+			size_t segmentBegin = 0;
+			for(size_t i = 0; i < depth; ++i) segmentBegin = std::min(key.find(GRAMMAR_KEY_SEPARATOR, segmentBegin), key.size()) + 1;
+			size_t nameBegin = names_.size();
+			bool isKeyCopied = false;
+
+			while(segmentBegin <= key.size()) {
+				size_t segmentEnd = std::min(key.find(GRAMMAR_KEY_SEPARATOR, segmentBegin), key.size());
+				bool isLeaf = segmentEnd == key.size();
+				auto name = key.substr(0, segmentEnd);
+				++ depth;
+				if(pendingLeaves.size() <= depth) pendingLeaves.resize(depth + 1);
+				auto& pending = pendingLeaves[depth];
+
+				node_index_t index = node_index_t(nodes_.size());
+				while(! pending.empty()) {
+					auto pendingName = nodeName(pending.back());
+					if(pendingName == name) {
+						index = pending.back();
+						pending.pop_back();
+						break;
+					}
+					if(mayBeReopenedAfter(pendingName, name)) break;
+					pending.pop_back();
 				}
-				r.push_back(KeySpan(beg, size_t(cur-beg)));
+
+				if(index == nodes_.size()) {
+					if(! isKeyCopied) {
+						if(key.size() > maxNodeIndex - names_.size()) throw std::length_error("too many key characters for a ConfigHierarchy");
+						names_.append(key);
+						isKeyCopied = true;
+					}
+					if(nodes_.size() >= maxNodeIndex) throw std::length_error("too many keys for a ConfigHierarchy");
+					nodes_.push_back(Node { node_index_t(nameBegin), node_index_t(segmentEnd), node_index_t(depth), 0, 0, 0 });
+					parents.push_back(path.back());
+					if(isLeaf) pending.push_back(index);
+				}
+				path.push_back(index);
+				if(pendingLeaves.size() > depth + 1) pendingLeaves[depth + 1].clear();
+				segmentBegin = segmentEnd + 1;
 			}
+		}
 
-			return r;
-		};
+		// Lay the children of each node out contiguously, counting them first
+		for(size_t i = 1; i < nodes_.size(); ++i) ++ nodes_[parents[i]].childrenEnd;
+		node_index_t offset = 0;
+		for(auto& node : nodes_) {
+			node.childrenBegin = offset;
+			offset += node.childrenEnd;
+			node.childrenEnd = node.childrenBegin;
+		}
+		children_.resize(nodes_.size() - 1);
+		for(size_t i = 1; i < nodes_.size(); ++i) children_[nodes_[parents[i]].childrenEnd ++] = node_index_t(i);
 
-		Key lastKey = { };
-		auto insertKey = [&](Key dstKeySpan) {
-			tree_[lastKey].insert(dstKeySpan);
-			lastKey = std::move(dstKeySpan);
-		};
+		// Siblings are already sorted, unless a hyphen (see `mayBeReopenedAfter`) got in the way
+		auto nameLess = [&](node_index_t l, node_index_t r) { return nodeName(l) < nodeName(r); };
+		for(const auto& node : nodes_) {
+			auto begin = children_.begin() + node.childrenBegin;
+			auto end = children_.begin() + node.childrenEnd;
+			if(! std::is_sorted(begin, end, nameLess)) std::sort(begin, end, nameLess);
+		}
 
-		auto split = splitKey(key);
-		size_t size = split.size();
-		for(size_t i=0; i < size; ++i) {
-			insertKey(Key(split[i]));
+		// Children always follow their parents, so chains can be compressed from the last node up
+		for(size_t i = nodes_.size(); i > 0; -- i) {
+			auto& node = nodes_[i - 1];
+			bool hasSingleChild = node.childrenEnd - node.childrenBegin == 1;
+			node.autocompleted = hasSingleChild? nodes_[children_[node.childrenBegin]].autocompleted : node_index_t(i - 1);
 		}
+		compressedChildren_.reserve(children_.size());
+		for(auto child : children_) compressedChildren_.push_back(nodes_[child].autocompleted);
 	}
 
 
-	const std::set<Key>& ConfigHierarchy::getSubkeys(const Key& ref) const {
-		static const std::set<Key> emptySet = { };
-		auto found = tree_.find(ref);
-		if(found == tree_.end()) return emptySet;
-		return found->second;
-	}
-
-
-	bool ConfigHierarchy::collapse_(KeySpan ref, KeySpan parent) {
-		/* Recursive condition on `n` (number of subkeys mapped to `ref`)
-		 * n=0  =>  Return value is false; end of recursion branch.
-		 * n=1  =>  Return value is true; if possible, move the subkey mapping to `parent`.
-		 * n>0  =>  Return value is true; recursively call `collapse` on every subkey. */
-		if(ref.empty()) return false;
-		auto subkeys0set = &getSubkeys(Key(ref));
-		bool r = false;
-		if(! subkeys0set->empty()) {
-			std::vector<Key> subkeys0 = apcf_util::setToVec(*subkeys0set);
-			if(subkeys0.size() == 1) {
-				auto subkey0 = *subkeys0.begin();
-				tree_[Key(parent)].insert(subkey0);
-				tree_.erase(Key(ref));
-				collapse_(KeySpan(subkey0), parent);
-				r = true;
-			} else {
-				for(const auto& subkey0 : subkeys0) {
-					r = collapse_(KeySpan(subkey0), ref) || r;
-				}
-			}
+	std::vector<std::string> ConfigHierarchy::leafKeys_() const {
+		std::vector<std::string> r;
+		for(size_t i = 1; i < nodes_.size(); ++i) {
+			const auto& node = nodes_[i];
+			if(node.childrenBegin == node.childrenEnd) r.emplace_back(names_.data() + node.nameBegin, node.nameSize);
 		}
 		return r;
 	}
 
 
-	const Key& ConfigHierarchy::autocomplete(const Key& base) const {
-		if(base.empty()) return base;
-		auto subkeys = getSubkeys(base);
-		if(subkeys.size() == 1) {
-			return AutocompleteRecursiveState(*this, base);
-		} else {
-			return base;
+	void ConfigHierarchy::putKey(const Key& key) {
+		auto keys = leafKeys_();
+		keys.push_back(key);
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		build_(keys, [](const std::string& key) { return std::string_view(key); });
+	}
+
+
+	KeySpan ConfigHierarchy::nodeKey(node_index_t index) const noexcept {
+		if(index == 0) return KeySpan();
+		const auto& node = nodes_[index];
+		return KeySpan(names_.data() + node.nameBegin, node.nameSize, node.depth);
+	}
+
+
+	std::optional<ConfigHierarchy::node_index_t> ConfigHierarchy::findNode(KeySpan keySpan) const noexcept {
+		auto key = std::string_view(keySpan.data(), keySpan.size());
+		node_index_t r = rootIndex;
+		if(key.empty()) return r;
+		size_t segmentBegin = 0;
+		while(segmentBegin <= key.size()) {
+			size_t segmentEnd = std::min(key.find(GRAMMAR_KEY_SEPARATOR, segmentBegin), key.size());
+			auto name = key.substr(0, segmentEnd);
+			const auto& node = nodes_[r];
+			auto begin = children_.begin() + node.childrenBegin;
+			auto end = children_.begin() + node.childrenEnd;
+			auto found = std::lower_bound(begin, end, name, [&](node_index_t index, std::string_view target) {
+				const auto& child = nodes_[index];
+				return std::string_view(names_.data() + child.nameBegin, child.nameSize) < target;
+			});
+			if(found == end) return std::nullopt;
+			const auto& child = nodes_[*found];
+			if(std::string_view(names_.data() + child.nameBegin, child.nameSize) != name) return std::nullopt;
+			r = *found;
+			segmentBegin = segmentEnd + 1;
 		}
+		return r;
+	}
+
+
+	ConfigHierarchy::Subkeys ConfigHierarchy::getSubkeys(const Key& key) const {
+		return getSubkeys(KeySpan(key));
+	}
+
+	ConfigHierarchy::Subkeys ConfigHierarchy::getSubkeys(KeySpan key) const {
+		auto index = findNode(key);
+		if(! index.has_value()) return Subkeys();
+		return getSubkeys(*index);
+	}
+
+	ConfigHierarchy::Subkeys ConfigHierarchy::getSubkeys(node_index_t index) const noexcept {
+		const auto& node = nodes_[index];
+		return Subkeys(this, children_.data() + node.childrenBegin, children_.data() + node.childrenEnd);
+	}
+
+
+	ConfigHierarchy::Subkeys ConfigHierarchy::getCompressedSubkeys(const Key& key) const {
+		return getCompressedSubkeys(KeySpan(key));
+	}
+
+	ConfigHierarchy::Subkeys ConfigHierarchy::getCompressedSubkeys(KeySpan key) const {
+		auto index = findNode(key);
+		if(! index.has_value()) return Subkeys();
+		return getCompressedSubkeys(*index);
+	}
+
+	ConfigHierarchy::Subkeys ConfigHierarchy::getCompressedSubkeys(node_index_t index) const noexcept {
+		const auto& node = nodes_[index];
+		return Subkeys(this, compressedChildren_.data() + node.childrenBegin, compressedChildren_.data() + node.childrenEnd);
+	}
+
+
+	KeySpan ConfigHierarchy::autocomplete(const Key& base) const {
+		return autocomplete(KeySpan(base));
+	}
+
+	KeySpan ConfigHierarchy::autocomplete(KeySpan base) const {
+		if(base.empty()) return base;
+		auto index = findNode(base);
+		if(! index.has_value()) return base;
+		auto completed = nodes_[*index].autocompleted;
+		return (completed == *index)? base : nodeKey(completed);
 	}
 
 }
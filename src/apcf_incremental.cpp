@@ -0,0 +1,358 @@
+#include "apcf_.hpp"
+
+#include <apcf_incremental.hpp>
+
+#include <algorithm>
+
+
+
+namespace {
+
+	using Segment = apcf::IncrementalConfig::Segment;
+
+
+	/* Collects the entries of a parse pass, and the keys of each top-level
+	 * definition separately. */
+	class SegmentingSink : public apcf_parse::EntrySink {
+	public:
+		const apcf::io::StringReader& reader;
+		size_t offset;
+		size_t segmentBegin;
+		std::vector<apcf::Key> segmentKeys;
+		std::vector<Segment> segments;
+		apcf_parse::EntryVector entries;
+
+		SegmentingSink(const apcf::io::StringReader& reader, size_t offset):
+				reader(reader),
+				offset(offset),
+				segmentBegin(0)
+		{ }
+
+		void putEntry(apcf::Key&& key, apcf::RawData&& value) override {
+			segmentKeys.push_back(key);
+			entries.emplace_back(std::move(key), std::move(value));
+		}
+
+		void endTopLevelDefinition() override {
+			std::sort(segmentKeys.begin(), segmentKeys.end());
+			segmentKeys.erase(std::unique(segmentKeys.begin(), segmentKeys.end()), segmentKeys.end());
+			segments.emplace_back(offset + segmentBegin, std::move(segmentKeys));
+			segmentKeys.clear();
+			segmentBegin = reader.cursor;
+		}
+	};
+
+
+	/* Parses a sequence of top-level definitions: the segments begin at
+	 * `offset`, and the entries are sorted with the last definitions of
+	 * their keys. */
+	void parseSegments(std::string_view text, size_t offset, std::vector<Segment>* segments, apcf_parse::EntryVector* entries) {
+		auto src = apcf::io::StringReader(std::span<const char>(text.data(), text.size()));
+		SegmentingSink sink(src, offset);
+		apcf_parse::ParseData pd = {
+			.entries = { },
+			.src = src,
+			.keyStack = { },
+			.sink = &sink };
+		apcf_parse::parse(pd);
+		apcf_parse::sortAndDedupe(sink.entries);
+		*segments = std::move(sink.segments);
+		*entries = std::move(sink.entries);
+	}
+
+
+	/* Returns whether the text, which must begin outside of any string
+	 * or comment, ends within a comment: the text that follows it would
+	 * then be part of the comment. */
+	bool endsWithinComment(std::string_view text) {
+		enum class State { eCode, eString, eLineComment, eBlockComment };
+		auto state = State::eCode;
+		auto nextIs = [&](size_t i, char c) { return (i + 1 < text.size()) && (text[i + 1] == c); };
+		for(size_t i = 0; i < text.size(); ++i) {
+			char c = text[i];
+			switch(state) {
+				case State::eCode:
+					if(c == GRAMMAR_STRING_DELIM) {
+						state = State::eString;
+					} else if(c == GRAMMAR_COMMENT_EXTREME) {
+						if(nextIs(i, GRAMMAR_COMMENT_SL_MIDDLE)) { state = State::eLineComment; ++ i; }
+						else if(nextIs(i, GRAMMAR_COMMENT_ML_MIDDLE)) { state = State::eBlockComment; ++ i; }
+					}
+					break;
+				case State::eString:
+					if(c == GRAMMAR_STRING_ESCAPE) ++ i;
+					else if(c == GRAMMAR_STRING_DELIM) state = State::eCode;
+					break;
+				case State::eLineComment:
+					if(c == GRAMMAR_NEWLINE) state = State::eCode;
+					break;
+				case State::eBlockComment:
+					if(c == GRAMMAR_COMMENT_ML_MIDDLE && nextIs(i, GRAMMAR_COMMENT_EXTREME)) { state = State::eCode; ++ i; }
+					break;
+			}
+		}
+		return (state == State::eLineComment) || (state == State::eBlockComment);
+	}
+
+
+	bool segmentDefines(const Segment& segment, std::string_view key) {
+		return std::binary_search(segment.keys.begin(), segment.keys.end(), key);
+	}
+
+}
+
+
+
+namespace apcf {
+
+	IncrementalConfig::Segment::Segment(size_t begin, std::vector<Key> keys):
+			begin(begin),
+			keys(std::move(keys))
+	{ }
+
+	IncrementalConfig::Segment::Segment(const Segment&) = default;
+	IncrementalConfig::Segment::Segment(Segment&&) noexcept = default;
+	IncrementalConfig::Segment::~Segment() = default;
+
+	IncrementalConfig::Segment& IncrementalConfig::Segment::operator=(const Segment&) = default;
+	IncrementalConfig::Segment& IncrementalConfig::Segment::operator=(Segment&&) noexcept = default;
+
+
+	IncrementalConfig::IncrementalConfig() = default;
+
+	IncrementalConfig::IncrementalConfig(std::string text) {
+		parseAll_(std::move(text));
+	}
+
+	IncrementalConfig::IncrementalConfig(const IncrementalConfig& cp):
+			text_(cp.text_),
+			cfg_(cp.cfg_),
+			segments_(cp.segments_)
+	{
+		// The views must refer to the keys of the copy
+		redefinitions_.reserve(cp.redefinitions_.size());
+		for(const auto& redef : cp.redefinitions_) {
+			redefinitions_.emplace(std::string_view(cfg_.data_.find(redef.first)->first), redef.second);
+		}
+	}
+
+	IncrementalConfig::IncrementalConfig(IncrementalConfig&&) noexcept = default;
+	IncrementalConfig::~IncrementalConfig() = default;
+
+	IncrementalConfig& IncrementalConfig::operator=(const IncrementalConfig& cp) {
+		if(this != &cp) {
+			// Copy first, so that a throwing copy leaves *this untouched
+			auto tmp = cp;
+			*this = std::move(tmp);
+		}
+		return *this;
+	}
+
+	IncrementalConfig& IncrementalConfig::operator=(IncrementalConfig&&) = default;
+
+
+	size_t IncrementalConfig::segmentEnd_(size_t index) const noexcept {
+		return (index + 1 < segments_.size())? segments_[index + 1].begin : text_.size();
+	}
+
+
+	size_t IncrementalConfig::segmentAt_(size_t offset) const noexcept {
+		assert(! segments_.empty());
+		auto next = std::upper_bound(segments_.begin(), segments_.end(), offset,
+			[](size_t offset, const Segment& segment) { return offset < segment.begin; } );
+		return size_t(next - segments_.begin()) - 1;
+	}
+
+
+	RawData IncrementalConfig::lastDefinition_(std::string_view key, size_t segmentsEnd) const {
+		for(size_t i = segmentsEnd; i > 0; -- i) {
+			const auto& segment = segments_[i - 1];
+			if(! segmentDefines(segment, key)) continue;
+			size_t begin = segment.begin;
+			auto defined = Config::parse(text_.data() + begin, segmentEnd_(i - 1) - begin);
+			return defined.data_.find(key)->second;
+		}
+		assert(false && "the key is not defined by any segment");
+		return { };
+	}
+
+
+	void IncrementalConfig::parseAll_(std::string text) {
+		std::vector<Segment> segments;
+		apcf_parse::EntryVector entries;
+		parseSegments(text, 0, &segments, &entries);
+
+		Config cfg;
+		for(auto& entry : entries) {
+			cfg.data_.emplace_hint(cfg.data_.end(), std::move(entry.first), std::move(entry.second));
+		}
+
+		std::unordered_map<std::string_view, size_t> counts;
+		for(const auto& segment : segments) {
+			for(const auto& key : segment.keys) ++ counts[key];
+		}
+		std::unordered_map<std::string_view, size_t> redefinitions;
+		for(const auto& count : counts) {
+			if(count.second < 2) continue;
+			redefinitions.emplace(std::string_view(cfg.data_.find(count.first)->first), count.second);
+		}
+
+		// The views into `cfg` remain valid, since moving a map moves no node
+		text_ = std::move(text);
+		cfg_ = std::move(cfg);
+		segments_ = std::move(segments);
+		redefinitions_ = std::move(redefinitions);
+	}
+
+
+	bool IncrementalConfig::reparse_(size_t first, size_t last, std::string_view regionText, size_t oldRegionSize) {
+		size_t regionBegin = segments_[first].begin;
+		std::vector<Segment> newSegments;
+		apcf_parse::EntryVector entries;
+		try {
+			parseSegments(regionText, regionBegin, &newSegments, &entries);
+		} catch(ConfigError&) {
+			return false;
+		}
+
+		// Count the definitions of each key within the region, before and after the edit
+		struct Counts {
+			size_t before = 0;
+			size_t after = 0;
+			apcf_parse::Entry* entry = nullptr;
+		};
+		std::unordered_map<std::string_view, Counts> counts;
+		for(size_t i = first; i <= last; ++i) {
+			for(const auto& key : segments_[i].keys) ++ counts[key].before;
+		}
+		for(const auto& segment : newSegments) {
+			for(const auto& key : segment.keys) ++ counts[key].after;
+		}
+		for(auto& entry : entries) counts[entry.first].entry = &entry;
+
+		// Keys whose values change, for the Config to notify its observers
+		std::vector<Key> changed;
+		auto assign = [&](std::map<Key, RawData, std::less<>>::iterator entry, RawData value) {
+			if(! equivalent(entry->second, value)) changed.push_back(entry->first);
+			entry->second = std::move(value);
+		};
+
+		auto definedAfter = [&](std::string_view key) {
+			for(size_t i = last + 1; i < segments_.size(); ++i) {
+				if(segmentDefines(segments_[i], key)) return true;
+			}
+			return false;
+		};
+
+		for(auto& keyCounts : counts) {
+			auto key = keyCounts.first;
+			auto& c = keyCounts.second;
+			auto found = cfg_.data_.find(key);
+			size_t total = 0;
+			if(found != cfg_.data_.end()) {
+				auto redef = redefinitions_.find(key);
+				total = (redef == redefinitions_.end())? 1 : redef->second;
+			}
+			size_t outside = total - c.before;
+			size_t newTotal = outside + c.after;
+
+			if(newTotal < 2) redefinitions_.erase(key);
+
+			if(c.after > 0) {
+				// The region defines the key, unless a later definition overrides it
+				if(outside == 0 || ! definedAfter(key)) {
+					if(found == cfg_.data_.end()) {
+						found = cfg_.data_.emplace(std::move(c.entry->first), std::move(c.entry->second)).first;
+						++ cfg_.nodeGeneration_;
+						changed.push_back(found->first);
+					} else {
+						assign(found, std::move(c.entry->second));
+					}
+				}
+			} else if(newTotal == 0) {
+				changed.push_back(found->first);
+				cfg_.data_.erase(found);
+				++ cfg_.nodeGeneration_;
+				continue;
+			} else if(c.before > 0) {
+				// The region does not define the key anymore, but other segments do
+				if(! definedAfter(key)) assign(found, lastDefinition_(key, first));
+			}
+
+			if(newTotal >= 2) redefinitions_[std::string_view(found->first)] = newTotal;
+		}
+
+		// Counts and entries refer to the old segments: they are replaced last
+		counts.clear();
+		text_.replace(regionBegin, oldRegionSize, regionText);
+		for(size_t i = last + 1; i < segments_.size(); ++i) {
+			segments_[i].begin = (segments_[i].begin - oldRegionSize) + regionText.size();
+		}
+		segments_.erase(segments_.begin() + first, segments_.begin() + last + 1);
+		segments_.insert(segments_.begin() + first,
+			std::make_move_iterator(newSegments.begin()),
+			std::make_move_iterator(newSegments.end()) );
+		if(! segments_.empty()) segments_.front().begin = 0;
+
+		++ cfg_.generation_;
+		if(cfg_.isObserved_() && ! changed.empty()) {
+			std::sort(changed.begin(), changed.end());
+			cfg_.notify_(changed);
+		}
+		return true;
+	}
+
+
+	size_t IncrementalConfig::edit(size_t offset, size_t length, std::string_view replacement) {
+		if(offset > text_.size()) throw std::out_of_range("edit offset past the end of the text");
+		length = std::min(length, text_.size() - offset);
+		size_t editEnd = offset + length;
+
+		if(! segments_.empty()) {
+			// Touching the boundary between two segments may affect both
+			size_t first = segmentAt_((offset == 0)? 0 : offset - 1);
+			size_t last = segmentAt_(editEnd);
+			std::string regionText;
+			while(true) {
+				size_t regionBegin = segments_[first].begin;
+				size_t regionEnd = segmentEnd_(last);
+				regionText.assign(text_, regionBegin, offset - regionBegin);
+				regionText.append(replacement);
+				regionText.append(text_, editEnd, regionEnd - editEnd);
+
+				/* The definitions around the region must not be parsed any
+				 * differently, which is only certain when the region is
+				 * delimited by whitespaces, and does not end within a
+				 * comment that would swallow the next definitions. */
+				bool endsAtToken = (! regionText.empty()) && apcf_parse::isWhitespace(regionText.back()) && ! endsWithinComment(regionText);
+				if(first > 0 && ! apcf_parse::isWhitespace(text_[regionBegin - 1])) {
+					-- first;
+				} else
+				if(last + 1 < segments_.size() && ! endsAtToken) {
+					++ last;
+				} else {
+					break;
+				}
+			}
+			size_t oldRegionSize = segmentEnd_(last) - segments_[first].begin;
+			if(reparse_(first, last, regionText, oldRegionSize)) return regionText.size();
+		}
+
+		auto newText = text_;
+		newText.replace(offset, length, replacement);
+		parseAll_(std::move(newText));
+		return text_.size();
+	}
+
+
+	size_t IncrementalConfig::update(std::string_view newText) {
+		auto oldText = std::string_view(text_);
+		if(oldText == newText) return 0;
+		size_t prefix = std::mismatch(oldText.begin(), oldText.end(), newText.begin(), newText.end()).first - oldText.begin();
+		size_t maxSuffix = std::min(oldText.size(), newText.size()) - prefix;
+		size_t suffix = 0;
+		while(suffix < maxSuffix && oldText[oldText.size() - suffix - 1] == newText[newText.size() - suffix - 1]) ++ suffix;
+		return edit(prefix, oldText.size() - prefix - suffix, newText.substr(prefix, newText.size() - prefix - suffix));
+	}
+
+}
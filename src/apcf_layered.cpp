@@ -0,0 +1,181 @@
+#include "apcf_.hpp"
+
+#include <apcf_layered.hpp>
+
+
+
+namespace apcf {
+
+	LayeredConfig::const_iterator::const_iterator(): current_(nullptr) { }
+	LayeredConfig::const_iterator::const_iterator(const const_iterator&) = default;
+	LayeredConfig::const_iterator::const_iterator(const_iterator&&) noexcept = default;
+	LayeredConfig::const_iterator::~const_iterator() = default;
+
+	LayeredConfig::const_iterator& LayeredConfig::const_iterator::operator=(const const_iterator&) = default;
+	LayeredConfig::const_iterator& LayeredConfig::const_iterator::operator=(const_iterator&&) noexcept = default;
+
+
+	LayeredConfig::const_iterator::const_iterator(const std::vector<std::shared_ptr<const Config>>& layers) {
+		cursors_.reserve(layers.size());
+		for(const auto& layer : layers) cursors_.push_back({ layer->begin(), layer->end() });
+		seek_();
+	}
+
+
+	void LayeredConfig::const_iterator::seek_() noexcept {
+		// Layers are visited from the top, so that the topmost one wins ties
+		current_ = nullptr;
+		for(size_t i = cursors_.size(); i > 0; -- i) {
+			const auto& cursor = cursors_[i - 1];
+			if(cursor.cur == cursor.end) continue;
+			if(current_ == nullptr || cursor.cur->first < current_->first) current_ = &*cursor.cur;
+		}
+	}
+
+
+	LayeredConfig::const_iterator& LayeredConfig::const_iterator::operator++() {
+		// Every layer defining the current key moves past it; map nodes do not move, so `key` stays valid
+		const Key& key = current_->first;
+		for(auto& cursor : cursors_) {
+			if(cursor.cur != cursor.end && cursor.cur->first == key) ++ cursor.cur;
+		}
+		seek_();
+		return *this;
+	}
+
+
+	LayeredConfig::LayeredConfig() = default;
+	LayeredConfig::LayeredConfig(const LayeredConfig& cp): layers_(cp.layers_) { if(cp.isCached()) enableCache(); }
+	LayeredConfig::LayeredConfig(LayeredConfig&&) noexcept = default;
+	LayeredConfig::~LayeredConfig() = default;
+
+	LayeredConfig& LayeredConfig::operator=(const LayeredConfig& cp) {
+		layers_ = cp.layers_;
+		if(cp.isCached()) cache_.emplace();
+		else cache_.reset();
+		return *this;
+	}
+
+	LayeredConfig& LayeredConfig::operator=(LayeredConfig&&) noexcept = default;
+
+
+	void LayeredConfig::pushLayer(std::shared_ptr<const Config> layer) {
+		layers_.push_back(std::move(layer));
+		invalidateCache();
+	}
+
+	void LayeredConfig::pushLayer(Config&& layer) {
+		pushLayer(std::make_shared<const Config>(std::move(layer)));
+	}
+
+	void LayeredConfig::borrowLayer(const Config& borrowed) {
+		// Aliasing an empty owner: the layer is referred to, but never deleted
+		pushLayer(std::shared_ptr<const Config>(std::shared_ptr<const Config>(), &borrowed));
+	}
+
+
+	void LayeredConfig::setLayer(size_t index, std::shared_ptr<const Config> layer) {
+		layers_.at(index) = std::move(layer);
+		invalidateCache();
+	}
+
+	void LayeredConfig::setLayer(size_t index, Config&& layer) {
+		setLayer(index, std::make_shared<const Config>(std::move(layer)));
+	}
+
+	void LayeredConfig::setBorrowedLayer(size_t index, const Config& borrowed) {
+		setLayer(index, std::shared_ptr<const Config>(std::shared_ptr<const Config>(), &borrowed));
+	}
+
+
+	void LayeredConfig::enableCache() {
+		if(! cache_.has_value()) cache_.emplace();
+	}
+
+	void LayeredConfig::disableCache() noexcept {
+		cache_.reset();
+	}
+
+	void LayeredConfig::invalidateCache() noexcept {
+		if(cache_.has_value()) cache_->clear();
+	}
+
+
+	Config LayeredConfig::flatten() const {
+		Config r;
+		for(const auto& entry : *this) r.set(entry.first, entry.second);
+		return r;
+	}
+
+
+	size_t LayeredConfig::entryCount() const {
+		size_t r = 0;
+		for(auto iter = begin(); iter != end(); ++ iter) ++ r;
+		return r;
+	}
+
+
+	ConfigHierarchy LayeredConfig::getHierarchy() const {
+		return ConfigHierarchy(*this);
+	}
+
+
+	const RawData* LayeredConfig::resolve_(const Key& key) const {
+		if(cache_.has_value()) {
+			auto cached = cache_->find(key);
+			if(cached != cache_->end()) return cached->second;
+		}
+		const RawData* r = nullptr;
+		for(size_t i = layers_.size(); i > 0; -- i) {
+			r = layers_[i - 1]->get(key).value_or(nullptr);
+			if(r != nullptr) break;
+		}
+		if(cache_.has_value()) cache_->emplace(key, r);
+		return r;
+	}
+
+
+	std::optional<const RawData*> LayeredConfig::get(const Key& key) const {
+		const RawData* r = resolve_(key);
+		if(r == nullptr) return std::nullopt;
+		return r;
+	}
+
+	std::optional<bool> LayeredConfig::getBool(const Key& key) const {
+		return apcf_config::asBool(get(key), key);
+	}
+
+	std::optional<int_t> LayeredConfig::getInt(const Key& key) const {
+		return apcf_config::asInt(get(key), key);
+	}
+
+	std::optional<float_t> LayeredConfig::getFloat(const Key& key) const {
+		return apcf_config::asFloat(get(key), key);
+	}
+
+	std::optional<string_t> LayeredConfig::getString(const Key& key) const {
+		return apcf_config::asString(get(key), key);
+	}
+
+	std::optional<array_span_t> LayeredConfig::getArray(const Key& key) const {
+		return apcf_config::asArray(get(key), key);
+	}
+
+
+	std::optional<std::string_view> LayeredConfig::getStringView(const Key& key) const {
+		return apcf_config::asStringView(get(key), key);
+	}
+
+	const bool* LayeredConfig::getBoolPtr(const Key& key) const {
+		return apcf_config::asBoolPtr(get(key), key);
+	}
+
+	const int_t* LayeredConfig::getIntPtr(const Key& key) const {
+		return apcf_config::asIntPtr(get(key), key);
+	}
+
+	const float_t* LayeredConfig::getFloatPtr(const Key& key) const {
+		return apcf_config::asFloatPtr(get(key), key);
+	}
+
+}
@@ -1,6 +1,7 @@
 #include "apcf_.hpp"
 
 #include <limits>
+#include <algorithm>
 #include <cassert>
 
 
@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <cstring>
+#include <algorithm>
 
 
 
@@ -239,7 +240,7 @@ namespace apcf_parse {
 	}
 
 
-	apcf::Config parse(ParseData& pd) {
+	void parse(ParseData& pd) {
 		skipWhitespaces(pd);
 
 		/* Preemptively skip leading whitespaces and comments:
@@ -275,7 +276,8 @@ namespace apcf_parse {
 						// Arbitrary space after the assignment character
 						skipWhitespacesAndComments(pd);
 
-						pd.cfg.set(key, parseValue(pd));
+						if(pd.sink == nullptr) pd.entries.emplace_back(std::move(key), parseValue(pd));
+						else pd.sink->putEntry(std::move(key), parseValue(pd));
 					} else {
 						throw apcf::UnexpectedChar(pd.src.lineCounter(), pd.src.linePosition(),
 							charAfterKey, expectDefStr );
@@ -285,14 +287,33 @@ namespace apcf_parse {
 
 			// Space between definitions (or a definition and EOF)
 			skipWhitespacesAndComments(pd);
+			if(pd.sink != nullptr && pd.keyStack.empty()) pd.sink->endTopLevelDefinition();
 		}
 
 		// Check and throw for unclosed groups
 		if(! pd.keyStack.empty()) {
 			throw apcf::UnclosedGroup(pd.keyStack.back());
 		}
+	}
+
 
-		return std::move(pd.cfg);
+	void sortAndDedupe(EntryVector& entries) {
+		constexpr auto cmpKeys = [](const Entry& l, const Entry& r) { return l.first < r.first; };
+
+		// Configs are often written (or serialized) in a mostly sorted order
+		if(! std::is_sorted(entries.begin(), entries.end(), cmpKeys)) {
+			std::stable_sort(entries.begin(), entries.end(), cmpKeys);
+		}
+
+		size_t dst = 0;
+		for(size_t i=0; i < entries.size(); ++i) {
+			bool redefined = (i+1 < entries.size()) && (entries[i].first == entries[i+1].first);
+			if(! redefined) {
+				if(dst != i) entries[dst] = std::move(entries[i]);
+				++ dst;
+			}
+		}
+		entries.erase(entries.begin() + dst, entries.end());
 	}
 
 }
@@ -310,19 +331,23 @@ namespace apcf {
 
 	Config Config::parse(const char* charSeqPtr, size_t length) {
 		auto src = io::StringReader(std::span<const char>(charSeqPtr, length));
-		ParseData pd = {
-			.cfg = { },
-			.src = src,
-			.keyStack = { } };
-		return apcf_parse::parse(pd);
+		return read(src);
 	}
 
 	Config Config::read(io::Reader& in) {
 		ParseData pd = {
-			.cfg = { },
+			.entries = { },
 			.src = in,
 			.keyStack = { } };
-		return apcf_parse::parse(pd);
+		apcf_parse::parse(pd);
+		sortAndDedupe(pd.entries);
+
+		// The entries are sorted, every insertion goes right before the end
+		Config r;
+		for(auto& entry : pd.entries) {
+			r.data_.emplace_hint(r.data_.end(), std::move(entry.first), std::move(entry.second));
+		}
+		return r;
 	}
 
 	Config Config::read(std::istream& in) {
@@ -331,11 +356,7 @@ namespace apcf {
 
 	Config Config::read(std::istream& in, size_t count) {
 		auto src = io::StdStreamReader(in, count);
-		ParseData pd = {
-			.cfg = { },
-			.src = src,
-			.keyStack = { } };
-		return apcf_parse::parse(pd);
+		return read(src);
 	}
 
 }
@@ -0,0 +1,326 @@
+#include "apcf_.hpp"
+
+#include <apcf_persistent.hpp>
+
+#include <cstring>
+
+
+
+namespace {
+
+	using apcf::PersistentConfig;
+	using PersistentNode = PersistentConfig::Node;
+	using NodePtr = std::shared_ptr<const PersistentNode>;
+	using EntryPtr = std::shared_ptr<const PersistentConfig::Entry>;
+
+
+	size_t heightOf(const NodePtr& node) {
+		return (node == nullptr)? 0 : node->height;
+	}
+
+
+	NodePtr mkNode(EntryPtr entry, NodePtr left, NodePtr right) {
+		size_t height = std::max(heightOf(left), heightOf(right)) + 1;
+		return std::make_shared<const PersistentNode>(std::move(entry), std::move(left), std::move(right), height);
+	}
+
+
+	/* Builds a node from subtrees whose heights differ by at most 2,
+	 * rotating them if they differ by 2 (AVL rebalancing, without
+	 * modifying any existing node). */
+	NodePtr mkBalancedNode(EntryPtr entry, NodePtr left, NodePtr right) {
+		size_t hl = heightOf(left);
+		size_t hr = heightOf(right);
+		if(hl > hr + 1) {
+			const PersistentNode& l = *left;
+			if(heightOf(l.left) >= heightOf(l.right)) {
+				return mkNode(l.entry, l.left, mkNode(std::move(entry), l.right, std::move(right)));
+			}
+			const PersistentNode& lr = *l.right;
+			return mkNode(lr.entry,
+				mkNode(l.entry, l.left, lr.left),
+				mkNode(std::move(entry), lr.right, std::move(right)) );
+		}
+		if(hr > hl + 1) {
+			const PersistentNode& r = *right;
+			if(heightOf(r.right) >= heightOf(r.left)) {
+				return mkNode(r.entry, mkNode(std::move(entry), std::move(left), r.left), r.right);
+			}
+			const PersistentNode& rl = *r.left;
+			return mkNode(rl.entry,
+				mkNode(std::move(entry), std::move(left), rl.left),
+				mkNode(r.entry, rl.right, r.right) );
+		}
+		return mkNode(std::move(entry), std::move(left), std::move(right));
+	}
+
+
+	NodePtr insertEntry(const NodePtr& node, EntryPtr entry, bool* added) {
+		if(node == nullptr) {
+			*added = true;
+			return mkNode(std::move(entry), nullptr, nullptr);
+		}
+		const auto& key = entry->first;
+		const auto& nodeKey = node->entry->first;
+		if(key < nodeKey) return mkBalancedNode(node->entry, insertEntry(node->left, std::move(entry), added), node->right);
+		if(nodeKey < key) return mkBalancedNode(node->entry, node->left, insertEntry(node->right, std::move(entry), added));
+		return mkNode(std::move(entry), node->left, node->right);
+	}
+
+
+	NodePtr eraseMin(const NodePtr& node, EntryPtr* min) {
+		if(node->left == nullptr) {
+			*min = node->entry;
+			return node->right;
+		}
+		return mkBalancedNode(node->entry, eraseMin(node->left, min), node->right);
+	}
+
+	/* Joins two subtrees whose heights differ by at most 1, every key of
+	 * the former preceding every key of the latter. */
+	NodePtr joinSubtrees(const NodePtr& left, const NodePtr& right) {
+		if(left == nullptr) return right;
+		if(right == nullptr) return left;
+		EntryPtr min;
+		NodePtr rest = eraseMin(right, &min);
+		return mkBalancedNode(std::move(min), left, std::move(rest));
+	}
+
+	/* Returns `node` itself if the key is not found, so that no node is
+	 * copied for nothing. */
+	NodePtr eraseEntry(const NodePtr& node, const apcf::Key& key) {
+		if(node == nullptr) return node;
+		const auto& nodeKey = node->entry->first;
+		if(key < nodeKey) {
+			auto left = eraseEntry(node->left, key);
+			return (left == node->left)? node : mkBalancedNode(node->entry, std::move(left), node->right);
+		}
+		if(nodeKey < key) {
+			auto right = eraseEntry(node->right, key);
+			return (right == node->right)? node : mkBalancedNode(node->entry, node->left, std::move(right));
+		}
+		return joinSubtrees(node->left, node->right);
+	}
+
+
+	EntryPtr takeEntry(std::map<apcf::Key, apcf::RawData, std::less<>>::const_iterator entry) {
+		return std::make_shared<const PersistentConfig::Entry>(entry->first, entry->second);
+	}
+
+	EntryPtr takeEntry(apcf_parse::EntryVector::iterator entry) {
+		return std::make_shared<const PersistentConfig::Entry>(std::move(entry->first), std::move(entry->second));
+	}
+
+	/* Builds a perfectly balanced tree from the next `size` sorted
+	 * entries, visiting each of them once, in order. */
+	template<typename Iter>
+	NodePtr buildSorted(Iter& cur, size_t size) {
+		if(size == 0) return nullptr;
+		size_t leftSize = size / 2;
+		auto left = buildSorted(cur, leftSize);
+		auto entry = takeEntry(cur);
+		++ cur;
+		auto right = buildSorted(cur, size - leftSize - 1);
+		return mkNode(std::move(entry), std::move(left), std::move(right));
+	}
+
+}
+
+
+
+namespace apcf {
+
+	PersistentConfig::Node::~Node() = default;
+
+
+	PersistentConfig::const_iterator::const_iterator() = default;
+	PersistentConfig::const_iterator::const_iterator(const const_iterator&) = default;
+	PersistentConfig::const_iterator::const_iterator(const_iterator&&) noexcept = default;
+	PersistentConfig::const_iterator::~const_iterator() = default;
+
+	PersistentConfig::const_iterator& PersistentConfig::const_iterator::operator=(const const_iterator&) = default;
+	PersistentConfig::const_iterator& PersistentConfig::const_iterator::operator=(const_iterator&&) noexcept = default;
+
+
+	PersistentConfig::const_iterator::const_iterator(const Node* root) {
+		pushLeftSpine_(root);
+	}
+
+
+	void PersistentConfig::const_iterator::pushLeftSpine_(const Node* node) {
+		while(node != nullptr) {
+			stack_.push_back(node);
+			node = node->left.get();
+		}
+	}
+
+
+	PersistentConfig::const_iterator& PersistentConfig::const_iterator::operator++() {
+		const Node* visited = stack_.back();
+		stack_.pop_back();
+		pushLeftSpine_(visited->right.get());
+		return *this;
+	}
+
+
+	bool PersistentConfig::const_iterator::operator==(const const_iterator& r) const noexcept {
+		if(stack_.empty() || r.stack_.empty()) return stack_.empty() == r.stack_.empty();
+		return stack_.back() == r.stack_.back();
+	}
+
+
+	PersistentConfig PersistentConfig::parse(const char* cStr) {
+		return parse(cStr, strlen(cStr));
+	}
+
+	PersistentConfig PersistentConfig::parse(const char* charSeqPtr, size_t length) {
+		auto src = io::StringReader(std::span<const char>(charSeqPtr, length));
+		return read(src);
+	}
+
+	PersistentConfig PersistentConfig::read(io::Reader& in) {
+		apcf_parse::ParseData pd = {
+			.entries = { },
+			.src = in,
+			.keyStack = { } };
+		apcf_parse::parse(pd);
+		apcf_parse::sortAndDedupe(pd.entries);
+		auto cur = pd.entries.begin();
+		return PersistentConfig(buildSorted(cur, pd.entries.size()), pd.entries.size());
+	}
+
+	PersistentConfig PersistentConfig::read(std::istream& in) {
+		return read(in, std::numeric_limits<size_t>::max());
+	}
+
+	PersistentConfig PersistentConfig::read(std::istream& in, size_t count) {
+		auto src = io::StdStreamReader(in, count);
+		return read(src);
+	}
+
+
+	PersistentConfig::PersistentConfig(): size_(0) { }
+	PersistentConfig::PersistentConfig(const PersistentConfig&) = default;
+	PersistentConfig::PersistentConfig(PersistentConfig&&) noexcept = default;
+	PersistentConfig::~PersistentConfig() = default;
+
+	PersistentConfig& PersistentConfig::operator=(const PersistentConfig&) = default;
+	PersistentConfig& PersistentConfig::operator=(PersistentConfig&&) noexcept = default;
+
+
+	PersistentConfig::PersistentConfig(std::shared_ptr<const Node> root, size_t size):
+			root_(std::move(root)),
+			size_(size)
+	{ }
+
+
+	PersistentConfig::PersistentConfig(const Config& cfg):
+			size_(cfg.entryCount())
+	{
+		auto cur = cfg.begin();
+		root_ = buildSorted(cur, size_);
+	}
+
+
+	Config PersistentConfig::toConfig() const {
+		Config r;
+		for(const auto& entry : *this) r.set(entry.first, entry.second);
+		return r;
+	}
+
+
+	ConfigHierarchy PersistentConfig::getHierarchy() const {
+		return ConfigHierarchy(*this);
+	}
+
+
+	const PersistentConfig::Entry* PersistentConfig::find_(const Key& key) const noexcept {
+		const Node* node = root_.get();
+		while(node != nullptr) {
+			int cmp = key.compare(node->entry->first);
+			if(cmp == 0) return node->entry.get();
+			node = (cmp < 0)? node->left.get() : node->right.get();
+		}
+		return nullptr;
+	}
+
+
+	std::optional<const RawData*> PersistentConfig::get(const Key& key) const noexcept {
+		const Entry* found = find_(key);
+		if(found == nullptr) return std::nullopt;
+		return &found->second;
+	}
+
+	std::optional<bool> PersistentConfig::getBool(const Key& key) const {
+		return apcf_config::asBool(get(key), key);
+	}
+
+	std::optional<int_t> PersistentConfig::getInt(const Key& key) const {
+		return apcf_config::asInt(get(key), key);
+	}
+
+	std::optional<float_t> PersistentConfig::getFloat(const Key& key) const {
+		return apcf_config::asFloat(get(key), key);
+	}
+
+	std::optional<string_t> PersistentConfig::getString(const Key& key) const {
+		return apcf_config::asString(get(key), key);
+	}
+
+	std::optional<array_span_t> PersistentConfig::getArray(const Key& key) const {
+		return apcf_config::asArray(get(key), key);
+	}
+
+
+	std::optional<std::string_view> PersistentConfig::getStringView(const Key& key) const {
+		return apcf_config::asStringView(get(key), key);
+	}
+
+	const bool* PersistentConfig::getBoolPtr(const Key& key) const {
+		return apcf_config::asBoolPtr(get(key), key);
+	}
+
+	const int_t* PersistentConfig::getIntPtr(const Key& key) const {
+		return apcf_config::asIntPtr(get(key), key);
+	}
+
+	const float_t* PersistentConfig::getFloatPtr(const Key& key) const {
+		return apcf_config::asFloatPtr(get(key), key);
+	}
+
+
+	PersistentConfig PersistentConfig::set(Key key, RawData data) const {
+		bool added = false;
+		auto entry = std::make_shared<const Entry>(std::move(key), std::move(data));
+		auto root = insertEntry(root_, std::move(entry), &added);
+		return PersistentConfig(std::move(root), size_ + (added? 1 : 0));
+	}
+
+	PersistentConfig PersistentConfig::setBool(Key key, bool value) const {
+		return set(std::move(key), RawData(value));
+	}
+
+	PersistentConfig PersistentConfig::setInt(Key key, int_t value) const {
+		return set(std::move(key), RawData(value));
+	}
+
+	PersistentConfig PersistentConfig::setFloat(Key key, float_t value) const {
+		return set(std::move(key), RawData(value));
+	}
+
+	PersistentConfig PersistentConfig::setString(Key key, string_t value) const {
+		return set(std::move(key), RawData(value));
+	}
+
+	PersistentConfig PersistentConfig::setArray(Key key, array_t array) const {
+		return set(std::move(key), RawData::moveArray(array.data(), array.size()));
+	}
+
+
+	PersistentConfig PersistentConfig::erase(const Key& key) const {
+		auto root = eraseEntry(root_, key);
+		if(root == root_) return *this;
+		return PersistentConfig(std::move(root), size_ - 1);
+	}
+
+}
@@ -0,0 +1,296 @@
+#include "apcf_.hpp"
+
+#include <apcf_query.hpp>
+
+
+
+namespace {
+
+	using PatternSegments = std::vector<apcf::KeyPattern::Segment>;
+	using SegmentType = apcf::KeyPattern::SegmentType;
+	using EntryMap = std::map<apcf::Key, apcf::RawData, std::less<>>;
+
+
+	/* Matches the key segments from `keyIndex` on with the pattern
+	 * segments from `patternIndex` on; `**` segments try the shortest
+	 * span first.
+	 * Captures may be left behind when the match fails. */
+	bool matchSegments(
+			const PatternSegments& pattern, size_t patternIndex,
+			std::span<const std::string_view> keySegments, size_t keyIndex,
+			std::vector<std::string_view>* capturesDst
+	) {
+		for(; patternIndex < pattern.size(); ++ patternIndex, ++ keyIndex) {
+			if(keyIndex >= keySegments.size()) return false;
+			const auto& segment = pattern[patternIndex];
+			switch(segment.type) {
+				case SegmentType::eLiteral: {
+					if(keySegments[keyIndex] != segment.literal) return false;
+				} break;
+				case SegmentType::eOne: {
+					if(capturesDst != nullptr) capturesDst->push_back(keySegments[keyIndex]);
+				} break;
+				case SegmentType::eMany: {
+					const char* spanBegin = keySegments[keyIndex].data();
+					size_t mark = (capturesDst != nullptr)? capturesDst->size() : 0;
+					for(size_t spanEnd = keyIndex + 1; spanEnd <= keySegments.size(); ++ spanEnd) {
+						if(capturesDst != nullptr) {
+							const auto& lastSegment = keySegments[spanEnd - 1];
+							capturesDst->emplace_back(spanBegin, (lastSegment.data() + lastSegment.size()) - spanBegin);
+						}
+						if(matchSegments(pattern, patternIndex + 1, keySegments, spanEnd, capturesDst)) return true;
+						if(capturesDst != nullptr) capturesDst->resize(mark);
+					}
+					return false;
+				}
+			}
+		}
+		return keyIndex == keySegments.size();
+	}
+
+
+	/* Visits the ranges of entries that may match a pattern: each
+	 * segment before the first `**` narrows the range down to a group,
+	 * by looking up its bounds. */
+	class QueryWalker {
+	public:
+		const EntryMap& data;
+		const PatternSegments& pattern;
+		apcf::QueryResult& result;
+
+		/* The group being visited, with a trailing separator. */
+		std::string prefix;
+		std::vector<std::string_view> captures;
+		std::vector<std::string_view> keySegments;
+
+		QueryWalker(const EntryMap& data, const PatternSegments& pattern, apcf::QueryResult& result):
+				data(data),
+				pattern(pattern),
+				result(result)
+		{ }
+
+		void emit(EntryMap::const_iterator entry) {
+			result.keys.emplace_back(entry->first);
+			result.captures.insert(result.captures.end(), captures.begin(), captures.end());
+			result.values.push_back(&entry->second);
+		}
+
+		/* Groups are often small enough for a few comparisons to be cheaper
+		 * than a lookup from the root of the map. */
+		static constexpr size_t linearScanLimit = 16;
+
+		/* Returns the first entry within `[cur, end)` that does not precede
+		 * `key`, which must not follow `end`. */
+		EntryMap::const_iterator lowerBound(EntryMap::const_iterator cur, EntryMap::const_iterator end, std::string_view key) {
+			for(size_t i = 0; i < linearScanLimit; ++i, ++cur) {
+				if(cur == end || std::string_view(cur->first) >= key) return cur;
+			}
+			return data.lower_bound(key);
+		}
+
+		/* Returns the end of the group whose name, with a trailing
+		 * separator, is `prefix`. */
+		EntryMap::const_iterator groupEnd(EntryMap::const_iterator cur, EntryMap::const_iterator end) {
+			static_assert(apcf_constants::GRAMMAR_KEY_SEPARATOR + 1 == '/');
+			prefix.back() = apcf_constants::GRAMMAR_KEY_SEPARATOR + 1;
+			auto r = lowerBound(cur, end, prefix);
+			prefix.back() = apcf_constants::GRAMMAR_KEY_SEPARATOR;
+			return r;
+		}
+
+		void walkLiteral(size_t patternIndex, bool isLast, EntryMap::const_iterator begin, EntryMap::const_iterator end) {
+			size_t mark = prefix.size();
+			prefix.append(pattern[patternIndex].literal);
+			if(isLast) {
+				auto found = lowerBound(begin, end, prefix);
+				if(found != end && std::string_view(found->first) == prefix) emit(found);
+			} else {
+				prefix.push_back(apcf_constants::GRAMMAR_KEY_SEPARATOR);
+				auto groupBegin = lowerBound(begin, end, prefix);
+				auto groupEnd = this->groupEnd(groupBegin, end);
+				if(groupBegin != groupEnd) walk(patternIndex + 1, groupBegin, groupEnd);
+			}
+			prefix.resize(mark);
+		}
+
+		void walkOne(size_t patternIndex, bool isLast, EntryMap::const_iterator cur, EntryMap::const_iterator end) {
+			while(cur != end) {
+				auto rest = std::string_view(cur->first).substr(prefix.size());
+				size_t sep = rest.find(apcf_constants::GRAMMAR_KEY_SEPARATOR);
+				if(sep == std::string_view::npos) {
+					if(isLast) {
+						captures.push_back(rest);
+						emit(cur);
+						captures.pop_back();
+					}
+					++ cur;
+					continue;
+				}
+				// Every key within the subgroup follows this one, up to the subgroup's end
+				auto child = rest.substr(0, sep);
+				size_t mark = prefix.size();
+				prefix.append(child);
+				prefix.push_back(apcf_constants::GRAMMAR_KEY_SEPARATOR);
+				auto next = groupEnd(cur, end);
+				if(! isLast) {
+					captures.push_back(child);
+					walk(patternIndex + 1, cur, next);
+					captures.pop_back();
+				}
+				prefix.resize(mark);
+				cur = next;
+			}
+		}
+
+		void walkMany(size_t patternIndex, EntryMap::const_iterator cur, EntryMap::const_iterator end) {
+			// Every key within the range already matches the segments before this one
+			size_t mark = captures.size();
+			for(; cur != end; ++ cur) {
+				const auto& key = cur->first;
+				size_t depth = key.getDepth();
+				keySegments.clear();
+				for(size_t i = 0; i < depth; ++i) {
+					auto segment = key.segments(i, i + 1);
+					keySegments.emplace_back(segment.data(), segment.size());
+				}
+				if(matchSegments(pattern, patternIndex, keySegments, patternIndex, &captures)) emit(cur);
+				captures.resize(mark);
+			}
+		}
+
+		void walk(size_t patternIndex, EntryMap::const_iterator begin, EntryMap::const_iterator end) {
+			bool isLast = patternIndex + 1 == pattern.size();
+			switch(pattern[patternIndex].type) {
+				case SegmentType::eLiteral: walkLiteral(patternIndex, isLast, begin, end); break;
+				case SegmentType::eOne: walkOne(patternIndex, isLast, begin, end); break;
+				case SegmentType::eMany: walkMany(patternIndex, begin, end); break;
+			}
+		}
+	};
+
+
+	apcf::int_t columnInt(const apcf::RawData& value, std::string_view key) {
+		if(value.type == apcf::DataType::eInt) [[likely]] return value.data.intValue;
+		return apcf_config::asInt(&value, apcf::Key(std::string(key))).value();
+	}
+
+	apcf::float_t columnFloat(const apcf::RawData& value, std::string_view key) {
+		if(value.type == apcf::DataType::eFloat) [[likely]] return value.data.floatValue;
+		return apcf_config::asFloat(&value, apcf::Key(std::string(key))).value();
+	}
+
+	std::string_view columnStringView(const apcf::RawData& value, std::string_view key) {
+		if(value.type == apcf::DataType::eString) [[likely]] {
+			return std::string_view(value.data.stringValue.data(), value.data.stringValue.length());
+		}
+		return apcf_config::asStringView(&value, apcf::Key(std::string(key))).value();
+	}
+
+
+	template<typename T, T (*convert)(const apcf::RawData&, std::string_view)>
+	apcf::QueryColumn<T> queryColumn(const apcf::Config& cfg, const apcf::KeyPattern& pattern) {
+		auto found = apcf::query(cfg, pattern);
+		apcf::QueryColumn<T> r;
+		r.values.reserve(found.size());
+		for(size_t i = 0; i < found.size(); ++i) r.values.push_back(convert(*found.values[i], found.keys[i]));
+		r.keys = std::move(found.keys);
+		r.captures = std::move(found.captures);
+		r.captureCount = found.captureCount;
+		return r;
+	}
+
+}
+
+
+
+namespace apcf {
+
+	template<typename T> QueryColumn<T>::QueryColumn() = default;
+	template<typename T> QueryColumn<T>::QueryColumn(const QueryColumn&) = default;
+	template<typename T> QueryColumn<T>::QueryColumn(QueryColumn&&) noexcept = default;
+	template<typename T> QueryColumn<T>::~QueryColumn() = default;
+
+	template<typename T> QueryColumn<T>& QueryColumn<T>::operator=(const QueryColumn&) = default;
+	template<typename T> QueryColumn<T>& QueryColumn<T>::operator=(QueryColumn&&) noexcept = default;
+
+	template struct QueryColumn<const RawData*>;
+	template struct QueryColumn<int_t>;
+	template struct QueryColumn<float_t>;
+	template struct QueryColumn<std::string_view>;
+
+
+	KeyPattern::KeyPattern(std::string_view pattern):
+			captureCount_(0)
+	{
+		std::string patternStr(pattern);
+		size_t segmentBegin = 0;
+		while(true) {
+			size_t segmentEnd = pattern.find(GRAMMAR_KEY_SEPARATOR, segmentBegin);
+			if(segmentEnd == std::string_view::npos) segmentEnd = pattern.size();
+			auto segment = pattern.substr(segmentBegin, segmentEnd - segmentBegin);
+			if(segment.empty()) throw InvalidKey(patternStr, segmentBegin);
+			if(segment == "*") {
+				segments_.push_back({ SegmentType::eOne, { } });
+				++ captureCount_;
+			} else if(segment == "**") {
+				segments_.push_back({ SegmentType::eMany, { } });
+				++ captureCount_;
+			} else {
+				std::string literal(segment);
+				size_t errorPos = apcf_util::findKeyError(literal);
+				if(errorPos < literal.size()) throw InvalidKey(patternStr, segmentBegin + errorPos);
+				segments_.push_back({ SegmentType::eLiteral, std::move(literal) });
+			}
+			if(segmentEnd == pattern.size()) break;
+			segmentBegin = segmentEnd + 1;
+		}
+	}
+
+	KeyPattern::KeyPattern(const KeyPattern&) = default;
+	KeyPattern::KeyPattern(KeyPattern&&) noexcept = default;
+	KeyPattern::~KeyPattern() = default;
+
+	KeyPattern& KeyPattern::operator=(const KeyPattern&) = default;
+	KeyPattern& KeyPattern::operator=(KeyPattern&&) noexcept = default;
+
+
+	bool KeyPattern::matches(std::string_view key, std::vector<std::string_view>* capturesDst) const {
+		std::vector<std::string_view> keySegments;
+		size_t segmentBegin = 0;
+		while(true) {
+			size_t segmentEnd = key.find(GRAMMAR_KEY_SEPARATOR, segmentBegin);
+			if(segmentEnd == std::string_view::npos) segmentEnd = key.size();
+			keySegments.push_back(key.substr(segmentBegin, segmentEnd - segmentBegin));
+			if(segmentEnd == key.size()) break;
+			segmentBegin = segmentEnd + 1;
+		}
+		size_t mark = (capturesDst != nullptr)? capturesDst->size() : 0;
+		if(matchSegments(segments_, 0, keySegments, 0, capturesDst)) return true;
+		if(capturesDst != nullptr) capturesDst->resize(mark);
+		return false;
+	}
+
+
+	QueryResult query(const Config& cfg, const KeyPattern& pattern) {
+		QueryResult r;
+		r.captureCount = pattern.captureCount();
+		if(cfg.data_.empty()) return r;
+		QueryWalker walker(cfg.data_, pattern.segments(), r);
+		walker.walk(0, cfg.data_.begin(), cfg.data_.end());
+		return r;
+	}
+
+
+	QueryColumn<int_t> queryInt(const Config& cfg, const KeyPattern& pattern) {
+		return queryColumn<int_t, columnInt>(cfg, pattern);
+	}
+
+	QueryColumn<float_t> queryFloat(const Config& cfg, const KeyPattern& pattern) {
+		return queryColumn<float_t, columnFloat>(cfg, pattern);
+	}
+
+	QueryColumn<std::string_view> queryStringView(const Config& cfg, const KeyPattern& pattern) {
+		return queryColumn<std::string_view, columnStringView>(cfg, pattern);
+	}
+
+}
@@ -1,5 +1,6 @@
 #include "apcf_.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -7,27 +8,56 @@
 
 namespace {
 
+	using apcf_serialize::HierarchyEntry;
+
+
+	/** Like `ConfigHierarchy::autocomplete`, but never skips a key that
+	 * has a value, which would otherwise not be serialized.
+	 * Only the parent of a chain walks it, so serializing a hierarchy
+	 * visits each of its nodes once. */
+	template<typename Storage>
+	HierarchyEntry autocompleteEntry(
+			const apcf::ConfigHierarchy& hierarchy,
+			const Storage& storage,
+			apcf::ConfigHierarchy::node_index_t index
+	) {
+		while(true) {
+			auto key = apcf::Key(hierarchy.nodeKey(index));
+			auto value = apcf_serialize::findValue(storage, key);
+			auto subkeys = hierarchy.getSubkeys(index);
+			if(value != nullptr || subkeys.size() != 1) return HierarchyEntry { index, std::move(key), value };
+			index = subkeys.begin().nodeIndex();
+		}
+	}
+
+
+	template<typename Storage>
 	void sortEntries(
 			const apcf::ConfigHierarchy& hierarchy,
-			const std::map<apcf::Key, apcf::RawData>& map,
-			const std::set<apcf::Key>& parenthood,
-			std::set<apcf::Key>& groupsDst,
-			std::set<apcf::Key>& arraysDst,
-			std::set<apcf::Key>& singleEntriesDst
+			const Storage& storage,
+			const apcf::ConfigHierarchy::Subkeys& parenthood,
+			std::vector<HierarchyEntry>& groupsDst,
+			std::vector<HierarchyEntry>& arraysDst,
+			std::vector<HierarchyEntry>& singleEntriesDst
 	) {
-		for(const auto& childKey : parenthood) {
-			auto autocompKey = hierarchy.autocomplete(childKey);
-			auto child = map.find(autocompKey);
-			if(child == map.end() || ! hierarchy.getSubkeys(autocompKey).empty()) {
-				groupsDst.insert(autocompKey);
+		for(auto child = parenthood.begin(); child != parenthood.end(); ++ child) {
+			auto entry = autocompleteEntry(hierarchy, storage, child.nodeIndex());
+			if(entry.value == nullptr || ! hierarchy.getSubkeys(entry.index).empty()) {
+				groupsDst.push_back(std::move(entry));
 			} else {
-				switch(child->second.type) {
-					case apcf::DataType::eArray: arraysDst.insert(autocompKey); break;
-					default: singleEntriesDst.insert(autocompKey); break;
+				switch(entry.value->type) {
+					case apcf::DataType::eArray: arraysDst.push_back(std::move(entry)); break;
+					default: singleEntriesDst.push_back(std::move(entry)); break;
 				}
 			}
 		}
 		assert(parenthood.empty() == (groupsDst.empty() && arraysDst.empty() && singleEntriesDst.empty()));
+
+		// Autocompleted siblings may not be in the order of their subkeys, as in "a-b" and "a.c.d"
+		auto cmp = [](const HierarchyEntry& l, const HierarchyEntry& r) { return l.key < r.key; };
+		for(auto* vec : { &groupsDst, &arraysDst, &singleEntriesDst }) {
+			if(! std::is_sorted(vec->begin(), vec->end(), cmp)) std::sort(vec->begin(), vec->end(), cmp);
+		}
 	}
 
 
@@ -276,7 +306,7 @@ namespace apcf_serialize {
 
 	void serializeLineEntry(
 			SerializeData& sd,
-			const apcf::Key& key,
+			apcf::KeySpan key,
 			const apcf::RawData& entryValue
 	) {
 		using namespace std::string_literals;
@@ -293,7 +323,7 @@ namespace apcf_serialize {
 			serializeEntry(sd.rules, sd.state, value, serialized);
 			sd.dst.writeChars(serialized);
 		};
-		assert(apcf::isKeyValid(key));
+		assert(apcf::isKeyValid(std::string(key.data(), key.size())));
 		if(sd.rules.flags & apcf::SerializationRules::eMinimized) {
 			if(
 				getFlags<uint_fast8_t>(sd.lastLineFlags, lineFlagsOwnEntryBit) &&
@@ -301,7 +331,7 @@ namespace apcf_serialize {
 			) {
 				sd.dst.writeChar(' ');
 			}
-			sd.dst.writeChars(key);
+			sd.dst.writeChars(key.data(), key.data() + key.size());
 			sd.dst.writeChar('=');
 			writeValue(sd, entryValue);
 		} else {
@@ -319,7 +349,7 @@ namespace apcf_serialize {
 				sd.dst.writeChar(GRAMMAR_NEWLINE);
 			}
 			sd.dst.writeChars(sd.state.indentation);
-			sd.dst.writeChars(key);
+			sd.dst.writeChars(key.data(), key.data() + key.size());
 			sd.dst.writeChars(" = "s);
 			writeValue(sd, entryValue);
 			sd.dst.writeChar(GRAMMAR_NEWLINE);
@@ -333,7 +363,7 @@ namespace apcf_serialize {
 
 	void serializeLineGroupBeg(
 			SerializeData& sd,
-			const apcf::Key& key
+			apcf::KeySpan key
 	) {
 		if(sd.rules.flags & apcf::SerializationRules::eMinimized) {
 			if(
@@ -342,7 +372,7 @@ namespace apcf_serialize {
 			) {
 				sd.dst.writeChar(' ');
 			}
-			sd.dst.writeChars(key);
+			sd.dst.writeChars(key.data(), key.data() + key.size());
 			sd.dst.writeChar(GRAMMAR_GROUP_BEGIN);
 		} else {
 			if(
@@ -355,7 +385,7 @@ namespace apcf_serialize {
 			}
 			sd.dst.writeChars(sd.state.indentation);
 			pushIndent(sd.rules, sd.state);
-			sd.dst.writeChars(key);
+			sd.dst.writeChars(key.data(), key.data() + key.size());
 			sd.dst.writeChar(' ');
 			sd.dst.writeChar(GRAMMAR_GROUP_BEGIN);
 			sd.dst.writeChar(GRAMMAR_NEWLINE);
@@ -384,112 +414,190 @@ namespace apcf_serialize {
 	}
 
 
+	const apcf::RawData* findValue(const apcf::Config& cfg, const apcf::Key& key) {
+		// Only the defined entries are serialized, not the ones resolved by fallbacks
+		return cfg.getDefined(key).value_or(nullptr);
+	}
+
+	const apcf::RawData* findValue(const apcf::FlatConfig& cfg, const apcf::Key& key) {
+		return cfg.get(key).value_or(nullptr);
+	}
+
+
+	template<typename Storage>
 	void serializeHierarchy(
-			SerializeHierarchyParams& state,
-			const Key& key, const Key& parent
+			SerializeHierarchyParams<Storage>& state,
+			const HierarchyEntry& entry, size_t parentDepth
 	) {
-		// Calculate the basename of `key` by using the known parent size
-		Key keyBasename;
-		KeySpan keyBasenameSpan;
-		bool keyIsRoot = key.empty();
-		const auto& parenthood = state.hierarchy->getSubkeys(key);
-		{
-			size_t parentOffset = 0;
-			if(! parent.empty()) parentOffset = parent.size() + 1;
-			keyBasenameSpan = KeySpan(
-				key.data() + parentOffset,
-				key.size() - parentOffset );
-			keyBasename = Key(keyBasenameSpan);
-		}
-
-		if(! keyIsRoot) {
-			// Serialize entry, if one exists
-			const auto& got = state.map->find(key);
-			if(got != state.map->end()) {
-				state.sd->lastLineFlags = setFlags<uint_fast8_t>(state.sd->lastLineFlags, ! parenthood.empty(), lineFlagsGroupEntryBit);
-				serializeLineEntry(*state.sd, keyBasename, got->second);
-			}
-		} else {
-			assert(false); // See comment on next `assert(false)`
+		const auto& key = entry.key;
+		auto parenthood = state.hierarchy->getSubkeys(entry.index);
+		size_t depth = key.getDepth();
+		KeySpan keyBasename = key.segments(parentDepth, depth);
+		assert(! key.empty());
+
+		// Serialize entry, if one exists
+		if(entry.value != nullptr) {
+			state.sd->lastLineFlags = setFlags<uint_fast8_t>(state.sd->lastLineFlags, ! parenthood.empty(), lineFlagsGroupEntryBit);
+			serializeLineEntry(*state.sd, keyBasename, *entry.value);
 		}
 
 		// Serialize group, if one exists
-		{
-			if(! parenthood.empty()) {
-				if(keyIsRoot) {
-					assert(false); // This branch makes no sense, but I may have had a reason for writing this...? An empty key isn't allowed to be in a hierarchy, not anymore.
-					for(const auto& child : parenthood) {
-						serializeHierarchy(state, state.hierarchy->autocomplete(child), key);
-					}
-				} else {
-					#define SERIALIZE_(SET_) { for(const auto& childKey : SET_) serializeHierarchy(state, childKey, std::move(key)); }
-					if(state.sd->rules.flags & apcf::SerializationRules::eMinimized) {
-						serializeLineGroupBeg(*state.sd, keyBasename);
-						for(const auto& childKey : parenthood) {
-							serializeHierarchy(state, state.hierarchy->autocomplete(childKey), std::move(key));
-						}
-						serializeLineGroupEnd(*state.sd);
-					} else {
-						std::set<Key> groups;
-						std::set<Key> arrays;
-						std::set<Key> singleEntries;
-						sortEntries(
-							*state.hierarchy, *state.map, parenthood,
-							groups, arrays, singleEntries );
-
-						serializeLineGroupBeg(*state.sd, keyBasename);
-						SERIALIZE_(groups)
-						SERIALIZE_(arrays)
-						SERIALIZE_(singleEntries)
-						serializeLineGroupEnd(*state.sd);
-					}
-					#undef SERIALIZE_
+		if(! parenthood.empty()) {
+			serializeLineGroupBeg(*state.sd, keyBasename);
+			if(state.sd->rules.flags & apcf::SerializationRules::eMinimized) {
+				for(auto child = parenthood.begin(); child != parenthood.end(); ++ child) {
+					serializeHierarchy(state, autocompleteEntry(*state.hierarchy, *state.storage, child.nodeIndex()), depth);
+				}
+			} else {
+				std::vector<HierarchyEntry> groups;
+				std::vector<HierarchyEntry> arrays;
+				std::vector<HierarchyEntry> singleEntries;
+				sortEntries(
+					*state.hierarchy, *state.storage, parenthood,
+					groups, arrays, singleEntries );
+				for(auto* vec : { &groups, &arrays, &singleEntries }) {
+					for(const auto& child : *vec) serializeHierarchy(state, child, depth);
 				}
 			}
+			serializeLineGroupEnd(*state.sd);
 		}
 	}
 
 
-	void serialize(SerializeData& sd, const std::map<apcf::Key, apcf::RawData>& map) {
+	template<typename Storage>
+	void serialize(SerializeData& sd, const Storage& storage) {
 		using Rules = apcf::SerializationRules;
 		if(sd.rules.flags & Rules::eExpandKeys) {
-			for(const auto& entry : map) {
-				serializeLineEntry(sd, entry.first, entry.second);
+			for(const auto& entry : storage) {
+				serializeLineEntry(sd, KeySpan(entry.first), entry.second);
 			}
 		} else {
 			apcf::ConfigHierarchy hierarchy;
 			const apcf::ConfigHierarchy* hierarchyPtr;
 
 			if(sd.rules.hierarchy == nullptr) {
-				hierarchy = apcf::ConfigHierarchy(map);
+				hierarchy = apcf::ConfigHierarchy(storage);
 				hierarchyPtr = &hierarchy;
 			} else {
 				hierarchyPtr = sd.rules.hierarchy;
 			}
 
-			SerializeHierarchyParams saParams = {
+			SerializeHierarchyParams<Storage> saParams = {
 				.sd = &sd,
-				.map = &map,
+				.storage = &storage,
 				.hierarchy = hierarchyPtr };
 
-			const std::set<Key>& subkeys = hierarchyPtr->getSubkeys({ });
+			auto subkeys = hierarchyPtr->getSubkeys(apcf::ConfigHierarchy::rootIndex);
+
+			if(sd.rules.flags & Rules::eMinimized) {
+				for(auto rootChild = subkeys.begin(); rootChild != subkeys.end(); ++ rootChild) {
+					serializeHierarchy(saParams, autocompleteEntry(*hierarchyPtr, storage, rootChild.nodeIndex()), 0);
+				}
+			} else {
+				std::vector<HierarchyEntry> groups;
+				std::vector<HierarchyEntry> arrays;
+				std::vector<HierarchyEntry> singleEntries;
+				sortEntries(*hierarchyPtr, storage, subkeys, groups, arrays, singleEntries);
+				for(auto* vec : { &groups, &arrays, &singleEntries }) {
+					for(const auto& rootChild : *vec) serializeHierarchy(saParams, rootChild, 0);
+				}
+			}
+		}
+	}
+
+
+	const apcf::RawData* findValue(const apcf::TrieConfig& cfg, const apcf::Key& key) {
+		return cfg.get(key).value_or(nullptr);
+	}
+
+	const apcf::RawData* findValue(const apcf::ConfigView& cfg, const apcf::Key& key) {
+		return cfg.getDefined(key).value_or(nullptr);
+	}
+
+	const apcf::RawData* findValue(const apcf::PersistentConfig& cfg, const apcf::Key& key) {
+		return cfg.get(key).value_or(nullptr);
+	}
+
+	const apcf::RawData* findValue(const apcf::LayeredConfig& cfg, const apcf::Key& key) {
+		return cfg.get(key).value_or(nullptr);
+	}
+
+
+	namespace {
+
+		using TrieNode = apcf::TrieConfig::Node;
+
+		/* A child of a group, autocompleted: `relKey` is its key
+		 * relative to the group, and `node` is its last node. */
+		struct TrieChild {
+			std::string relKey;
+			const TrieNode* node;
+		};
+
+
+		TrieChild autocompleteTrieChild(const std::string& segment, const TrieNode& node) {
+			TrieChild r = { segment, &node };
+			while(r.node->value() == nullptr && r.node->children().size() == 1) {
+				const auto& onlyChild = *r.node->children().begin();
+				r.relKey.push_back(GRAMMAR_KEY_SEPARATOR);
+				r.relKey.append(onlyChild.first);
+				r.node = &onlyChild.second;
+			}
+			return r;
+		}
+
+
+		void serializeTrieChildren(SerializeData& sd, const TrieNode& group);
+
+		void serializeTrieNode(SerializeData& sd, const TrieChild& child) {
+			auto keyBasename = KeySpan(child.relKey.data(), child.relKey.size());
+			bool isGroup = ! child.node->children().empty();
+			if(child.node->value() != nullptr) {
+				sd.lastLineFlags = setFlags<uint_fast8_t>(sd.lastLineFlags, isGroup, lineFlagsGroupEntryBit);
+				serializeLineEntry(sd, keyBasename, *child.node->value());
+			}
+			if(isGroup) {
+				serializeLineGroupBeg(sd, keyBasename);
+				serializeTrieChildren(sd, *child.node);
+				serializeLineGroupEnd(sd);
+			}
+		}
+
 
-			#define SERIALIZE_(SET_) { for(const auto& rootChild : SET_) serializeHierarchy(saParams, rootChild, { }); }
-			if(sd.rules.flags & (Rules::eMinimized | Rules::eExpandKeys)) {
-				for(const auto& rootChild : subkeys) {
-					serializeHierarchy(saParams, hierarchyPtr->autocomplete(rootChild), { });
+		void serializeTrieChildren(SerializeData& sd, const TrieNode& group) {
+			if(sd.rules.flags & apcf::SerializationRules::eMinimized) {
+				for(const auto& child : group.children()) {
+					serializeTrieNode(sd, autocompleteTrieChild(child.first, child.second));
 				}
 			} else {
-				std::set<Key> groups;
-				std::set<Key> arrays;
-				std::set<Key> singleEntries;
-				sortEntries(*hierarchyPtr, map, subkeys, groups, arrays, singleEntries);
-				SERIALIZE_(groups)
-				SERIALIZE_(arrays)
-				SERIALIZE_(singleEntries)
+				// Same grouping and order as `sortEntries`
+				std::vector<TrieChild> groups;
+				std::vector<TrieChild> arrays;
+				std::vector<TrieChild> singleEntries;
+				for(const auto& child : group.children()) {
+					auto autocompChild = autocompleteTrieChild(child.first, child.second);
+					const auto* value = autocompChild.node->value();
+					if(value == nullptr || ! autocompChild.node->children().empty()) {
+						groups.push_back(std::move(autocompChild));
+					} else if(value->type == apcf::DataType::eArray) {
+						arrays.push_back(std::move(autocompChild));
+					} else {
+						singleEntries.push_back(std::move(autocompChild));
+					}
+				}
+				auto cmp = [](const TrieChild& l, const TrieChild& r) { return l.relKey < r.relKey; };
+				for(auto* vec : { &groups, &arrays, &singleEntries }) {
+					std::sort(vec->begin(), vec->end(), cmp);
+					for(const auto& child : *vec) serializeTrieNode(sd, child);
+				}
 			}
-			#undef SERIALIZE_
 		}
+
+	}
+
+
+	void serializeTrie(SerializeData& sd, const apcf::TrieConfig& trie) {
+		serializeTrieChildren(sd, trie.root());
 	}
 
 }
@@ -523,7 +631,7 @@ namespace apcf {
 			.state = state,
 			.lastLineFlags = 0 };
 
-		apcf_serialize::serialize(serializeData, data_);
+		apcf_serialize::serialize(serializeData, *this);
 
 		return r;
 	}
@@ -535,7 +643,7 @@ namespace apcf {
 			.rules = sr,
 			.state = state,
 			.lastLineFlags = 0 };
-		apcf_serialize::serialize(serializeData, data_);
+		apcf_serialize::serialize(serializeData, *this);
 	}
 
 	void Config::write(std::ostream& out, SerializationRules sr) const {
@@ -546,7 +654,128 @@ namespace apcf {
 			.rules = sr,
 			.state = state,
 			.lastLineFlags = 0 };
-		apcf_serialize::serialize(serializeData, data_);
+		apcf_serialize::serialize(serializeData, *this);
+	}
+
+
+	std::string FlatConfig::serialize(SerializationRules sr) const {
+		std::string r;
+		auto wr = io::StringWriter(&r, 0);
+		write(wr, sr);
+		return r;
+	}
+
+	void FlatConfig::write(io::Writer& out, SerializationRules sr) const {
+		SerializationState state = { };
+		SerializeData serializeData = {
+			.dst = out,
+			.rules = sr,
+			.state = state,
+			.lastLineFlags = 0 };
+		apcf_serialize::serialize(serializeData, *this);
+	}
+
+	void FlatConfig::write(std::ostream& out, SerializationRules sr) const {
+		auto wr = io::StdStreamWriter(out);
+		write(wr, sr);
+	}
+
+
+	std::string TrieConfig::serialize(SerializationRules sr) const {
+		std::string r;
+		auto wr = io::StringWriter(&r, 0);
+		write(wr, sr);
+		return r;
+	}
+
+	void TrieConfig::write(io::Writer& out, SerializationRules sr) const {
+		SerializationState state = { };
+		SerializeData serializeData = {
+			.dst = out,
+			.rules = sr,
+			.state = state,
+			.lastLineFlags = 0 };
+		if(sr.hierarchy != nullptr || (sr.flags & SerializationRules::eExpandKeys)) {
+			apcf_serialize::serialize(serializeData, *this);
+		} else {
+			apcf_serialize::serializeTrie(serializeData, *this);
+		}
+	}
+
+	void TrieConfig::write(std::ostream& out, SerializationRules sr) const {
+		auto wr = io::StdStreamWriter(out);
+		write(wr, sr);
+	}
+
+
+
+	std::string ConfigView::serialize(SerializationRules sr) const {
+		std::string r;
+		auto wr = io::StringWriter(&r, 0);
+		write(wr, sr);
+		return r;
+	}
+
+	void ConfigView::write(io::Writer& out, SerializationRules sr) const {
+		SerializationState state = { };
+		SerializeData serializeData = {
+			.dst = out,
+			.rules = sr,
+			.state = state,
+			.lastLineFlags = 0 };
+		apcf_serialize::serialize(serializeData, *this);
+	}
+
+	void ConfigView::write(std::ostream& out, SerializationRules sr) const {
+		auto wr = io::StdStreamWriter(out);
+		write(wr, sr);
+	}
+
+
+	std::string PersistentConfig::serialize(SerializationRules sr) const {
+		std::string r;
+		auto wr = io::StringWriter(&r, 0);
+		write(wr, sr);
+		return r;
+	}
+
+	void PersistentConfig::write(io::Writer& out, SerializationRules sr) const {
+		SerializationState state = { };
+		SerializeData serializeData = {
+			.dst = out,
+			.rules = sr,
+			.state = state,
+			.lastLineFlags = 0 };
+		apcf_serialize::serialize(serializeData, *this);
+	}
+
+	void PersistentConfig::write(std::ostream& out, SerializationRules sr) const {
+		auto wr = io::StdStreamWriter(out);
+		write(wr, sr);
+	}
+
+
+
+	std::string LayeredConfig::serialize(SerializationRules sr) const {
+		std::string r;
+		auto wr = io::StringWriter(&r, 0);
+		write(wr, sr);
+		return r;
+	}
+
+	void LayeredConfig::write(io::Writer& out, SerializationRules sr) const {
+		SerializationState state = { };
+		SerializeData serializeData = {
+			.dst = out,
+			.rules = sr,
+			.state = state,
+			.lastLineFlags = 0 };
+		apcf_serialize::serialize(serializeData, *this);
+	}
+
+	void LayeredConfig::write(std::ostream& out, SerializationRules sr) const {
+		auto wr = io::StdStreamWriter(out);
+		write(wr, sr);
 	}
 
 }
@@ -0,0 +1,190 @@
+#include "apcf_.hpp"
+
+#include <apcf_shared.hpp>
+
+#include <algorithm>
+
+
+
+namespace {
+
+	/* Distinguishes SharedConfig instances in per-thread slot caches,
+	 * without the ABA problem of comparing their addresses. */
+	std::atomic<uint64_t> nextSharedConfigId = 1;
+
+}
+
+
+
+namespace apcf {
+
+	/* A hazard pointer: a snapshot's version cannot be destroyed while
+	 * the slot that acquired it refers to it.
+	 * Slots are only ever added to the list, and are reused by any thread;
+	 * each one gets its own cache line, so that readers do not contend. */
+	struct alignas(64) SharedConfig::Slot_ {
+		std::atomic<const Config*> hazard = nullptr;
+		std::atomic<bool> inUse = false;
+		Slot_* next = nullptr;
+	};
+
+
+	SharedConfig::Snapshot::Snapshot(SharedConfig& owner, Slot_* slot, const Config* cfg):
+			owner_(&owner),
+			slot_(slot),
+			cfg_(cfg)
+	{ }
+
+	SharedConfig::Snapshot::Snapshot(Snapshot&& mv) noexcept:
+			owner_(mv.owner_),
+			slot_(mv.slot_),
+			cfg_(mv.cfg_)
+	{
+		mv.slot_ = nullptr;
+	}
+
+	SharedConfig::Snapshot::~Snapshot() {
+		if(slot_ != nullptr) owner_->release_(slot_);
+	}
+
+
+	SharedConfig::SharedConfig():
+			SharedConfig(Config())
+	{ }
+
+	SharedConfig::SharedConfig(Config cfg):
+			current_(new const Config(std::move(cfg))),
+			slots_(nullptr),
+			hasRetired_(false),
+			id_(nextSharedConfigId.fetch_add(1, std::memory_order_relaxed))
+	{ }
+
+	SharedConfig::~SharedConfig() {
+		delete current_.load();
+		for(const Config* cfg : retired_) delete cfg;
+		Slot_* slot = slots_.load();
+		while(slot != nullptr) {
+			Slot_* next = slot->next;
+			delete slot;
+			slot = next;
+		}
+	}
+
+
+	SharedConfig::Slot_* SharedConfig::acquireSlot_() {
+		struct CachedSlot {
+			uint64_t ownerId;
+			Slot_* slot;
+		};
+		thread_local CachedSlot cached = { 0, nullptr };
+
+		auto tryAcquire = [](Slot_* slot) {
+			bool expected = false;
+			return
+				(! slot->inUse.load(std::memory_order_relaxed)) &&
+				slot->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire);
+		};
+
+		// A thread usually gets back the slot it used last
+		if(cached.ownerId == id_ && tryAcquire(cached.slot)) return cached.slot;
+
+		for(Slot_* slot = slots_.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+			if(tryAcquire(slot)) {
+				cached = { id_, slot };
+				return slot;
+			}
+		}
+
+		auto* slot = new Slot_;
+		slot->inUse.store(true, std::memory_order_relaxed);
+		Slot_* head = slots_.load(std::memory_order_relaxed);
+		do {
+			slot->next = head;
+		} while(! slots_.compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+		cached = { id_, slot };
+		return slot;
+	}
+
+
+	void SharedConfig::release_(Slot_* slot) noexcept {
+		/* Either the writer sees the cleared slot, or the reader sees the
+		 * retired version: both operations need to be sequentially consistent. */
+		slot->hazard.store(nullptr);
+		slot->inUse.store(false, std::memory_order_release);
+
+		// Readers never wait for the writer: if it is busy, it will reclaim the versions itself
+		if(hasRetired_.load()) {
+			std::unique_lock lock(writerMtx_, std::try_to_lock);
+			if(lock.owns_lock()) reclaim_();
+		}
+	}
+
+
+	void SharedConfig::reclaim_() noexcept {
+		Slot_* slots = slots_.load(std::memory_order_acquire);
+		auto isHazard = [slots](const Config* cfg) {
+			for(Slot_* slot = slots; slot != nullptr; slot = slot->next) {
+				if(slot->hazard.load() == cfg) return true;
+			}
+			return false;
+		};
+
+		// There are rarely more than a couple of retired versions, scanning the slots for each is cheap
+		auto kept = std::remove_if(retired_.begin(), retired_.end(), [&](const Config* cfg) {
+			if(isHazard(cfg)) return false;
+			delete cfg;
+			return true;
+		});
+		retired_.erase(kept, retired_.end());
+		hasRetired_.store(! retired_.empty(), std::memory_order_relaxed);
+	}
+
+
+	SharedConfig::Snapshot SharedConfig::snapshot() {
+		Slot_* slot = acquireSlot_();
+
+		/* The version is protected once the slot refers to it, but it may
+		 * have been replaced (and reclaimed) right before that: check again. */
+		const Config* cfg = current_.load(std::memory_order_acquire);
+		for(;;) {
+			slot->hazard.store(cfg);
+			const Config* check = current_.load();
+			if(check == cfg) break;
+			cfg = check;
+		}
+		return Snapshot(*this, slot, cfg);
+	}
+
+
+	void SharedConfig::replace_(std::unique_ptr<const Config> fresh) {
+		retired_.reserve(retired_.size() + 1);
+		retired_.push_back(current_.exchange(fresh.release()));
+		hasRetired_.store(true);
+		reclaim_();
+	}
+
+
+	void SharedConfig::publish(Config cfg) {
+		auto fresh = std::make_unique<const Config>(std::move(cfg));
+		std::lock_guard lock(writerMtx_);
+		replace_(std::move(fresh));
+	}
+
+
+	void SharedConfig::update(const std::function<void (Config&)>& fn) {
+		std::lock_guard lock(writerMtx_);
+
+		// Only writers replace the current version, and they all hold the lock
+		auto fresh = std::make_unique<Config>(*current_.load(std::memory_order_acquire));
+		fn(*fresh);
+		replace_(std::move(fresh));
+	}
+
+
+	size_t SharedConfig::retiredCount() {
+		std::lock_guard lock(writerMtx_);
+		reclaim_();
+		return retired_.size();
+	}
+
+}
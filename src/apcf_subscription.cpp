@@ -0,0 +1,132 @@
+#include "apcf_.hpp"
+
+#include <algorithm>
+
+
+
+namespace apcf {
+
+	Config::Subscriptions_::Subscription::Subscription(Key prefix, std::shared_ptr<const ChangeCallback> callback):
+			prefix(std::move(prefix)),
+			callback(std::move(callback))
+	{ }
+
+	Config::Subscriptions_::Subscription::Subscription(Subscription&&) noexcept = default;
+	Config::Subscriptions_::Subscription::~Subscription() = default;
+
+	Config::Subscriptions_::Subscription& Config::Subscriptions_::Subscription::operator=(Subscription&&) noexcept = default;
+
+	Config::Subscriptions_::Subscriptions_() = default;
+	Config::Subscriptions_::~Subscriptions_() = default;
+
+	Config::Generations_::Subtree::Subtree(uint64_t generation): generation(generation) { }
+	Config::Generations_::Subtree::Subtree(Subtree&&) noexcept = default;
+	Config::Generations_::Subtree::~Subtree() = default;
+
+	Config::Generations_::Subtree& Config::Generations_::Subtree::operator=(Subtree&&) noexcept = default;
+
+	Config::Generations_::Generations_() = default;
+	Config::Generations_::~Generations_() = default;
+
+
+	Config::SubscriptionId Config::subscribe(Key prefix, ChangeCallback callback) {
+		if(subscriptions_ == nullptr) subscriptions_ = std::make_unique<Subscriptions_>();
+		auto& subs = *subscriptions_;
+		auto id = subs.nextId ++;
+		subs.byPrefix[prefix].push_back(id);
+		subs.byId.emplace(id, Subscriptions_::Subscription(std::move(prefix), std::make_shared<const ChangeCallback>(std::move(callback))));
+		return id;
+	}
+
+
+	void Config::unsubscribe(SubscriptionId id) noexcept {
+		if(subscriptions_ == nullptr) return;
+		auto& subs = *subscriptions_;
+		auto found = subs.byId.find(id);
+		if(found == subs.byId.end()) return;
+		auto ids = subs.byPrefix.find(found->second.prefix);
+		std::erase(ids->second, id);
+		if(ids->second.empty()) subs.byPrefix.erase(ids);
+		subs.byId.erase(found);
+	}
+
+
+	size_t Config::subscriptionCount() const noexcept {
+		return (subscriptions_ == nullptr)? 0 : subscriptions_->byId.size();
+	}
+
+
+	uint64_t Config::generation(const Key& prefix) const {
+		if(generations_ == nullptr) generations_ = std::make_unique<Generations_>();
+		auto& subtrees = generations_->subtrees;
+		auto found = subtrees.find(std::string_view(prefix));
+		if(found == subtrees.end()) found = subtrees.emplace(prefix, Generations_::Subtree(generation_)).first;
+		return found->second.generation;
+	}
+
+
+	std::shared_ptr<const void> Config::findMemo_(const Key& prefix, std::type_index type, uint64_t* generationDst) const {
+		*generationDst = generation(prefix);
+		const auto& memos = generations_->subtrees.find(std::string_view(prefix))->second.memos;
+		auto found = memos.find(type);
+		if(found == memos.end() || found->second.generation != *generationDst) return nullptr;
+		return found->second.value;
+	}
+
+
+	void Config::storeMemo_(const Key& prefix, std::type_index type, uint64_t generation, std::shared_ptr<const void> value) const {
+		// The builder may have dropped the memos
+		this->generation(prefix);
+		auto& memos = generations_->subtrees.find(std::string_view(prefix))->second.memos;
+		memos.insert_or_assign(type, Generations_::Memo { .generation = generation, .value = std::move(value) });
+	}
+
+
+	void Config::dropMemos() noexcept {
+		generations_.reset();
+	}
+
+
+	void Config::notify_(const std::vector<Key>& explicitKeys) const {
+		assert(std::is_sorted(explicitKeys.begin(), explicitKeys.end()));
+
+		// Keys that fall back to the changed ones change as well
+		std::vector<Key> dependentKeys;
+		if(fallbacks_ != nullptr) [[unlikely]] dependentKeys = withFallbackDependents_(explicitKeys);
+		const auto& changedKeys = (fallbacks_ != nullptr)? dependentKeys : explicitKeys;
+
+		if(generations_ != nullptr) {
+			auto& subtrees = generations_->subtrees;
+			for(const auto& key : changedKeys) {
+				apcf_config::forEachPrefix(key, [&](std::string_view prefix) {
+					auto found = subtrees.find(prefix);
+					if(found != subtrees.end()) found->second.generation = generation_;
+				});
+			}
+		}
+		if(subscriptions_ == nullptr || subscriptions_->byId.empty()) return;
+		const auto& subs = *subscriptions_;
+
+		// Every prefix of each key is looked up, so that the cost does not depend on the number of subscriptions
+		std::unordered_map<SubscriptionId, std::vector<Key>> hits;
+		for(const auto& key : changedKeys) {
+			apcf_config::forEachPrefix(key, [&](std::string_view prefix) {
+				auto found = subs.byPrefix.find(prefix);
+				if(found == subs.byPrefix.end()) return;
+				for(auto id : found->second) hits[id].push_back(key);
+			});
+		}
+
+		// Callbacks may subscribe, unsubscribe or modify the Config: they are collected first, in order of subscription
+		std::vector<SubscriptionId> ids;
+		ids.reserve(hits.size());
+		for(const auto& hit : hits) ids.push_back(hit.first);
+		std::sort(ids.begin(), ids.end());
+		std::vector<std::pair<std::shared_ptr<const ChangeCallback>, std::vector<Key>>> calls;
+		calls.reserve(ids.size());
+		for(auto id : ids) calls.emplace_back(subs.byId.find(id)->second.callback, std::move(hits[id]));
+		hits.clear();
+		for(const auto& call : calls) (*call.first)(*this, call.second);
+	}
+
+}
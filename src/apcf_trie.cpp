@@ -0,0 +1,275 @@
+#include "apcf_.hpp"
+
+#include <apcf_trie.hpp>
+
+#include <cstring>
+
+
+
+namespace {
+
+	using ChildIter = apcf::TrieConfig::Node::ChildMap::const_iterator;
+
+
+	/* Whether `segment` begins with `prefix` followed by a '-', in which
+	 * case the keys of its subtree precede the ones in the subtree of
+	 * `prefix`. */
+	bool extendsSegment(std::string_view segment, std::string_view prefix) {
+		return
+			(segment.size() > prefix.size()) &&
+			(segment[prefix.size()] == '-') &&
+			(segment.compare(0, prefix.size(), prefix) == 0);
+	}
+
+
+	std::string_view segmentView(const apcf::Key& key, size_t index) {
+		apcf::KeySpan span = key.segments(index, index + 1);
+		return std::string_view(span.data(), span.size());
+	}
+
+
+	size_t countValues(const apcf::TrieConfig::Node& node) {
+		size_t r = (node.value() != nullptr)? 1 : 0;
+		for(const auto& child : node.children()) r += countValues(child.second);
+		return r;
+	}
+
+}
+
+
+
+namespace apcf {
+
+	TrieConfig::const_iterator::const_iterator(const Node& root):
+			value_(root.value())
+	{
+		frames_.push_back({ &root, root.children().begin(), 0 });
+		if(value_ == nullptr) ++ *this;
+	}
+
+
+	TrieConfig::const_iterator::const_iterator(const const_iterator&) = default;
+	TrieConfig::const_iterator::const_iterator(const_iterator&&) noexcept = default;
+	TrieConfig::const_iterator::~const_iterator() = default;
+
+	TrieConfig::const_iterator& TrieConfig::const_iterator::operator=(const const_iterator&) = default;
+	TrieConfig::const_iterator& TrieConfig::const_iterator::operator=(const_iterator&&) noexcept = default;
+
+
+	void TrieConfig::const_iterator::descend_(ChildIter child) {
+		truncate_(key_, frames_.size() - 1);
+		pushSegment_(key_, child->first);
+		frames_.push_back({ &child->second, child->second.children().begin(), pending_.size() });
+	}
+
+
+	TrieConfig::const_iterator& TrieConfig::const_iterator::operator++() {
+		value_ = nullptr;
+		while(! frames_.empty()) {
+			auto& frame = frames_.back();
+			bool hasPending = pending_.size() > frame.pendingBase;
+
+			if(frame.next != frame.node->children().end()) {
+				auto child = frame.next;
+				if(hasPending && ! extendsSegment(child->first, pending_.back()->first)) {
+					auto deferred = pending_.back();
+					pending_.pop_back();
+					descend_(deferred);
+					continue;
+				}
+				++ frame.next;
+				if(! child->second.children().empty()) pending_.push_back(child);
+				if(child->second.value() != nullptr) {
+					truncate_(key_, frames_.size() - 1);
+					pushSegment_(key_, child->first);
+					value_ = child->second.value();
+					return *this;
+				}
+			} else if(hasPending) {
+				auto deferred = pending_.back();
+				pending_.pop_back();
+				descend_(deferred);
+			} else {
+				frames_.pop_back();
+			}
+		}
+		return *this;
+	}
+
+
+	void TrieConfig::pushSegment_(Key& key, std::string_view segment) {
+		key.pushSegment_(segment);
+	}
+
+
+	void TrieConfig::truncate_(Key& key, size_t depth) {
+		key.truncate_(depth);
+	}
+
+
+	TrieConfig TrieConfig::parse(const char* cStr) {
+		return parse(cStr, strlen(cStr));
+	}
+
+	TrieConfig TrieConfig::parse(const char* charSeqPtr, size_t length) {
+		auto src = io::StringReader(std::span<const char>(charSeqPtr, length));
+		return read(src);
+	}
+
+	TrieConfig TrieConfig::read(io::Reader& in) {
+		apcf_parse::ParseData pd = {
+			.entries = { },
+			.src = in,
+			.keyStack = { } };
+		apcf_parse::parse(pd);
+
+		// Later definitions are inserted later, and override earlier ones
+		TrieConfig r;
+		for(auto& entry : pd.entries) {
+			r.set(entry.first, std::move(entry.second));
+		}
+		return r;
+	}
+
+	TrieConfig TrieConfig::read(std::istream& in) {
+		return read(in, std::numeric_limits<size_t>::max());
+	}
+
+	TrieConfig TrieConfig::read(std::istream& in, size_t count) {
+		auto src = io::StdStreamReader(in, count);
+		return read(src);
+	}
+
+
+	TrieConfig::TrieConfig(): size_(0) { }
+	TrieConfig::TrieConfig(const TrieConfig&) = default;
+	TrieConfig::TrieConfig(TrieConfig&&) noexcept = default;
+	TrieConfig::~TrieConfig() = default;
+
+	TrieConfig& TrieConfig::operator=(const TrieConfig&) = default;
+	TrieConfig& TrieConfig::operator=(TrieConfig&&) noexcept = default;
+
+
+	TrieConfig::TrieConfig(const Config& cfg):
+			TrieConfig()
+	{
+		for(const auto& entry : cfg) set(entry.first, entry.second);
+	}
+
+
+	Config TrieConfig::toConfig() const {
+		Config r;
+		for(const auto& entry : *this) r.set(entry.first, entry.second);
+		return r;
+	}
+
+
+	ConfigHierarchy TrieConfig::getHierarchy() const {
+		return ConfigHierarchy(*this);
+	}
+
+
+	const TrieConfig::Node* TrieConfig::findNode_(const Key& key) const noexcept {
+		const Node* node = &root_;
+		if(key.empty()) return node;
+		for(size_t i=0; i < key.getDepth(); ++i) {
+			auto found = node->children_.find(segmentView(key, i));
+			if(found == node->children_.end()) return nullptr;
+			node = &found->second;
+		}
+		return node;
+	}
+
+
+	TrieConfig TrieConfig::getSubconfig(const Key& group) const {
+		TrieConfig r;
+		const Node* node = findNode_(group);
+		if(node != nullptr) {
+			r.root_.children_ = node->children_;
+			r.size_ = countValues(r.root_);
+		}
+		return r;
+	}
+
+
+	std::optional<const RawData*> TrieConfig::get(const Key& key) const noexcept {
+		const Node* node = findNode_(key);
+		if(node == nullptr || ! node->value_.has_value()) return std::nullopt;
+		return &node->value_.value();
+	}
+
+	std::optional<bool> TrieConfig::getBool(const Key& key) const {
+		return apcf_config::asBool(get(key), key);
+	}
+
+	std::optional<int_t> TrieConfig::getInt(const Key& key) const {
+		return apcf_config::asInt(get(key), key);
+	}
+
+	std::optional<float_t> TrieConfig::getFloat(const Key& key) const {
+		return apcf_config::asFloat(get(key), key);
+	}
+
+	std::optional<string_t> TrieConfig::getString(const Key& key) const {
+		return apcf_config::asString(get(key), key);
+	}
+
+	std::optional<array_span_t> TrieConfig::getArray(const Key& key) const {
+		return apcf_config::asArray(get(key), key);
+	}
+
+
+	std::optional<std::string_view> TrieConfig::getStringView(const Key& key) const {
+		return apcf_config::asStringView(get(key), key);
+	}
+
+	const bool* TrieConfig::getBoolPtr(const Key& key) const {
+		return apcf_config::asBoolPtr(get(key), key);
+	}
+
+	const int_t* TrieConfig::getIntPtr(const Key& key) const {
+		return apcf_config::asIntPtr(get(key), key);
+	}
+
+	const float_t* TrieConfig::getFloatPtr(const Key& key) const {
+		return apcf_config::asFloatPtr(get(key), key);
+	}
+
+
+	void TrieConfig::set(const Key& key, RawData data) noexcept {
+		Node* node = &root_;
+		if(! key.empty()) {
+			for(size_t i=0; i < key.getDepth(); ++i) {
+				auto segment = segmentView(key, i);
+				auto found = node->children_.lower_bound(segment);
+				if(found == node->children_.end() || found->first != segment) {
+					found = node->children_.emplace_hint(found, std::string(segment), Node());
+				}
+				node = &found->second;
+			}
+		}
+		if(! node->value_.has_value()) ++ size_;
+		node->value_ = std::move(data);
+	}
+
+	void TrieConfig::setBool(const Key& key, bool value) noexcept {
+		set(key, RawData(value));
+	}
+
+	void TrieConfig::setInt(const Key& key, int_t value) noexcept {
+		set(key, RawData(value));
+	}
+
+	void TrieConfig::setFloat(const Key& key, float_t value) noexcept {
+		set(key, RawData(value));
+	}
+
+	void TrieConfig::setString(const Key& key, string_t value) noexcept {
+		set(key, RawData(value));
+	}
+
+	void TrieConfig::setArray(const Key& key, array_t array) noexcept {
+		set(key, RawData::moveArray(array.data(), array.size()));
+	}
+
+}
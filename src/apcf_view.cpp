@@ -0,0 +1,98 @@
+#include "apcf_.hpp"
+
+#include <iterator>
+
+
+
+namespace apcf {
+
+	ConfigView Config::getView(const Key& group) const {
+		return ConfigView(*this, group);
+	}
+
+
+	ConfigView::ConfigView(const Config& cfg, Key group):
+			cfg_(&cfg),
+			group_(std::move(group))
+	{ }
+
+
+	Config ConfigView::toConfig() const {
+		return cfg_->getSubconfig(group_);
+	}
+
+
+	ConfigView::const_iterator ConfigView::begin() const {
+		return const_iterator(cfg_->groupBegin_(group_), groupDepth_());
+	}
+
+	ConfigView::const_iterator ConfigView::end() const {
+		return const_iterator(cfg_->groupEnd_(group_), groupDepth_());
+	}
+
+
+	size_t ConfigView::entryCount() const {
+		return std::distance(begin(), end());
+	}
+
+
+	ConfigHierarchy ConfigView::getHierarchy() const {
+		return ConfigHierarchy(*this);
+	}
+
+
+	ConfigView ConfigView::getView(const Key& relGroup) const {
+		return ConfigView(*cfg_, Key(group_, relGroup));
+	}
+
+
+	std::optional<const RawData*> ConfigView::get(const Key& key) const {
+		const RawData* found = cfg_->findInGroup_(group_, key);
+		if(found == nullptr) return std::nullopt;
+		return found;
+	}
+
+	std::optional<const RawData*> ConfigView::getDefined(const Key& key) const noexcept {
+		const RawData* found = cfg_->findDefinedInGroup_(group_, key);
+		if(found == nullptr) return std::nullopt;
+		return found;
+	}
+
+	std::optional<bool> ConfigView::getBool(const Key& key) const {
+		return apcf_config::asBool(get(key), key);
+	}
+
+	std::optional<int_t> ConfigView::getInt(const Key& key) const {
+		return apcf_config::asInt(get(key), key);
+	}
+
+	std::optional<float_t> ConfigView::getFloat(const Key& key) const {
+		return apcf_config::asFloat(get(key), key);
+	}
+
+	std::optional<string_t> ConfigView::getString(const Key& key) const {
+		return apcf_config::asString(get(key), key);
+	}
+
+	std::optional<array_span_t> ConfigView::getArray(const Key& key) const {
+		return apcf_config::asArray(get(key), key);
+	}
+
+
+	std::optional<std::string_view> ConfigView::getStringView(const Key& key) const {
+		return apcf_config::asStringView(get(key), key);
+	}
+
+	const bool* ConfigView::getBoolPtr(const Key& key) const {
+		return apcf_config::asBoolPtr(get(key), key);
+	}
+
+	const int_t* ConfigView::getIntPtr(const Key& key) const {
+		return apcf_config::asIntPtr(get(key), key);
+	}
+
+	const float_t* ConfigView::getFloatPtr(const Key& key) const {
+		return apcf_config::asFloatPtr(get(key), key);
+	}
+
+}
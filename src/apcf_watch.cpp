@@ -0,0 +1,194 @@
+#include "apcf_.hpp"
+
+#include <apcf_watch.hpp>
+#include <apcf_diff.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+
+
+namespace {
+
+	constexpr uint32_t watchedEvents = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+
+	apcf::ConfigChanges changedKeys(const apcf::ConfigDiff& diff) {
+		apcf::ConfigChanges r;
+		r.added.reserve(diff.added.size());
+		r.removed.reserve(diff.removed.size());
+		r.changed.reserve(diff.changed.size());
+		for(const auto* entry : diff.added) r.added.push_back(entry->first);
+		for(const auto* entry : diff.removed) r.removed.push_back(entry->first);
+		for(const auto& entries : diff.changed) r.changed.push_back(entries.second->first);
+		return r;
+	}
+
+}
+
+
+
+namespace apcf {
+
+	ConfigChanges::ConfigChanges() = default;
+	ConfigChanges::ConfigChanges(const ConfigChanges&) = default;
+	ConfigChanges::ConfigChanges(ConfigChanges&&) noexcept = default;
+	ConfigChanges::~ConfigChanges() = default;
+
+	ConfigChanges& ConfigChanges::operator=(const ConfigChanges&) = default;
+	ConfigChanges& ConfigChanges::operator=(ConfigChanges&&) noexcept = default;
+
+
+	ConfigWatcher::File_::File_(std::string path, std::string name, int watchDescriptor, Config cfg):
+			path(std::move(path)),
+			name(std::move(name)),
+			watchDescriptor(watchDescriptor),
+			pending(false),
+			cfg(std::move(cfg))
+	{ }
+
+	ConfigWatcher::File_::File_(File_&&) noexcept = default;
+	ConfigWatcher::File_::~File_() = default;
+
+	ConfigWatcher::File_& ConfigWatcher::File_::operator=(File_&&) = default;
+
+
+	ConfigWatcher::ConfigWatcher(std::chrono::milliseconds debounce, std::chrono::milliseconds maxDebounce):
+			fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+			debounce_(debounce),
+			maxDebounce_(std::max(debounce, maxDebounce))
+	{
+		if(fd_ < 0) throw std::system_error(errno, std::generic_category(), "inotify_init1");
+	}
+
+
+	ConfigWatcher::~ConfigWatcher() {
+		::close(fd_);
+	}
+
+
+	const ConfigWatcher::File_* ConfigWatcher::find_(const std::string& path) const noexcept {
+		for(const auto& file : files_) {
+			if(file.path == path) return &file;
+		}
+		return nullptr;
+	}
+
+
+	const Config& ConfigWatcher::watch(const std::string& path) {
+		if(const File_* found = find_(path)) return found->cfg;
+
+		auto fsPath = std::filesystem::path(path);
+		auto dir = fsPath.parent_path();
+		if(dir.empty()) dir = ".";
+
+		/* Watching the same directory twice yields the same descriptor,
+		 * which is then shared by its files. */
+		int wd = inotify_add_watch(fd_, dir.c_str(), watchedEvents);
+		if(wd < 0) throw std::system_error(errno, std::generic_category(), "inotify_add_watch");
+
+		auto cfg = Config::read(std::ifstream(path));
+		files_.emplace_back(path, fsPath.filename().string(), wd, std::move(cfg));
+		return files_.back().cfg;
+	}
+
+
+	const Config& ConfigWatcher::config(const std::string& path) const {
+		const File_* found = find_(path);
+		if(found == nullptr) throw std::out_of_range("file \"" + path + "\" is not being watched");
+		return found->cfg;
+	}
+
+
+	void ConfigWatcher::onChange(Callback cb) {
+		callbacks_.push_back(std::move(cb));
+	}
+
+
+	bool ConfigWatcher::waitEvents_(std::chrono::milliseconds timeout) {
+		pollfd pfd = { .fd = fd_, .events = POLLIN, .revents = 0 };
+		int ms = (timeout.count() < 0)? -1 : int(timeout.count());
+		int polled;
+		do {
+			polled = ::poll(&pfd, 1, ms);
+		} while(polled < 0 && errno == EINTR);
+		if(polled < 0) throw std::system_error(errno, std::generic_category(), "poll");
+		return polled > 0;
+	}
+
+
+	void ConfigWatcher::readEvents_() {
+		alignas(inotify_event) char buffer[4096];
+		while(true) {
+			ssize_t rd = ::read(fd_, buffer, sizeof(buffer));
+			if(rd < 0) {
+				if(errno == EINTR) continue;
+				if(errno == EAGAIN || errno == EWOULDBLOCK) return;
+				throw std::system_error(errno, std::generic_category(), "read");
+			}
+			if(rd == 0) return;
+			for(ssize_t off = 0; off < rd; ) {
+				const auto* ev = reinterpret_cast<const inotify_event*>(buffer + off);
+				off += ssize_t(sizeof(inotify_event) + ev->len);
+				if(ev->mask & IN_Q_OVERFLOW) {
+					// Some events were dropped, so any file may have been written
+					for(auto& file : files_) file.pending = true;
+					continue;
+				}
+				if(ev->len == 0) continue;
+				auto name = std::string_view(ev->name);
+				for(auto& file : files_) {
+					if(file.watchDescriptor == ev->wd && file.name == name) file.pending = true;
+				}
+			}
+		}
+	}
+
+
+	size_t ConfigWatcher::reloadPending_() {
+		size_t r = 0;
+		for(auto& file : files_) {
+			if(! file.pending) continue;
+			file.pending = false;
+
+			// The file may have been removed after being written: keep the last version
+			auto in = std::ifstream(file.path);
+			if(! in.is_open()) continue;
+
+			auto cfg = Config::read(in);
+			auto changes = changedKeys(diff(file.cfg, cfg));
+			if(changes.empty()) continue;
+			file.cfg = std::move(cfg);
+			++ r;
+			for(const auto& cb : callbacks_) cb(file.path, file.cfg, changes);
+		}
+		return r;
+	}
+
+
+	size_t ConfigWatcher::poll(std::chrono::milliseconds timeout) {
+		bool pending = false;
+		for(const auto& file : files_) pending = pending || file.pending;
+
+		if(! pending) {
+			if(! waitEvents_(timeout)) return 0;
+		}
+		/* Files that are written continuously would never be reloaded
+		 * if only the debounce interval were waited for. */
+		auto deadline = std::chrono::steady_clock::now() + maxDebounce_;
+		while(true) {
+			readEvents_();
+			auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			if(remaining.count() <= 0) break;
+			if(! waitEvents_(std::min(debounce_, remaining))) break;
+		}
+		return reloadPending_();
+	}
+
+}
@@ -0,0 +1,140 @@
+#include <test_tools.hpp>
+
+#include <apcf.hpp>
+#include <apcf_concurrent.hpp>
+
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <shared_mutex>
+
+
+
+namespace {
+
+	using apcf::Config;
+
+	constexpr auto eNeutral = utest::ResultType::eNeutral;
+	constexpr auto eFailure = utest::ResultType::eFailure;
+
+	constexpr size_t keyCount = 100000;
+	constexpr size_t opsPerThread = 200000;
+
+	/* One write every `writeInterval` operations, the rest are reads. */
+	constexpr size_t writeInterval = 5;
+
+
+	uint_fast64_t nowUs() {
+		using Clock = std::chrono::steady_clock;
+		using Us = std::chrono::duration<uint_fast64_t, std::micro>;
+		using std::chrono::duration_cast;
+		static const auto epoch = Clock::now();
+		return duration_cast<Us>(Clock::now() - epoch).count();
+	}
+
+
+	const std::vector<apcf::Key>& benchKeys() {
+		static const auto keys = []() {
+			std::vector<apcf::Key> r;
+			r.reserve(keyCount);
+			for(size_t i=0; i < keyCount; ++i) {
+				std::string key = "group";
+				key.append(std::to_string(i % 97)).append(".key").append(std::to_string(i));
+				r.emplace_back(std::move(key));
+			}
+			return r;
+		} ();
+		return keys;
+	}
+
+
+	/* The baseline: a single Config, guarded by a single lock. */
+	class LockedConfig {
+	public:
+		mutable std::shared_mutex mtx;
+		Config cfg;
+
+		std::optional<apcf::int_t> getInt(const apcf::Key& key) const {
+			std::shared_lock lock(mtx);
+			return cfg.getInt(key);
+		}
+
+		void setInt(const apcf::Key& key, apcf::int_t value) {
+			std::unique_lock lock(mtx);
+			cfg.setInt(key, value);
+		}
+	};
+
+
+	/* Runs `threadCount` threads, each performing the same mix of reads
+	 * and writes on random keys; returns the elapsed time. */
+	template<typename Storage>
+	uint_fast64_t runMixed(Storage& storage, unsigned threadCount) {
+		const auto& keys = benchKeys();
+		std::vector<std::thread> threads;
+		std::atomic<apcf::int_t> checksum = 0;
+		auto begTime = nowUs();
+		for(unsigned t=0; t < threadCount; ++t) {
+			threads.emplace_back([&, t]() {
+				auto threadRng = std::minstd_rand(t + 1);
+				apcf::int_t sum = 0;
+				for(size_t i=0; i < opsPerThread; ++i) {
+					const auto& key = keys[threadRng() % keys.size()];
+					if(i % writeInterval == 0) {
+						storage.setInt(key, apcf::int_t(i));
+					} else {
+						sum += storage.getInt(key).value_or(0);
+					}
+				}
+				checksum += sum;
+			});
+		}
+		for(auto& thread : threads) thread.join();
+		return nowUs() - begTime;
+	}
+
+
+	template<unsigned threadCount>
+	utest::ResultType testMixedPerformance(std::ostream& out) {
+		const auto& keys = benchKeys();
+		Config initial;
+		for(size_t i=0; i < keys.size(); ++i) initial.setInt(keys[i], 0);
+
+		LockedConfig locked;
+		locked.cfg = initial;
+		apcf::ConcurrentConfig concurrent(initial);
+
+		auto lockedUs = runMixed(locked, threadCount);
+		auto concurrentUs = runMixed(concurrent, threadCount);
+
+		auto freezeBegTime = nowUs();
+		auto frozen = concurrent.freeze();
+		auto freezeUs = nowUs() - freezeBegTime;
+
+		out
+			<< threadCount << " threads, " << (threadCount * opsPerThread) << " operations on "
+			<< keys.size() << " keys took " << lockedUs << "us (locked Config), "
+			<< concurrentUs << "us (ConcurrentConfig); freezing took " << freezeUs << "us" << std::endl;
+
+		if(frozen.entryCount() != keys.size()) {
+			out << "Expected " << keys.size() << " frozen entries, found " << frozen.entryCount() << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+}
+
+
+
+int main(int, char**) {
+	auto batch = utest::TestBatch(std::cout);
+	batch
+		.run("Concurrent access benchmark (1 thread)",   testMixedPerformance<1>)
+		.run("Concurrent access benchmark (2 threads)",  testMixedPerformance<2>)
+		.run("Concurrent access benchmark (4 threads)",  testMixedPerformance<4>)
+		.run("Concurrent access benchmark (8 threads)",  testMixedPerformance<8>)
+		.run("Concurrent access benchmark (16 threads)", testMixedPerformance<16>);
+	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,12 +1,24 @@
 #include <test_tools.hpp>
 
 #include <apcf.hpp>
+#include <apcf_flat.hpp>
+#include <apcf_trie.hpp>
+#include <apcf_persistent.hpp>
+#include <apcf_diff.hpp>
+#include <apcf_incremental.hpp>
+#include <apcf_layered.hpp>
+#include <apcf_builder.hpp>
+#include <apcf_query.hpp>
+#include <apcf_hierarchy.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <cassert>
 #include <random>
 #include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <set>
 
 
 
@@ -192,6 +204,722 @@ namespace {
 			)? eNeutral : eFailure;
 	}
 
+
+	template<typename Storage>
+	uint_fast64_t benchmarkIteration(const Storage& storage, size_t* checksum) {
+		auto begTime = nowUs();
+		for(const auto& entry : storage) {
+			*checksum += entry.first.size() + size_t(entry.second.type);
+		}
+		return nowUs() - begTime;
+	}
+
+	template<typename Storage>
+	uint_fast64_t benchmarkLookups(const Storage& storage, const std::vector<apcf::Key>& keys, size_t* checksum) {
+		auto begTime = nowUs();
+		for(const auto& key : keys) {
+			*checksum += storage.get(key).has_value()? 1 : 0;
+		}
+		return nowUs() - begTime;
+	}
+
+	template<typename Storage>
+	uint_fast64_t benchmarkSerialization(const Storage& storage, size_t* checksum) {
+		auto begTime = nowUs();
+		*checksum += storage.serialize().size();
+		return nowUs() - begTime;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testStoragePerformance(std::ostream& out) {
+		constexpr unsigned lookupRepeat = 4;
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+		auto flat = apcf::FlatConfig::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+		auto trie = apcf::TrieConfig::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+		auto indexed = cfg;
+		auto indexBegTime = nowUs();
+		indexed.buildIndex();
+		auto indexUs = nowUs() - indexBegTime;
+
+		std::vector<apcf::Key> keys;
+		keys.reserve(cfg.entryCount() * lookupRepeat);
+		for(unsigned i=0; i < lookupRepeat; ++i) {
+			for(const auto& entry : cfg) keys.push_back(entry.first);
+		}
+		std::shuffle(keys.begin(), keys.end(), rng);
+
+		size_t cfgChecksum = 0;
+		size_t flatChecksum = 0;
+		size_t indexedChecksum = 0;
+		size_t trieChecksum = 0;
+		auto cfgIterUs = benchmarkIteration(cfg, &cfgChecksum);
+		auto flatIterUs = benchmarkIteration(flat, &flatChecksum);
+		auto cfgLookupUs = benchmarkLookups(cfg, keys, &cfgChecksum);
+		auto flatLookupUs = benchmarkLookups(flat, keys, &flatChecksum);
+		benchmarkIteration(indexed, &indexedChecksum); // Iteration does not use the index
+		auto indexedLookupUs = benchmarkLookups(indexed, keys, &indexedChecksum);
+		size_t batchChecksum = 0;
+		auto batchBegTime = nowUs();
+		auto batch = apcf::KeyBatch(keys);
+		auto batchSortUs = nowUs() - batchBegTime;
+		batchBegTime = nowUs();
+		for(const auto* value : cfg.getBatch(batch)) batchChecksum += (value != nullptr)? 1 : 0;
+		auto batchLookupUs = nowUs() - batchBegTime;
+		auto trieIterUs = benchmarkIteration(trie, &trieChecksum);
+		auto trieLookupUs = benchmarkLookups(trie, keys, &trieChecksum);
+		size_t cfgSerialSize = 0;
+		size_t trieSerialSize = 0;
+		auto cfgSerialUs = benchmarkSerialization(cfg, &cfgSerialSize);
+		auto trieSerialUs = benchmarkSerialization(trie, &trieSerialSize);
+		out
+			<< "Iterating over " << cfg.entryCount() << " entries took "
+			<< cfgIterUs << "us (Config), " << flatIterUs << "us (FlatConfig), "
+			<< trieIterUs << "us (TrieConfig)\n"
+			<< "Indexing " << cfg.entryCount() << " entries took " << indexUs << "us\n"
+			<< "Looking up " << keys.size() << " keys took "
+			<< cfgLookupUs << "us (Config), " << flatLookupUs << "us (FlatConfig), "
+			<< indexedLookupUs << "us (indexed Config), " << trieLookupUs << "us (TrieConfig), "
+			<< batchLookupUs << "us (Config, batched; sorting took " << batchSortUs << "us)\n"
+			<< "Serializing " << cfg.entryCount() << " entries took "
+			<< cfgSerialUs << "us (Config), " << trieSerialUs << "us (TrieConfig)" << std::endl;
+
+		if(
+			(cfgChecksum != flatChecksum) || (cfgChecksum != indexedChecksum) ||
+			(cfgChecksum != trieChecksum) || (cfgSerialSize != trieSerialSize) ||
+			(batchChecksum != keys.size())
+		) {
+			out << "Storage mismatch: the storage types visited different entries" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testMergePerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+
+		// Every entry of the base is overridden by the layer, half of the layer's entries are new
+		Config base = cfg.getSubconfig({ });
+		Config layer = cfg;
+		layer.mergeAsGroup("layer", cfg);
+
+		Config setDst = base;
+		auto setBegTime = nowUs();
+		for(const auto& entry : layer) setDst.set(entry.first, entry.second);
+		auto setUs = nowUs() - setBegTime;
+
+		Config copyDst = base;
+		auto copyBegTime = nowUs();
+		copyDst.merge(layer);
+		auto copyUs = nowUs() - copyBegTime;
+
+		Config moveDst = base;
+		Config moveSrc = layer;
+		auto moveBegTime = nowUs();
+		moveDst.merge(std::move(moveSrc));
+		auto moveUs = nowUs() - moveBegTime;
+
+		out
+			<< "Merging " << layer.entryCount() << " entries into " << base.entryCount() << " took "
+			<< setUs << "us (one `set` per entry), " << copyUs << "us (copy), "
+			<< moveUs << "us (move)" << std::endl;
+
+		if(copyDst.entryCount() != setDst.entryCount() || moveDst.entryCount() != setDst.entryCount()) {
+			out << "Merge mismatch: the merged configs have different entries" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testDiffPerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto former = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+
+		// One entry in 64 is changed, one in 256 is removed
+		Config latter;
+		size_t i = 0;
+		for(const auto& entry : former) {
+			if(i % 64 == 0) latter.setInt(entry.first, apcf::int_t(i));
+			else if(i % 256 != 1) latter.set(entry.first, entry.second);
+			++ i;
+		}
+
+		auto serialBegTime = nowUs();
+		bool serialEqual = (former.serialize() == latter.serialize());
+		auto serialUs = nowUs() - serialBegTime;
+
+		auto diffBegTime = nowUs();
+		auto diff = apcf::diff(former, latter);
+		auto diffUs = nowUs() - diffBegTime;
+
+		out
+			<< "Comparing " << former.entryCount() << " entries took "
+			<< serialUs << "us (serializing both), " << diffUs << "us (`apcf::diff`); "
+			<< diff.changed.size() << " changed, " << diff.removed.size() << " removed" << std::endl;
+
+		if(serialEqual || diff.empty() || ! diff.added.empty()) {
+			out << "Diff mismatch: the configs were not compared correctly" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testIncrementalPerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		std::string text;
+		{
+			std::ifstream in(cfgFilePath<pretty, rootGroups, depth>);
+			text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+		auto incremental = apcf::IncrementalConfig(text);
+
+		// Add an entry to the first group past the middle of the text
+		size_t groupBegin = text.find('{', text.size() / 2) + 1;
+		text.insert(groupBegin, " zzzzz = 1 ");
+
+		auto fullBegTime = nowUs();
+		auto full = Config::parse(text);
+		auto fullUs = nowUs() - fullBegTime;
+
+		auto incBegTime = nowUs();
+		size_t parsed = incremental.update(text);
+		auto incUs = nowUs() - incBegTime;
+
+		out
+			<< "Re-parsing " << text.size() << " bytes after an edit took "
+			<< fullUs << "us (whole text), " << incUs << "us (" << parsed << " bytes, incremental)" << std::endl;
+
+		if(incremental.config().entryCount() != full.entryCount()) {
+			out << "Re-parse mismatch: the configs have different entries" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testLayeredPerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto defaults = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+
+		// Each layer overrides a smaller fraction of the entries than the one below
+		std::vector<Config> layers;
+		layers.push_back(defaults);
+		for(size_t stride : { 4, 16, 64 }) {
+			Config layer;
+			size_t i = 0;
+			for(const auto& entry : defaults) {
+				if(i % stride == 0) layer.setInt(entry.first, apcf::int_t(i));
+				++ i;
+			}
+			layers.push_back(std::move(layer));
+		}
+
+		// Reloading the topmost layer
+		auto mergeBegTime = nowUs();
+		Config merged = layers.front();
+		for(size_t i=1; i < layers.size(); ++i) merged.merge(layers[i]);
+		auto mergeUs = nowUs() - mergeBegTime;
+
+		apcf::LayeredConfig layered;
+		for(size_t i=0; i+1 < layers.size(); ++i) layered.borrowLayer(layers[i]);
+		auto layerBegTime = nowUs();
+		layered.borrowLayer(layers.back());
+		auto layerUs = nowUs() - layerBegTime;
+
+		auto lookupAll = [&](const auto& cfg) {
+			apcf::int_t sum = 0;
+			auto begTime = nowUs();
+			for(const auto& entry : defaults) {
+				auto value = cfg.get(entry.first);
+				if(value.has_value() && value.value()->type == apcf::DataType::eInt) sum += value.value()->data.intValue;
+			}
+			return std::pair(nowUs() - begTime, sum);
+		};
+		auto mergedLookup = lookupAll(merged);
+		auto layeredLookup = lookupAll(layered);
+		layered.enableCache();
+		lookupAll(layered);
+		auto cachedLookup = lookupAll(layered);
+
+		out
+			<< "Reloading 1 of " << layers.size() << " layers took " << mergeUs << "us (merge), "
+			<< layerUs << "us (LayeredConfig)" << std::endl
+			<< "Looking up " << defaults.entryCount() << " keys took " << mergedLookup.first << "us (merged), "
+			<< layeredLookup.first << "us (layered), " << cachedLookup.first << "us (layered, cached)" << std::endl;
+
+		if(mergedLookup.second != layeredLookup.second || mergedLookup.second != cachedLookup.second) {
+			out << "Lookup mismatch: the layered config resolved different values" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testSubscriptionPerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+
+		// Every entry of the layer changes the value of an entry of the base
+		Config layer;
+		for(const auto& entry : cfg) layer.setString(entry.first, "changed");
+
+		// One subscription per group, at every level
+		std::set<std::string> prefixes;
+		for(const auto& entry : cfg) {
+			std::string_view key = entry.first;
+			for(size_t i = key.find('.'); i != key.npos; i = key.find('.', i + 1)) prefixes.emplace(key.substr(0, i));
+		}
+
+		auto mergeInto = [&](Config dst) {
+			auto begTime = nowUs();
+			dst.merge(layer);
+			return nowUs() - begTime;
+		};
+		auto unobservedUs = mergeInto(cfg);
+
+		Config observed = cfg;
+		size_t notifiedKeys = 0;
+		for(const auto& prefix : prefixes) {
+			observed.subscribe(apcf::Key(prefix), [&](const Config&, std::span<const apcf::Key> keys) { notifiedKeys += keys.size(); });
+		}
+		auto observedBegTime = nowUs();
+		observed.merge(layer);
+		auto observedUs = nowUs() - observedBegTime;
+
+		out
+			<< "Merging " << layer.entryCount() << " changed entries took " << unobservedUs << "us (unobserved), "
+			<< observedUs << "us (" << prefixes.size() << " subscriptions, " << notifiedKeys << " notified keys)" << std::endl;
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testSubtreeMovePerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+		std::set<std::string> groups;
+		for(const auto& entry : cfg) groups.emplace(entry.first.substr(0, entry.first.find('.')));
+		std::vector<apcf::Key> groupKeys(groups.begin(), groups.end());
+		groupKeys.resize(std::min<size_t>(groupKeys.size(), 16));
+
+		// Renaming groups by copying their entries, then rebuilding the config without the old ones
+		Config copied = cfg;
+		auto copyBegTime = nowUs();
+		for(const auto& group : groupKeys) {
+			copied.mergeAsGroup(apcf::Key("moved." + group), copied.getSubconfig(group));
+			Config rebuilt;
+			for(const auto& entry : copied) {
+				std::string_view key = entry.first;
+				bool inGroup = key.size() > group.size() && key.starts_with(group) && key[group.size()] == '.';
+				if(! inGroup) rebuilt.set(entry.first, entry.second);
+			}
+			copied = std::move(rebuilt);
+		}
+		auto copyUs = nowUs() - copyBegTime;
+
+		Config moved = cfg;
+		auto moveBegTime = nowUs();
+		for(const auto& group : groupKeys) moved.moveSubtree(group, apcf::Key("moved." + group));
+		auto moveUs = nowUs() - moveBegTime;
+
+		out
+			<< "Renaming " << groupKeys.size() << " groups of " << cfg.entryCount() << " entries took "
+			<< copyUs << "us (copy and rebuild), " << moveUs << "us (`moveSubtree`)" << std::endl;
+
+		if(copied.serialize() != moved.serialize()) {
+			out << "Move mismatch: the renamed configs have different entries" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testBuilderPerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+
+		// Generated entries are usually not sorted
+		std::vector<std::pair<std::string, apcf::RawData>> generated;
+		generated.reserve(cfg.entryCount());
+		for(const auto& entry : cfg) generated.emplace_back(entry.first, entry.second);
+		std::shuffle(generated.begin(), generated.end(), rng);
+
+		auto setBegTime = nowUs();
+		Config setCfg;
+		for(const auto& entry : generated) setCfg.set(apcf::Key(entry.first), entry.second);
+		auto setUs = nowUs() - setBegTime;
+
+		auto buildWith = [&](apcf::ConfigBuilder::KeyCheck keyCheck) {
+			auto copy = generated;
+			auto begTime = nowUs();
+			apcf::ConfigBuilder builder(keyCheck);
+			builder.reserve(copy.size());
+			for(auto& entry : copy) builder.add(std::move(entry.first), std::move(entry.second));
+			auto built = builder.build();
+			return std::pair(nowUs() - begTime, std::move(built));
+		};
+		auto validated = buildWith(apcf::ConfigBuilder::KeyCheck::eValidate);
+		auto trusted = buildWith(apcf::ConfigBuilder::KeyCheck::eTrust);
+
+		out
+			<< "Building " << generated.size() << " entries took " << setUs << "us (one `set` per entry), "
+			<< validated.first << "us (builder), " << trusted.first << "us (builder, trusted keys)" << std::endl;
+
+		if(validated.second.serialize() != setCfg.serialize() || trusted.second.entryCount() != setCfg.entryCount()) {
+			out << "Build mismatch: the built configs have different entries" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testHierarchyPerformance(std::ostream& out) {
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+
+		// A map of sets, with a Key for every level of every key
+		auto treeBegTime = nowUs();
+		std::map<apcf::Key, std::set<apcf::Key>> tree;
+		for(const auto& entry : cfg) {
+			const auto& key = entry.first;
+			size_t keyDepth = key.getDepth();
+			apcf::Key parent;
+			for(size_t i = 1; i <= keyDepth; ++i) {
+				auto level = key.ancestor(keyDepth - i);
+				tree[parent].insert(level);
+				parent = std::move(level);
+			}
+		}
+		auto treeUs = nowUs() - treeBegTime;
+
+		auto hierarchyBegTime = nowUs();
+		auto hierarchy = cfg.getHierarchy();
+		auto hierarchyUs = nowUs() - hierarchyBegTime;
+
+		// Every node is visited through its parent, looked up by key or by index
+		auto keyWalkBegTime = nowUs();
+		size_t keyVisited = 0;
+		std::vector<apcf::KeySpan> keyStack = { apcf::KeySpan() };
+		while(! keyStack.empty()) {
+			auto key = keyStack.back();
+			keyStack.pop_back();
+			for(auto subkey : hierarchy.getSubkeys(key)) {
+				keyStack.push_back(subkey);
+				++ keyVisited;
+			}
+		}
+		auto keyWalkUs = nowUs() - keyWalkBegTime;
+
+		auto walkBegTime = nowUs();
+		size_t visited = 0;
+		std::vector<apcf::ConfigHierarchy::node_index_t> stack = { apcf::ConfigHierarchy::rootIndex };
+		while(! stack.empty()) {
+			auto index = stack.back();
+			stack.pop_back();
+			auto subkeys = hierarchy.getSubkeys(index);
+			for(auto subkey = subkeys.begin(); subkey != subkeys.end(); ++ subkey) {
+				stack.push_back(subkey.nodeIndex());
+				++ visited;
+			}
+		}
+		auto walkUs = nowUs() - walkBegTime;
+
+		size_t treeKeys = 0;
+		for(const auto& level : tree) treeKeys += level.second.size();
+
+		out
+			<< "Building the hierarchy of " << cfg.entryCount() << " entries took "
+			<< treeUs << "us (map of sets), " << hierarchyUs << "us (linear pass); "
+			<< "visiting its " << visited << " keys took " << keyWalkUs << "us (by key), " << walkUs << "us (by index)" << std::endl;
+
+		if(visited != treeKeys || keyVisited != treeKeys || visited + 1 != hierarchy.nodeCount()) {
+			out << "Hierarchy mismatch: " << visited << " nodes were visited, expected " << treeKeys << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	utest::ResultType testNestedSerializationPerformance(std::ostream& out) {
+		constexpr size_t entryCount = 2000;
+		for(size_t chainDepth : { 4, 16, 64 }) {
+			// Pairs of entries at the end of long chains of single subkeys
+			Config cfg;
+			for(size_t i=0; i < entryCount / 2; ++i) {
+				std::string key = "r";
+				key.append(std::to_string(i));
+				for(size_t j=0; j < chainDepth; ++j) key.append(".n").append(std::to_string(j));
+				cfg.setInt(apcf::Key(key + ".x"), apcf::int_t(i));
+				cfg.setInt(apcf::Key(key + ".y"), apcf::int_t(i));
+			}
+
+			auto begTime = nowUs();
+			auto serialized = cfg.serialize();
+			auto us = nowUs() - begTime;
+			out
+				<< "Serializing " << entryCount << " entries nested " << chainDepth + 2 << " levels deep took "
+				<< us << "us (" << (double(us) / double(entryCount * (chainDepth + 2))) << "us per key segment)" << std::endl;
+
+			if(Config::parse(serialized).serialize() != serialized) {
+				out << "Serialization mismatch: the config changed after being parsed again" << std::endl;
+				return eFailure;
+			}
+		}
+		return eNeutral;
+	}
+
+
+	utest::ResultType testFallbackPerformance(std::ostream& out) {
+		constexpr size_t hostCount = 5000;
+		constexpr size_t settingCount = 16;
+		Config cfg;
+		for(size_t j=0; j < settingCount; ++j) cfg.setInt(apcf::Key("hosts.default.s" + std::to_string(j)), apcf::int_t(j));
+		std::vector<apcf::Key> keys;
+		for(size_t i=0; i < hostCount; ++i) {
+			auto host = "hosts.h" + std::to_string(i);
+			// Every host overrides a quarter of the settings
+			for(size_t j=0; j < settingCount; ++j) {
+				auto key = apcf::Key(host + ".s" + std::to_string(j));
+				if(j % 4 == i % 4) cfg.setInt(key, apcf::int_t(i));
+				keys.push_back(std::move(key));
+			}
+		}
+		std::shuffle(keys.begin(), keys.end(), rng);
+
+		// Falling back in application code
+		apcf::int_t manualSum = 0;
+		auto manualBegTime = nowUs();
+		for(const auto& key : keys) {
+			auto value = cfg.getIntPtr(key);
+			if(value == nullptr) {
+				auto fallback = apcf::Key("hosts.default." + key.basename());
+				value = cfg.getIntPtr(fallback);
+			}
+			if(value != nullptr) manualSum += *value;
+		}
+		auto manualUs = nowUs() - manualBegTime;
+
+		cfg.addGroupFallback("hosts", "default");
+		auto tableBegTime = nowUs();
+		cfg.resolveFallbacks();
+		auto tableUs = nowUs() - tableBegTime;
+
+		apcf::int_t fallbackSum = 0;
+		auto fallbackBegTime = nowUs();
+		for(const auto& key : keys) {
+			auto value = cfg.getIntPtr(key);
+			if(value != nullptr) fallbackSum += *value;
+		}
+		auto fallbackUs = nowUs() - fallbackBegTime;
+
+		// Setting existing entries keeps the table valid
+		auto setBegTime = nowUs();
+		for(size_t i=0; i < keys.size(); ++i) {
+			if(i % 16 == 0) cfg.setInt("hosts.default.s0", apcf::int_t(i % 2));
+			cfg.getIntPtr(keys[i]);
+		}
+		auto setUs = nowUs() - setBegTime;
+
+		out
+			<< "Looking up " << keys.size() << " keys, 3/4 of them through a fallback, took "
+			<< manualUs << "us (in application code), " << fallbackUs << "us (fallback table, built in " << tableUs << "us), "
+			<< setUs << "us (setting a fallback value every 16 lookups)" << std::endl;
+
+		if(manualSum != fallbackSum) {
+			out << "Fallback mismatch: the fallback table resolved different values" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	utest::ResultType testQueryPerformance(std::ostream& out) {
+		constexpr size_t hostCount = 5000;
+		constexpr size_t settingCount = 8;
+		apcf::ConfigBuilder builder;
+		for(size_t i=0; i < hostCount; ++i) {
+			auto host = "hosts.h" + std::to_string(i);
+			builder.add(host + ".port", apcf::RawData(apcf::int_t(i)));
+			for(size_t j=0; j < settingCount; ++j) {
+				builder.add(host + ".s" + std::to_string(j), apcf::RawData(apcf::int_t(j)));
+				builder.add("metrics.h" + std::to_string(i) + ".m" + std::to_string(j), apcf::RawData(apcf::int_t(j)));
+			}
+		}
+		auto cfg = builder.build();
+
+		// Matching every key in application code
+		apcf::int_t manualSum = 0;
+		size_t manualCount = 0;
+		auto manualBegTime = nowUs();
+		for(const auto& entry : cfg) {
+			const auto& key = entry.first;
+			if(key.getDepth() != 3) continue;
+			auto first = key.segments(0, 1);
+			auto last = key.segments(2, 3);
+			if(std::string_view(first.data(), first.size()) != "hosts" || std::string_view(last.data(), last.size()) != "port") continue;
+			manualSum += entry.second.data.intValue;
+			++ manualCount;
+		}
+		auto manualUs = nowUs() - manualBegTime;
+
+		auto queryBegTime = nowUs();
+		auto ports = apcf::queryInt(cfg, "hosts.*.port");
+		apcf::int_t querySum = 0;
+		for(auto value : ports.values) querySum += value;
+		auto queryUs = nowUs() - queryBegTime;
+
+		out
+			<< "Extracting " << ports.size() << " of " << cfg.entryCount() << " values took "
+			<< manualUs << "us (full iteration), " << queryUs << "us (query)" << std::endl;
+
+		if(manualSum != querySum || manualCount != ports.size()) {
+			out << "Query mismatch: the query matched different entries" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	utest::ResultType testMemoPerformance(std::ostream& out) {
+		constexpr size_t tenantCount = 5000;
+		Config cfg;
+		std::vector<apcf::Key> tenants;
+		for(size_t i=0; i < tenantCount; ++i) {
+			auto tenant = apcf::Key("tenant.t" + std::to_string(i));
+			for(size_t j=0; j < 8; ++j) cfg.setInt(apcf::Key(tenant, apcf::Key("route" + std::to_string(j))), apcf::int_t(i + j));
+			tenants.push_back(std::move(tenant));
+		}
+
+		// The derived state of each tenant is a serialization of its entries
+		auto build = [](const apcf::Key& tenant) { return [&tenant](const Config& cfg) { return cfg.getSubconfig(tenant).serialize(); }; };
+		auto deriveAll = [&](Config& cfg) {
+			auto begTime = nowUs();
+			for(const auto& tenant : tenants) cfg.memo<std::string>(tenant, build(tenant));
+			return nowUs() - begTime;
+		};
+		auto firstBuild = deriveAll(cfg);
+
+		// Reload a version that differs by a single tenant
+		auto reloaded = Config(cfg);
+		reloaded.setInt(apcf::Key(tenants[tenantCount / 2], apcf::Key("route0")), -1);
+		auto reloadBegTime = nowUs();
+		cfg = std::move(reloaded);
+		auto reloadUs = nowUs() - reloadBegTime;
+		auto rebuild = deriveAll(cfg);
+
+		out
+			<< "Deriving the state of " << tenantCount << " tenants took " << firstBuild << "us, then "
+			<< rebuild << "us after reloading one (reload: " << reloadUs << "us)" << std::endl;
+
+		const auto& changed = tenants[tenantCount / 2];
+		if(*cfg.memo<std::string>(changed, build(changed)) != cfg.getSubconfig(changed).serialize()) {
+			out << "Memo mismatch: the derived state of the reloaded tenant was not rebuilt" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testHandlePerformance(std::ostream& out) {
+		constexpr size_t hotKeyCount = 64;
+		constexpr size_t passCount = 1000;
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+
+		std::vector<apcf::Key> keys;
+		for(const auto& entry : cfg) keys.push_back(entry.first);
+		std::shuffle(keys.begin(), keys.end(), rng);
+		keys.resize(hotKeyCount);
+
+		auto sumOf = [](const apcf::RawData* value) {
+			return (value != nullptr && value->type == apcf::DataType::eInt)? value->data.intValue : 0;
+		};
+
+		apcf::int_t keySum = 0;
+		auto keyBegTime = nowUs();
+		for(size_t pass=0; pass < passCount; ++pass) {
+			for(const auto& key : keys) keySum += sumOf(cfg.get(key).value_or(nullptr));
+		}
+		auto keyUs = nowUs() - keyBegTime;
+
+		std::vector<Config::Handle> handles;
+		handles.reserve(keys.size());
+		for(const auto& key : keys) handles.push_back(cfg.resolve(key));
+		apcf::int_t handleSum = 0;
+		auto handleBegTime = nowUs();
+		for(size_t pass=0; pass < passCount; ++pass) {
+			for(const auto& handle : handles) handleSum += sumOf(handle.get());
+		}
+		auto handleUs = nowUs() - handleBegTime;
+
+		out
+			<< "Reading " << hotKeyCount << " of " << cfg.entryCount() << " keys " << passCount << " times took "
+			<< keyUs << "us (keys), " << handleUs << "us (handles)" << std::endl;
+
+		if(keySum != handleSum) {
+			out << "Lookup mismatch: the handles resolved different values" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
+
+	template<bool pretty, unsigned rootGroups, unsigned depth>
+	utest::ResultType testVersioningPerformance(std::ostream& out) {
+		constexpr size_t versionCount = 1000;
+		testPerformanceWr<pretty, rootGroups, depth>(out);
+		auto cfg = Config::read(std::ifstream(cfgFilePath<pretty, rootGroups, depth>));
+		auto persistent = apcf::PersistentConfig(cfg);
+
+		// Every version overrides one entry of the previous one
+		std::vector<apcf::Key> keys;
+		for(const auto& entry : cfg) keys.push_back(entry.first);
+		std::shuffle(keys.begin(), keys.end(), rng);
+
+		std::vector<Config> cfgVersions;
+		cfgVersions.reserve(versionCount);
+		auto cfgBegTime = nowUs();
+		cfgVersions.push_back(cfg);
+		for(size_t i=1; i < versionCount; ++i) {
+			cfgVersions.push_back(cfgVersions.back());
+			cfgVersions.back().setInt(keys[i % keys.size()], i);
+		}
+		auto cfgUs = nowUs() - cfgBegTime;
+
+		std::vector<apcf::PersistentConfig> persistentVersions;
+		persistentVersions.reserve(versionCount);
+		auto persistentBegTime = nowUs();
+		persistentVersions.push_back(persistent);
+		for(size_t i=1; i < versionCount; ++i) {
+			persistentVersions.push_back(persistentVersions.back().setInt(keys[i % keys.size()], i));
+		}
+		auto persistentUs = nowUs() - persistentBegTime;
+
+		out
+			<< "Creating " << versionCount << " versions of " << cfg.entryCount() << " entries took "
+			<< cfgUs << "us (Config), " << persistentUs << "us (PersistentConfig)" << std::endl;
+
+		if(cfgVersions.back().serialize() != persistentVersions.back().serialize()) {
+			out << "Version mismatch: the last versions have different entries" << std::endl;
+			return eFailure;
+		}
+		return eNeutral;
+	}
+
 }
 
 
@@ -202,6 +930,24 @@ int main(int, char**) {
 		.run("Parse/serialize benchmark (pretty, 8x4)", testPerformance<true, 8, 4>)
 		.run("Parse/serialize benchmark (mini, 8x4)", testPerformance<false, 8, 4>)
 		.run("Parse/serialize benchmark (pretty, 20x24)", testPerformance<true, 20, 24>)
-		.run("Parse/serialize benchmark (mini, 20x24)", testPerformance<false, 20, 24>);
+		.run("Parse/serialize benchmark (mini, 20x24)", testPerformance<false, 20, 24>)
+		.run("Storage benchmark (8x4)", testStoragePerformance<false, 8, 4>)
+		.run("Storage benchmark (20x24)", testStoragePerformance<false, 20, 24>)
+		.run("Storage benchmark (800x24)", testStoragePerformance<false, 800, 24>)
+		.run("Merge benchmark (20x24)", testMergePerformance<false, 20, 24>)
+		.run("Merge benchmark (800x24)", testMergePerformance<false, 800, 24>)
+		.run("Diff benchmark (800x24)", testDiffPerformance<false, 800, 24>)
+		.run("Incremental re-parse benchmark (pretty, 800x24)", testIncrementalPerformance<true, 800, 24>)
+		.run("Layered lookup benchmark (800x24)", testLayeredPerformance<false, 800, 24>)
+		.run("Lookup handle benchmark (800x24)", testHandlePerformance<false, 800, 24>)
+		.run("Subscription benchmark (800x24)", testSubscriptionPerformance<false, 800, 24>)
+		.run("Builder benchmark (800x24)", testBuilderPerformance<false, 800, 24>)
+		.run("Hierarchy benchmark (800x24)", testHierarchyPerformance<false, 800, 24>)
+		.run("Nested serialization benchmark", testNestedSerializationPerformance)
+		.run("Fallback benchmark (5000 hosts)", testFallbackPerformance)
+		.run("Query benchmark (5000 hosts)", testQueryPerformance)
+		.run("Memo benchmark (5000 tenants)", testMemoPerformance)
+		.run("Subtree move benchmark (800x24)", testSubtreeMovePerformance<false, 800, 24>)
+		.run("Versioning benchmark (20x24)", testVersioningPerformance<false, 20, 24>);
 	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -1,14 +1,31 @@
 #include <test_tools.hpp>
 
 #include <apcf.hpp>
+#include <apcf_flat.hpp>
 #include <apcf_hierarchy.hpp>
+#include <apcf_trie.hpp>
+#include <apcf_view.hpp>
+#include <apcf_bind.hpp>
+#include <apcf_shared.hpp>
+#include <apcf_concurrent.hpp>
+#include <apcf_diff.hpp>
+#include <apcf_incremental.hpp>
+#include <apcf_layered.hpp>
+#include <apcf_builder.hpp>
+#include <apcf_query.hpp>
+#include <apcf_watch.hpp>
+#include <apcf_persistent.hpp>
 #include <apcf_templates.hpp>
 
 #include <iostream>
 #include <fstream>
+#include <filesystem>
 #include <cstring>
 #include <cmath>
 #include <set>
+#include <thread>
+#include <atomic>
+#include <system_error>
 
 
 
@@ -73,6 +90,8 @@ namespace {
 				cerr << "Caught apcf::UnexpectedChar: " << err.what() << std::endl;
 			} catch(UnexpectedEof& err) {
 				cerr << "Caught apcf::UnexpectedEof: " << err.what() << std::endl;
+			} catch(std::system_error& err) {
+				cerr << "Caught std::system_error: " << err.what() << std::endl;
 			}
 			return eFailure;
 		};
@@ -143,6 +162,47 @@ namespace {
 		return checkValue<apcf::string_t>(cfg, out, "key.subkey.string", testString)? eSuccess : eFailure;
 	}
 
+	utest::ResultType testGetNoAlloc(std::ostream& out) {
+		Config cfg = Config::parse("s=\"str\" i=1 f=2.5 b=true");
+		bool r = true;
+
+		r = r & checkValue<std::string_view>(cfg, out, "s", "str");
+		auto view = cfg.getStringView("s");
+		if(view.has_value() && view->data() != cfg.get("s").value()->data.stringValue.data()) {
+			out << "String view does not refer to the stored string" << std::endl;
+			r = false;
+		}
+		if(cfg.getStringView("missing").has_value() || cfg.getIntPtr("missing") != nullptr) {
+			out << "Found a value for nonexistent key `missing`" << std::endl;
+			r = false;
+		}
+
+		auto checkPtr = [&]<typename T>(const Key& key, T expect) {
+			const T* got = apcf::getCfgValuePtr<T>(cfg, key);
+			if(got == nullptr || *got != expect) {
+				out << "Unexpected pointer value for `" << key << '`' << std::endl;
+				r = false;
+			}
+		};
+		checkPtr.operator()<apcf::int_t>("i", 1);
+		checkPtr.operator()<apcf::float_t>("f", 2.5);
+		checkPtr.operator()<bool>("b", true);
+
+		// Values are never converted, since there is nothing to point to
+		try {
+			(void) cfg.getStringView("i");
+			out << "Getting an integer as a string view did not throw" << std::endl;
+			r = false;
+		} catch(apcf::InvalidValue&) { }
+		try {
+			(void) cfg.getFloatPtr("i");
+			out << "Getting an integer as a fractional pointer did not throw" << std::endl;
+			r = false;
+		} catch(apcf::InvalidValue&) { }
+		return r? eSuccess : eFailure;
+	}
+
+
 	utest::ResultType testSetGetArray(std::ostream& out) {
 		Config cfg;
 		const apcf::array_t testArray = { apcf::int_t(3), apcf::int_t(5) };
@@ -220,6 +280,67 @@ namespace {
 			)? eSuccess : eFailure;
 	}
 
+	utest::ResultType testKeySegments(std::ostream& out) {
+		Key key = "a.bc.def";
+		bool r = true;
+		auto check = [&](const std::string& what, const std::string& got, const std::string& expect) {
+			if(got != expect) {
+				out << what << " returned \"" << got << "\", expected \"" << expect << '"' << std::endl;
+				r = false;
+			}
+		};
+		auto spanStr = [](apcf::KeySpan span) { return std::string(span.data(), span.size()); };
+		if(key.getDepth() != 3) {
+			out << "Key::getDepth returned " << key.getDepth() << ", expected 3" << std::endl;
+			r = false;
+		}
+		check("Key::ancestor(0)", key.ancestor(0), "a.bc.def");
+		check("Key::parent", key.parent(), "a.bc");
+		check("Key::ancestor(2)", key.ancestor(2), "a");
+		check("Key::ancestor(3)", key.ancestor(3), "");
+		check("Key::basename", key.basename(), "def");
+		check("Key::basenameSpan", spanStr(key.basenameSpan()), "def");
+		check("Key::parentSpan", spanStr(key.parentSpan()), "a.bc");
+		check("Key::segments(1, 3)", spanStr(key.segments(1, 3)), "bc.def");
+		check("Key::parent().basename", key.parent().basename(), "bc");
+		if(key.segments(1, 3).getDepth() != 2) {
+			out << "KeySpan::getDepth returned " << key.segments(1, 3).getDepth() << ", expected 2" << std::endl;
+			r = false;
+		}
+
+		// Spans of a key's prefix count the separators before their end
+		auto prefixDepth = [&](const Key& k, size_t end, size_t expected) {
+			auto depth = apcf::KeySpan(k, end).getDepth();
+			if(depth != expected) {
+				out << "KeySpan(\"" << k << "\", " << end << ").getDepth() returned " << depth << ", expected " << expected << std::endl;
+				r = false;
+			}
+		};
+		prefixDepth(Key("a.b"), 3, 2);
+		prefixDepth(Key("a.b"), 1, 1);
+		prefixDepth(Key("a"), 1, 1);
+		prefixDepth(Key("a.b.c.d.e.f.g.h"), 15, 8);
+		prefixDepth(Key("a.b.c.d.e.f.g.h"), 11, 6);
+		prefixDepth(Key("a.b.c.d.e.f.g.h"), 9, 5);
+
+		// Deeper keys than the separators stored within them
+		Key deep = Key(Key("a.b.c.d"), Key("e.f.g.h.i"));
+		if(deep.getDepth() != 9) {
+			out << "Key::getDepth returned " << deep.getDepth() << ", expected 9" << std::endl;
+			r = false;
+		}
+		check("Key::segments(6, 8)", spanStr(deep.segments(6, 8)), "g.h");
+		check("Key::segments(3, 9)", spanStr(deep.segments(3, 9)), "d.e.f.g.h.i");
+		check("Key::ancestor(1) (deep)", deep.ancestor(1), "a.b.c.d.e.f.g.h");
+		check("Key::ancestor(1).basename (deep)", deep.ancestor(1).basename(), "h");
+		check("Key::basename (deep)", deep.basename(), "i");
+		if(deep.segments(6, 8).getDepth() != 2 || deep.ancestor(2).getDepth() != 7) {
+			out << "Wrong depth for the segments of a deep key" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
 	utest::ResultType testReadOnelineCommentEof(std::ostream&) {
 		Config cfg = Config::parse("// comment + eof */");
 		return cfg.begin() == cfg.end()? eSuccess : eFailure;
@@ -267,6 +388,18 @@ namespace {
 		}
 	}
 
+	utest::ResultType testRedefinition(std::ostream& out) {
+		Config cfg = Config::parse("a=1 b=2 a=3 g { a=4 } g.a=5 b=6");
+		return
+			bool(
+				checkValue<apcf::int_t>(cfg, out, "a", 3) &
+				checkValue<apcf::int_t>(cfg, out, "b", 6) &
+				checkValue<apcf::int_t>(cfg, out, "g.a", 5) &
+				(cfg.entryCount() == 3)
+			)? eSuccess : eFailure;
+	}
+
+
 	utest::ResultType testUnclosedGroup(std::ostream& out) {
 		try {
 			Config cfg = Config::parse(" group1 { group2 { } ");
@@ -311,6 +444,68 @@ namespace {
 	}
 
 
+	template<bool doMove>
+	utest::ResultType testMergeInterleaved(std::ostream& out) {
+		// Sparse and dense runs of keys on both sides, some of them overlapping
+		Config base;
+		Config other;
+		Config expect;
+		auto numberedKey = [](apcf::int_t i) { std::string r = "k"; r.append(std::to_string(i)); return Key(std::move(r)); };
+		for(apcf::int_t i=0; i < 200; i += 2) base.setInt(numberedKey(i), i);
+		for(apcf::int_t i=0; i < 200; i += 3) other.setInt(numberedKey(i), -i);
+		other.setInt("a", 1);
+		other.setInt("z.z", 2);
+		for(const auto& entry : base) expect.set(entry.first, entry.second);
+		for(const auto& entry : other) expect.set(entry.first, entry.second);
+		for(const auto& entry : other) expect.set(Key({ "g", entry.first.c_str() }), entry.second);
+		base.setInt("g-x", 3);
+		expect.setInt("g-x", 3);
+		base.buildIndex();
+
+		if constexpr(doMove) {
+			Config otherCp = other;
+			base.merge(std::move(otherCp));
+			base.mergeAsGroup("g", std::move(other));
+			if(otherCp.entryCount() != 0 || other.entryCount() != 0) {
+				out << "Moved-from configs are not empty" << std::endl;
+				return eFailure;
+			}
+		} else {
+			base.merge(other);
+			base.mergeAsGroup("g", other);
+		}
+
+		if(base.serialize() != expect.serialize()) {
+			out << "Merged config differs from the expected one" << std::endl;
+			return eFailure;
+		}
+		for(const auto& entry : expect) {
+			auto got = base.get(entry.first);
+			if(! got.has_value() || got.value()->serialize() != entry.second.serialize()) {
+				out << "Indexed lookup of `" << entry.first << "` failed after merging" << std::endl;
+				return eFailure;
+			}
+		}
+
+		// Merging a config into itself changes nothing, unless it goes into a group
+		auto merged = base.serialize();
+		if constexpr(doMove) base << std::move(base);
+		else base << base;
+		if(base.serialize() != merged) {
+			out << "Merging a config into itself changed it" << std::endl;
+			return eFailure;
+		}
+		size_t entryCount = base.entryCount();
+		if constexpr(doMove) base.mergeAsGroup("self", std::move(base));
+		else base.mergeAsGroup("self", base);
+		if(base.entryCount() != 2 * entryCount || base.getInt("self.z.z") != 2 || base.getInt("z.z") != 2) {
+			out << "Merging a config into its own group failed" << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
 	utest::ResultType testGetSubkeys(std::ostream& out) {
 		constexpr unsigned expectedSubkeys = 3;
 		Config cfg = Config::parse("a=1 a.b=2 a.c=3 a.d.e=4 a.d.f=5 g=6 h.i=7");
@@ -327,6 +522,83 @@ namespace {
 	}
 
 
+	utest::ResultType testHierarchy(std::ostream& out) {
+		// Hyphens sort before separators, so "a" is reopened after "a-b"
+		Config cfg = Config::parse("a=1 a-b.x=2 a-b-c=3 a.b=4 a.c.d.e=5 f.g=6");
+		auto hierarchy = cfg.getHierarchy();
+		bool r = true;
+
+		auto expectSubkeys = [&](const apcf::ConfigHierarchy& h, const char* key, std::vector<std::string_view> expected) {
+			std::vector<std::string_view> subkeys;
+			for(auto subkey : h.getSubkeys(key)) subkeys.emplace_back(subkey.data(), subkey.size());
+			if(subkeys != expected) {
+				out << "Unexpected subkeys of \"" << key << "\":";
+				for(auto subkey : subkeys) out << ' ' << subkey;
+				out << std::endl;
+				r = false;
+			}
+		};
+
+		expectSubkeys(hierarchy, "", { "a", "a-b", "a-b-c", "f" });
+		expectSubkeys(hierarchy, "a", { "a.b", "a.c" });
+		expectSubkeys(hierarchy, "a-b", { "a-b.x" });
+		expectSubkeys(hierarchy, "a.c.d", { "a.c.d.e" });
+		expectSubkeys(hierarchy, "a.b", { });
+		expectSubkeys(hierarchy, "nothing.here", { });
+		if(hierarchy.nodeCount() != 11) {
+			out << "Expected 11 nodes, got " << hierarchy.nodeCount() << std::endl;
+			r = false;
+		}
+
+		auto completed = hierarchy.autocomplete("a.c");
+		if(std::string_view(completed.data(), completed.size()) != "a.c.d.e" || completed.getDepth() != 4) {
+			out << "Unexpected autocompletion" << std::endl;
+			r = false;
+		}
+
+		// Chains are compressed upon construction
+		auto ac = hierarchy.findNode(apcf::KeySpan("a.c", 3));
+		auto ab = hierarchy.findNode(apcf::KeySpan("a.b", 3));
+		if(
+			! ac.has_value() || ! ab.has_value() || hierarchy.findNode(apcf::KeySpan("a.z", 3)).has_value() ||
+			hierarchy.autocomplete(*ac) != hierarchy.findNode(apcf::KeySpan("a.c.d.e", 7)) ||
+			hierarchy.autocomplete(*ab) != *ab
+		) {
+			out << "Unexpected autocompleted nodes" << std::endl;
+			r = false;
+		}
+		std::vector<std::string_view> compressed;
+		for(auto subkey : hierarchy.getCompressedSubkeys("a")) compressed.emplace_back(subkey.data(), subkey.size());
+		for(auto subkey : hierarchy.getCompressedSubkeys("")) compressed.emplace_back(subkey.data(), subkey.size());
+		if(compressed != std::vector<std::string_view> { "a.b", "a.c.d.e", "a", "a-b.x", "a-b-c", "f.g" }) {
+			out << "Unexpected compressed subkeys:";
+			for(auto subkey : compressed) out << ' ' << subkey;
+			out << std::endl;
+			r = false;
+		}
+
+		// Hierarchies can still be built from plain maps
+		std::map<Key, apcf::RawData> map(cfg.begin(), cfg.end());
+		apcf::ConfigHierarchy fromMap = map;
+		expectSubkeys(fromMap, "", { "a", "a-b", "a-b-c", "f" });
+		expectSubkeys(fromMap, "a", { "a.b", "a.c" });
+
+		std::vector<Key> keys = { "h", "a.c.z" };
+		for(const auto& entry : cfg) keys.push_back(entry.first);
+		keys.push_back("h");
+		apcf::ConfigHierarchy fromKeys(std::move(keys));
+		expectSubkeys(fromKeys, "a.c", { "a.c.d", "a.c.z" });
+		expectSubkeys(fromKeys, "", { "a", "a-b", "a-b-c", "f", "h" });
+
+		auto reparsed = Config::parse(cfg.serialize());
+		if(reparsed.serialize() != cfg.serialize() || reparsed.entryCount() != cfg.entryCount()) {
+			out << "The config changed after serialization:\n" << reparsed.serialize() << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
 	utest::ResultType testStrConfig(std::ostream& out) {
 		Config cfg = Config::parse("nothing = \"zero\"\n generic.key = \"one backslash \\\\ \\\"double quote\\\"\"");
 		return checkValue<apcf::string_t>(cfg, out, "generic.key", "one backslash \\ \"double quote\"")? eSuccess : eFailure;
@@ -469,6 +741,63 @@ namespace {
 	}
 
 
+	utest::ResultType testSubconfigAdjacentKeys(std::ostream& out) {
+		// "g" and "g-x" sort right before the group's entries
+		Config cfg = Config::parse("g=1 g-x=2 g.a=3 g.b.c=4 g0=5");
+		Config subCfg = cfg.getSubconfig("g");
+		return
+			bool(
+				checkValue<apcf::int_t>(subCfg, out, "a", 3) &
+				checkValue<apcf::int_t>(subCfg, out, "b.c", 4) &
+				(subCfg.entryCount() == 2)
+			)? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testConfigView(std::ostream& out) {
+		Config cfg = Config::parse("g=1 g-x=2 g.a=3 g.b.c=4 g.b.d=[5] g0=6");
+		auto view = cfg.getView("g");
+		bool r = true;
+
+		std::vector<std::string> expectKeys = { "a", "b.c", "b.d" };
+		std::vector<std::string> keys;
+		for(const auto& entry : view) keys.emplace_back(entry.first.data(), entry.first.size());
+		if(keys != expectKeys) {
+			out << "Unexpected view keys:";
+			for(const auto& key : keys) out << " `" << key << '`';
+			out << std::endl;
+			r = false;
+		}
+
+		auto checkInt = [&](const apcf::ConfigView& v, const Key& key, std::optional<apcf::int_t> expect) {
+			auto got = v.getInt(key);
+			if(got != expect) {
+				out << "Unexpected value for `" << key << "` in view `" << v.group() << '`' << std::endl;
+				r = false;
+			}
+		};
+		checkInt(view, "a", 3);
+		checkInt(view, "b.c", 4);
+		checkInt(view, "x", std::nullopt);
+		checkInt(view.getView("b"), "c", 4);
+		checkInt(cfg.getView({ }), "g-x", 2);
+
+		// The view refers to the Config, and sees its changes
+		cfg.setInt("g.e", 7);
+		checkInt(view, "e", 7);
+
+		if(view.entryCount() != 4) {
+			out << "View has " << view.entryCount() << " entries, expected 4" << std::endl;
+			r = false;
+		}
+		if(view.serialize() != cfg.getSubconfig("g").serialize()) {
+			out << "Serialized view differs from the equivalent subconfig:\n" << view.serialize() << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
 	template<bool existing>
 	utest::ResultType testMergeAsGroup(std::ostream& out) {
 		Config cfg = Config::parse("group1.1=11 group1.2=12");
@@ -492,6 +821,1244 @@ namespace {
 		}
 	}
 
+
+	utest::ResultType testIndex(std::ostream& out) {
+		Config cfg = Config::parse("a=1 b.c=2 b.d=3");
+		cfg.buildIndex();
+		cfg.setInt("b.e", 4);
+		cfg.setInt("a", 5);
+		cfg.merge(Config::parse("f=6 b.c=7"));
+		Config cp = cfg;
+		cfg.setInt("a", 8);
+		bool r =
+			checkValue<apcf::int_t>(cfg, out, "a", 8) &
+			checkValue<apcf::int_t>(cfg, out, "b.c", 7) &
+			checkValue<apcf::int_t>(cfg, out, "b.e", 4) &
+			checkValue<apcf::int_t>(cfg, out, "f", 6) &
+			checkValue<apcf::int_t>(cp, out, "a", 5) &
+			checkValue<apcf::int_t>(cp, out, "b.d", 3);
+		if(! cp.isIndexed()) {
+			out << "The copy of an indexed Config is not indexed" << std::endl;
+			r = false;
+		}
+		if(cfg.get("b").has_value()) {
+			out << "Found a value for nonexistent key `b`" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	template<bool indexed>
+	utest::ResultType testBatchLookup(std::ostream& out) {
+		Config cfg = Config::parse(genericConfigSrc);
+		for(unsigned i=0; i < 40; ++i) cfg.setInt(Key("filler.k" + std::to_string(i)), i);
+		if constexpr(indexed) cfg.buildIndex();
+		std::vector<Key> keys = {
+			"rootvalue-int", "1.1", "filler.k3", "missing", "1.1",
+			"group1.group3.value1", "long.single.line.group.1.2.value2", "filler.k39", "group1" };
+		auto batch = apcf::KeyBatch(keys);
+		auto values = cfg.getBatch(batch);
+		bool r = true;
+		for(size_t i=0; i < keys.size(); ++i) {
+			auto expect = cfg.get(keys[i]).value_or(nullptr);
+			if(values[i] != expect) {
+				out << "Batch lookup mismatch for `" << keys[i] << '`' << std::endl;
+				r = false;
+			}
+		}
+		auto ints = apcf::getCfgValues<apcf::int_t>(cfg, apcf::KeyBatch { "filler.k7", "missing", "1" });
+		if(ints.size() != 3 || ints[0] != 7 || ints[1].has_value() || ints[2] != 1) {
+			out << "Unexpected typed batch lookup results" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testFlatConfig(std::ostream& out) {
+		Config cfg = Config::parse(genericConfigSrc);
+		apcf::FlatConfig flat = apcf::FlatConfig::parse(genericConfigSrc);
+		bool r = true;
+
+		// Enough insertions to trigger at least one merge of the buffer
+		for(unsigned i=0; i < 40; ++i) {
+			auto key = Key("inserted.k" + std::to_string((i * 7) % 40));
+			cfg.setInt(key, i);
+			flat.setInt(key, i);
+		}
+		cfg.setInt("1.1", 99);
+		flat.setInt("1.1", 99);
+
+		if(flat.entryCount() != cfg.entryCount()) {
+			out
+				<< "Entry count mismatch: " << flat.entryCount()
+				<< ", expected " << cfg.entryCount() << std::endl;
+			return eFailure;
+		}
+		auto flatIter = flat.begin();
+		for(const auto& entry : cfg) {
+			if(flatIter->first != entry.first) {
+				out
+					<< "Iteration order mismatch: found `" << flatIter->first
+					<< "`, expected `" << entry.first << '`' << std::endl;
+				return eFailure;
+			}
+			auto got = flat.get(entry.first);
+			if(! got.has_value()) {
+				out << "Entry not found for `" << entry.first << '`' << std::endl;
+				r = false;
+			} else if(got.value()->serialize() != entry.second.serialize()) {
+				out << "Value mismatch for `" << entry.first << '`' << std::endl;
+				r = false;
+			}
+			++ flatIter;
+		}
+		if(flat.get("inserted").has_value()) {
+			out << "Found a value for nonexistent key `inserted`" << std::endl;
+			r = false;
+		}
+
+		if(flat.serialize() != cfg.serialize()) {
+			out << "Serialized FlatConfig differs from the Config it was compared to" << std::endl;
+			r = false;
+		}
+		if(apcf::FlatConfig(cfg).toConfig().serialize() != cfg.serialize()) {
+			out << "Config -> FlatConfig -> Config conversion is lossy" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testTrieConfig(std::ostream& out) {
+		// Segments that extend others with a '-' precede their groups
+		constexpr const char* src =
+			"a=1 a.b=2 a-b=3 a-b.c=4 a-b-c.d=5 a0=6 a.c.d=[7] "
+			"g { x=8 y.z=9 y-z=10 }";
+		Config cfg = Config::parse(std::string(genericConfigSrc) + src);
+		apcf::TrieConfig trie = apcf::TrieConfig::parse(std::string(genericConfigSrc) + src);
+		bool r = true;
+
+		if(trie.entryCount() != cfg.entryCount()) {
+			out
+				<< "Entry count mismatch: " << trie.entryCount()
+				<< ", expected " << cfg.entryCount() << std::endl;
+			return eFailure;
+		}
+		auto trieIter = trie.begin();
+		for(const auto& entry : cfg) {
+			if(trieIter == trie.end() || trieIter->first != entry.first) {
+				out << "Iteration order mismatch at `" << entry.first << '`' << std::endl;
+				return eFailure;
+			}
+			auto got = trie.get(entry.first);
+			if(! got.has_value() || got.value()->serialize() != entry.second.serialize()) {
+				out << "Value mismatch for `" << entry.first << '`' << std::endl;
+				r = false;
+			}
+			++ trieIter;
+		}
+
+		for(unsigned flags : { 0u, unsigned(apcf::SerializationRules::eMinimized) }) {
+			apcf::SerializationRules rules = { };
+			rules.flags = flags;
+			auto serial = trie.serialize(rules);
+			if(serial != cfg.serialize(rules)) {
+				out << "Serialized TrieConfig differs from the Config it was compared to:\n" << serial << std::endl;
+				r = false;
+			}
+			if(Config::parse(serial).entryCount() != cfg.entryCount()) {
+				out << "Serialized TrieConfig lost entries:\n" << serial << std::endl;
+				r = false;
+			}
+		}
+
+		auto sub = trie.getSubconfig("g");
+		auto cfgSub = cfg.getSubconfig("g");
+		if(sub.entryCount() != 3 || sub.serialize() != cfgSub.serialize()) {
+			out << "Unexpected subconfig:\n" << sub.serialize() << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testPersistentConfig(std::ostream& out) {
+		Config cfg = Config::parse(genericConfigSrc);
+		apcf::PersistentConfig base = apcf::PersistentConfig::parse(genericConfigSrc);
+		bool r = true;
+
+		if(base.serialize() != cfg.serialize() || apcf::PersistentConfig(cfg).toConfig().serialize() != cfg.serialize()) {
+			out << "PersistentConfig differs from the Config it was compared to" << std::endl;
+			r = false;
+		}
+
+		// Every version differs from the previous one by one entry, and none of them changes
+		std::vector<apcf::PersistentConfig> versions = { base };
+		for(apcf::int_t i=0; i < 100; ++i) {
+			auto key = Key({ "version", (i % 2 == 0)? "even" : "odd" });
+			versions.push_back(versions.back().setInt(key, i));
+		}
+		for(apcf::int_t i=1; i < apcf::int_t(versions.size()); ++i) {
+			auto& version = versions[i];
+			auto key = Key({ "version", ((i-1) % 2 == 0)? "even" : "odd" });
+			if(version.getInt(key) != i-1 || version.identical(versions[i-1])) {
+				out << "Version " << i << " has unexpected entries" << std::endl;
+				r = false;
+				break;
+			}
+		}
+		if(versions[0].getInt("version.even").has_value() || versions.back().entryCount() != base.entryCount() + 2) {
+			out << "Setting an entry modified the original version" << std::endl;
+			r = false;
+		}
+
+		auto copy = versions.back();
+		if(! copy.identical(versions.back())) {
+			out << "A copy does not share the original's tree" << std::endl;
+			r = false;
+		}
+
+		auto erased = versions.back().erase("version.even").erase("version.odd");
+		if(erased.serialize() != base.serialize() || erased.entryCount() != base.entryCount()) {
+			out << "Erasing the added entries does not yield the original entries:\n" << erased.serialize() << std::endl;
+			r = false;
+		}
+		if(! erased.erase("nonexistent").identical(erased)) {
+			out << "Erasing a nonexistent entry created a new version" << std::endl;
+			r = false;
+		}
+
+		// Many insertions and removals in a row keep the tree balanced
+		apcf::PersistentConfig large;
+		for(apcf::int_t i=0; i < 4096; ++i) large = large.setInt(Key({ "k", std::to_string((i * 7919) % 4096).c_str() }), i);
+		for(apcf::int_t i=0; i < 4096; i += 2) large = large.erase(Key({ "k", std::to_string(i).c_str() }));
+		if(large.entryCount() != 2048 || large.root()->height > 2 * 12) {
+			out << "Unexpected tree after many updates: " << large.entryCount() << " entries, height " << large.root()->height << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testSharedConfig(std::ostream& out) {
+		apcf::SharedConfig shared(Config::parse("a=0 b=0"));
+		bool r = true;
+
+		{
+			auto old = shared.snapshot();
+			shared.update([](Config& cfg) { cfg.setInt("a", 1); cfg.setInt("b", 1); });
+			if(old->getInt("a") != 0 || shared.snapshot()->getInt("a") != 1) {
+				out << "Snapshots do not refer to the expected versions" << std::endl;
+				r = false;
+			}
+			if(shared.retiredCount() != 1) {
+				out << "A version was reclaimed while a snapshot referred to it" << std::endl;
+				r = false;
+			}
+		}
+		if(shared.retiredCount() != 0) {
+			out << "A version was not reclaimed after its last snapshot was released" << std::endl;
+			r = false;
+		}
+
+		// Every version has `a == b`, and readers never see versions going back
+		constexpr apcf::int_t versions = 500;
+		std::atomic<bool> consistent = true;
+		std::vector<std::thread> readers;
+		for(unsigned i=0; i < 4; ++i) {
+			readers.emplace_back([&]() {
+				apcf::int_t last = 0;
+				while(last < versions) {
+					auto snapshot = shared.snapshot();
+					auto a = snapshot->getInt("a").value();
+					if(a != snapshot->getInt("b").value() || a < last) consistent = false;
+					last = a;
+				}
+			});
+		}
+		for(apcf::int_t i=2; i <= versions; ++i) {
+			shared.update([i](Config& cfg) { cfg.setInt("a", i); cfg.setInt("b", i); });
+		}
+		for(auto& reader : readers) reader.join();
+		if(! consistent) {
+			out << "Readers saw an inconsistent or outdated version" << std::endl;
+			r = false;
+		}
+		if(shared.retiredCount() != 0) {
+			out << "Versions were not reclaimed after every reader left" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testConcurrentConfig(std::ostream& out) {
+		constexpr unsigned threadCount = 4;
+		constexpr apcf::int_t entriesPerThread = 2000;
+		apcf::ConcurrentConfig ccfg(Config::parse("shared.a = 0"), 16);
+		bool r = true;
+
+		if(ccfg.shardCount() != 16 || ccfg.getInt("shared.a") != 0) {
+			out << "The initial config was not distributed" << std::endl;
+			r = false;
+		}
+
+		// Every thread writes its own keys, and overwrites a shared one
+		std::vector<std::thread> writers;
+		for(unsigned t=0; t < threadCount; ++t) {
+			writers.emplace_back([&ccfg, t]() {
+				for(apcf::int_t i=0; i < entriesPerThread; ++i) {
+					std::string key = "t";
+					key.append(std::to_string(t)).append(".k").append(std::to_string(i));
+					ccfg.setInt(apcf::Key(std::move(key)), i);
+					ccfg.setInt("shared.a", i);
+				}
+			});
+		}
+		for(auto& writer : writers) writer.join();
+
+		if(! ccfg.erase("t0.k0") || ccfg.erase("t0.k0")) {
+			out << "Erasing an entry did not report it correctly" << std::endl;
+			r = false;
+		}
+		if(ccfg.entryCount() != (threadCount * entriesPerThread)) {
+			out << "Expected " << (threadCount * entriesPerThread) << " entries, found " << ccfg.entryCount() << std::endl;
+			r = false;
+		}
+
+		Config expect;
+		for(unsigned t=0; t < threadCount; ++t) {
+			for(apcf::int_t i=0; i < entriesPerThread; ++i) {
+				if(t == 0 && i == 0) continue;
+				std::string key = "t";
+				key.append(std::to_string(t)).append(".k").append(std::to_string(i));
+				expect.setInt(apcf::Key(std::move(key)), i);
+			}
+		}
+		expect.setInt("shared.a", entriesPerThread - 1);
+
+		auto frozen = ccfg.freeze();
+		if(frozen.serialize() != expect.serialize()) {
+			out << "The frozen config differs from the expected one" << std::endl;
+			r = false;
+		}
+		if(ccfg.entryCount() != 0) {
+			out << "Freezing did not empty the concurrent config" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testDiff(std::ostream& out) {
+		auto former = Config::parse(
+			"same = 1  float = 0.5  str = \"text\"  arr = [ 1 [ 2 3 ] ]\n"
+			"grp.a = 1  grp.b = \"b\"  grp.gone = true  other.a = 1" );
+		auto latter = Config::parse(
+			"same = 1  float = 0.5  str = \"texT\"  arr = [ 1 [ 2 4 ] ]\n"
+			"grp.a = 1  grp.b = \"b\"  grp.new = 2  other.a = 2" );
+		former.setFloat("nan", std::nan(""));
+		latter.setFloat("nan", std::nan(""));
+		bool r = true;
+
+		auto keysOf = [](const std::vector<const apcf::ConfigDiff::Entry*>& entries) {
+			std::vector<std::string> r;
+			for(const auto* entry : entries) r.push_back(entry->first);
+			return r;
+		};
+		auto changedKeysOf = [](const apcf::ConfigDiff& diff) {
+			std::vector<std::string> r;
+			for(const auto& entries : diff.changed) r.push_back(entries.first->first);
+			return r;
+		};
+
+		auto all = apcf::diff(former, latter);
+		if(
+			keysOf(all.added) != std::vector<std::string> { "grp.new" } ||
+			keysOf(all.removed) != std::vector<std::string> { "grp.gone" } ||
+			changedKeysOf(all) != std::vector<std::string> { "arr", "other.a", "str" }
+		) {
+			out << "Unexpected entries in the full diff" << std::endl;
+			r = false;
+		}
+		if(all.changed.empty() || all.changed.front().second->second.data.arrayValue[1].data.arrayValue[1].data.intValue != 4) {
+			out << "Changed entries do not refer to the latter config" << std::endl;
+			r = false;
+		}
+
+		auto grp = apcf::diff(former, latter, "grp");
+		if(
+			keysOf(grp.added) != std::vector<std::string> { "grp.new" } ||
+			keysOf(grp.removed) != std::vector<std::string> { "grp.gone" } ||
+			! grp.changed.empty()
+		) {
+			out << "Unexpected entries in the group diff" << std::endl;
+			r = false;
+		}
+
+		if(! apcf::diff(former, Config(former)).empty() || ! apcf::diff(latter, latter).empty()) {
+			out << "Equal configs have a non-empty diff" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testIncrementalConfig(std::ostream& out) {
+		using namespace std::string_literals;
+		std::string text =
+			"a = 1\n"
+			"g {\n  x = 1\n  y = [ 1 2 ]\n}\n"
+			"h { z = \"3\" } // comment\n"
+			"b = 4\n"
+			"g.x = 5\n";
+		apcf::IncrementalConfig inc(text);
+		bool r = true;
+
+		auto check = [&](const char* what) {
+			auto expect = Config::parse(inc.text()).serialize();
+			if(inc.config().serialize() != expect) {
+				out << what << ": the config differs from the one parsed from scratch:\n"
+					<< inc.config().serialize() << "\nexpected:\n" << expect << std::endl;
+				r = false;
+			}
+		};
+		auto offsetOf = [&](const std::string& str) { return inc.text().find(str); };
+
+		check("Initial parse");
+		if(inc.segments().size() != 5 || inc.config().getInt("g.x") != 5) {
+			out << "Expected 5 segments, found " << inc.segments().size() << std::endl;
+			r = false;
+		}
+
+		// The group is overridden by a later definition
+		size_t parsed = inc.edit(offsetOf("x = 1"), 5, "x = 7");
+		check("Overridden edit");
+		if(parsed >= inc.text().size() || inc.config().getInt("g.x") != 5) {
+			out << "Editing one group parsed " << parsed << " bytes out of " << inc.text().size() << std::endl;
+			r = false;
+		}
+
+		// Removing the later definition reveals the group's one
+		inc.edit(offsetOf("g.x = 5"), 8, "");
+		check("Removed redefinition");
+		if(inc.config().getInt("g.x") != 7) {
+			out << "The previous definition was not restored" << std::endl;
+			r = false;
+		}
+
+		inc.edit(offsetOf("y = [ 1 2 ]"), 11, "w = 0");
+		check("Replaced entry");
+		inc.edit(offsetOf("b = 4"), 0, "c { d = 1 }\n");
+		check("Inserted group");
+		inc.edit(inc.text().size(), 0, "a = 2\n");
+		check("Appended redefinition");
+		inc.edit(offsetOf("h {"), offsetOf("c {") - offsetOf("h {"), "");
+		check("Removed group");
+		inc.edit(0, 0, "// Leading comment\n");
+		check("Leading comment");
+
+		// Edits joining definitions are parsed along with their neighbours
+		inc.edit(offsetOf("}\nc {") + 1, 1, "");
+		check("Joined definitions");
+
+		// Joining a comment with the next line comments the following definitions out
+		{
+			apcf::IncrementalConfig commented("a = 1\n//x\n b = 2\n");
+			commented.edit(9, 1, "");
+			if(commented.config().get("b").has_value() || commented.config().serialize() != Config::parse(commented.text()).serialize()) {
+				out << "A definition swallowed by a line comment is still defined" << std::endl;
+				r = false;
+			}
+			apcf::IncrementalConfig blockCommented("a = \"/*\" /* x */ b = 2 /* y */ c = 3\n");
+			blockCommented.edit(blockCommented.text().find("*/"), 2, "");
+			if(blockCommented.config().get("b").has_value() || blockCommented.config().getInt("c") != 3 || blockCommented.config().getString("a") != "/*") {
+				out << "A definition within an unterminated block comment is still defined" << std::endl;
+				r = false;
+			}
+		}
+
+		// Moving a closing brace falls back to parsing the whole text
+		auto newText = inc.text();
+		auto brace = newText.find('}');
+		newText.erase(brace, 1);
+		newText.append("}\n");
+		inc.update(newText);
+		check("Moved brace");
+
+		auto beforeError = inc.config().serialize();
+		try {
+			inc.edit(offsetOf("c {"), 3, "c {{");
+			out << "Parsing an invalid edit did not throw" << std::endl;
+			r = false;
+		} catch(apcf::ConfigParsingError&) { }
+		if(inc.config().serialize() != beforeError || inc.text() != newText) {
+			out << "An invalid edit changed the config" << std::endl;
+			r = false;
+		}
+
+		auto copy = inc;
+		copy.update(copy.text() + "g.w = 1\n");
+		inc.update("");
+		if(copy.config().getInt("g.w") != 1 || inc.config().entryCount() != 0) {
+			out << "Copies are not independent" << std::endl;
+			r = false;
+		}
+
+		inc = copy;
+		copy.update("");
+		inc.update(inc.text() + "g.w = 2\n");
+		if(inc.config().getInt("g.w") != 2 || copy.config().entryCount() != 0) {
+			out << "Copy-assigned configs are not independent" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testLayeredConfig(std::ostream& out) {
+		auto defaults = std::make_shared<const Config>(Config::parse(
+			"net.port = 80  net.host = \"localhost\"  log.level = 1  log.file = \"a.log\"" ));
+		Config site = Config::parse("net.port = 8080  site.name = \"s\"");
+		apcf::LayeredConfig layered;
+		layered.pushLayer(defaults);
+		layered.borrowLayer(site);
+		layered.pushLayer(Config::parse("log.level = 3"));
+		bool r = true;
+
+		auto check = [&](const char* what) {
+			auto expect = Config(*defaults);
+			for(size_t i=1; i < layered.layerCount(); ++i) expect.merge(layered.layer(i));
+			if(layered.serialize() != expect.serialize() || layered.flatten().serialize() != expect.serialize()) {
+				out << what << ": the merged view differs from the merged configs:\n"
+					<< layered.serialize() << "\nexpected:\n" << expect.serialize() << std::endl;
+				r = false;
+			}
+			if(layered.entryCount() != expect.entryCount()) {
+				out << what << ": expected " << expect.entryCount() << " entries, counted " << layered.entryCount() << std::endl;
+				r = false;
+			}
+		};
+
+		check("Initial layers");
+		if(layered.getInt("net.port") != 8080 || layered.getInt("log.level") != 3 || layered.getString("net.host") != "localhost") {
+			out << "Keys were not resolved by their topmost layer" << std::endl;
+			r = false;
+		}
+		if(layered.get("missing").has_value()) {
+			out << "An undefined key was resolved" << std::endl;
+			r = false;
+		}
+
+		layered.enableCache();
+		layered.getInt("net.port");
+		layered.setLayer(2, Config::parse("net.port = 1  log.level = 4"));
+		check("Replaced layer");
+		if(layered.getInt("net.port") != 1 || layered.getInt("log.level") != 4) {
+			out << "A replaced layer was not resolved" << std::endl;
+			r = false;
+		}
+
+		// Borrowed layers are referred to, and can be modified in place
+		site.setInt("log.file", 2);
+		layered.invalidateCache();
+		check("Modified borrowed layer");
+		if(layered.getInt("log.file") != 2 || defaults->getString("log.file") != "a.log") {
+			out << "A borrowed layer was not referred to" << std::endl;
+			r = false;
+		}
+
+		// Copied layers are not modified along with their source
+		Config siteCopy = site;
+		layered.setLayer(1, Config(siteCopy));
+		siteCopy.setInt("log.file", 3);
+		if(layered.getInt("log.file") != 2) {
+			out << "A copied layer was modified along with its source" << std::endl;
+			r = false;
+		}
+		layered.setBorrowedLayer(1, site);
+
+		auto copy = layered;
+		copy.setLayer(0, Config());
+		if(copy.get("net.host").has_value() || ! layered.get("net.host").has_value()) {
+			out << "Copies do not have their own layers" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testSubtreeOperations(std::ostream& out) {
+		auto cfg = Config::parse(
+			"t.a { x = 1  y = [ 2 3 ]  sub.z = \"s\" }  t.a2 = 4  t.ab.x = 5  t.b.x = 6  u = 7" );
+		cfg.buildIndex();
+		auto yHandle = cfg.resolve("t.a.y");
+		const auto* yArray = cfg.get("t.a.y").value()->data.arrayValue.data();
+		std::vector<std::string> notified;
+		cfg.subscribe("t", [&](const Config&, std::span<const Key> keys) {
+			notified.assign(keys.begin(), keys.end());
+		});
+		bool r = true;
+
+		auto expect = [&](const char* what, const Config& c, const char* expected) {
+			auto expectedCfg = Config::parse(expected);
+			if(c.serialize() != expectedCfg.serialize()) {
+				out << what << ": unexpected entries:\n" << c.serialize() << "\nexpected:\n" << expectedCfg.serialize() << std::endl;
+				r = false;
+			}
+		};
+
+		auto moved = cfg.moveSubtree("t.a", "t.b");
+		expect("Move", cfg, "t.b { x = 1  y = [ 2 3 ]  sub.z = \"s\" }  t.a2 = 4  t.ab.x = 5  u = 7");
+		if(moved != 3 || cfg.get("t.a.x").has_value() || cfg.getInt("t.b.x") != 1) {
+			out << "Moved entries were not re-indexed" << std::endl;
+			r = false;
+		}
+		if(yHandle.get() != nullptr || cfg.get("t.b.y").value()->data.arrayValue.data() != yArray) {
+			out << "Moved values were copied, or handles were not resolved again" << std::endl;
+			r = false;
+		}
+		if(notified != std::vector<std::string> { "t.a.sub.z", "t.a.x", "t.a.y", "t.b.sub.z", "t.b.x", "t.b.y" }) {
+			out << "Moved keys were not notified" << std::endl;
+			r = false;
+		}
+
+		auto extracted = cfg.extractSubtree("t.b");
+		expect("Extract (remainder)", cfg, "t.a2 = 4  t.ab.x = 5  u = 7");
+		expect("Extract", extracted, "x = 1  y = [ 2 3 ]  sub.z = \"s\"");
+		if(extracted.get("y").value()->data.arrayValue.data() != yArray) {
+			out << "Extracted values were copied" << std::endl;
+			r = false;
+		}
+
+		if(cfg.eraseSubtree("t.a") != 0 || cfg.eraseSubtree("t.ab") != 1 || ! cfg.erase("t.a2") || cfg.erase("t.a2")) {
+			out << "Unexpected number of erased entries" << std::endl;
+			r = false;
+		}
+		expect("Erase", cfg, "u = 7");
+		if(cfg.get("t.a2").has_value() || cfg.get("t.ab.x").has_value()) {
+			out << "Erased entries are still indexed" << std::endl;
+			r = false;
+		}
+
+		cfg.mergeAsGroup("v", std::move(extracted));
+		cfg.moveSubtree("v", { });
+		expect("Move to the root", cfg, "x = 1  y = [ 2 3 ]  sub.z = \"s\"  u = 7");
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testBuilder(std::ostream& out) {
+		apcf::ConfigBuilder builder;
+		builder.reserve(6);
+		builder.add("b.y", apcf::RawData(apcf::int_t(1)));
+		builder.add(Key("a"), apcf::RawData(true));
+		builder.add(std::string("b.x"), apcf::RawData(apcf::string_t("s")));
+		builder.add("b.y", apcf::RawData(apcf::int_t(2)));
+		builder.add("c", apcf::RawData(1.5));
+		builder.add("b.y", apcf::RawData(apcf::int_t(3)));
+		bool r = true;
+
+		auto cfg = builder.build();
+		auto expected = Config::parse("a = true  b.x = \"s\"  b.y = 3  c = 1.5");
+		if(cfg.serialize() != expected.serialize()) {
+			out << "Unexpected entries:\n" << cfg.serialize() << "\nexpected:\n" << expected.serialize() << std::endl;
+			r = false;
+		}
+		if(builder.size() != 0 || builder.build().entryCount() != 0) {
+			out << "The builder was not left empty" << std::endl;
+			r = false;
+		}
+
+		try {
+			builder.add("invalid key", apcf::RawData(true));
+			out << "An invalid key was not validated" << std::endl;
+			r = false;
+		} catch(apcf::InvalidKey&) { }
+
+		// Trusted keys are indexed as validated ones are
+		apcf::ConfigBuilder trusted(apcf::ConfigBuilder::KeyCheck::eTrust);
+		trusted.add("g.h.i", apcf::RawData(apcf::int_t(4)));
+		auto trustedCfg = trusted.build();
+		if(trustedCfg.getInt("g.h.i") != 4 || trustedCfg.begin()->first.getDepth() != 3 || trustedCfg.getSubconfig("g").getInt("h.i") != 4) {
+			out << "A trusted key was not constructed correctly" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testFallbacks(std::ostream& out) {
+		using namespace std::string_literals;
+		auto cfg = Config::parse(
+			"hosts { default { port = 80  tls.enabled = true }  a.port = 8080  b.name = \"b\" }"
+			"profiles { common.log = 1  base.threads = 4  prod.threads = 8 }" );
+		cfg.addGroupFallback("hosts", "default");
+		cfg.addInheritance("profiles.prod", "profiles.base");
+		cfg.addInheritance("profiles.base", "profiles.common");
+		cfg.addInheritance("profiles.common", "profiles.prod");
+		bool r = true;
+
+		auto expectInt = [&](const Config& c, const char* key, std::optional<apcf::int_t> expected) {
+			auto value = c.getInt(key);
+			if(value != expected) {
+				out << key << ": expected " << (expected.has_value()? std::to_string(*expected) : "nothing"s)
+					<< ", got " << (value.has_value()? std::to_string(*value) : "nothing"s) << std::endl;
+				r = false;
+			}
+		};
+
+		expectInt(cfg, "hosts.a.port", 8080);
+		expectInt(cfg, "hosts.b.port", 80);
+		expectInt(cfg, "hosts.unknown.port", 80);
+		expectInt(cfg, "hosts.default.port", 80);
+		expectInt(cfg, "hosts.a.missing", std::nullopt);
+		expectInt(cfg, "profiles.prod.threads", 8);
+		expectInt(cfg, "profiles.prod.log", 1);
+		expectInt(cfg, "profiles.base.log", 1);
+		expectInt(cfg, "profiles.common.threads", 8);
+		if(cfg.getBool("hosts.b.tls.enabled") != true || cfg.getView("hosts.b").getInt("port") != 80) {
+			out << "Nested keys or views did not fall back" << std::endl;
+			r = false;
+		}
+
+		// Serialization only sees the defined entries
+		{
+			auto defined = Config::parse("hosts { default.tls = 1  a.tls.cert = \"x\" }");
+			auto expect = defined.serialize();
+			defined.addGroupFallback("hosts", "default");
+			auto reparsed = Config::parse(defined.serialize());
+			if(
+				defined.getInt("hosts.a.tls") != 1 || defined.getDefined("hosts.a.tls").has_value() ||
+				defined.serialize() != expect || reparsed.get("hosts.a.tls").has_value() ||
+				defined.getView("hosts").serialize() != defined.getSubconfig("hosts").serialize()
+			) {
+				out << "Fallback values were serialized:\n" << defined.serialize() << std::endl;
+				r = false;
+			}
+		}
+
+		// Values changed through a fallback are seen by subscriptions and memos
+		{
+			auto observed = Config::parse("hosts { default.port = 80  a.port = 8080  b.name = \"b\" }  other = 0");
+			observed.addGroupFallback("hosts", "default");
+			std::vector<std::vector<std::string>> received;
+			observed.subscribe("hosts.b", [&](const Config&, std::span<const Key> keys) {
+				received.emplace_back(keys.begin(), keys.end());
+			});
+			observed.subscribe("hosts.c", [&](const Config&, std::span<const Key> keys) {
+				received.emplace_back(keys.begin(), keys.end());
+			});
+			size_t builds = 0;
+			auto portOf = [&](const char* group) {
+				return *observed.memo<apcf::int_t>(group, [&](const Config& c) {
+					++ builds;
+					return c.getInt(group + ".port"s).value();
+				});
+			};
+			portOf("hosts.b");
+			portOf("hosts.a");
+			observed.setInt("hosts.default.port", 81);
+			observed.setInt("other", 1);
+			if(portOf("hosts.b") != 81 || portOf("hosts.a") != 8080 || builds != 3) {
+				out << "A memo did not see a value changed through a fallback (" << builds << " builds)" << std::endl;
+				r = false;
+			}
+			auto expectReceived = std::vector<std::vector<std::string>> { { "hosts.b.port" }, { "hosts.c.port" } };
+			if(received != expectReceived) {
+				out << "Subscriptions did not see a value changed through a fallback" << std::endl;
+				r = false;
+			}
+		}
+
+		// Adding or removing entries invalidates the table
+		auto handle = cfg.resolve("hosts.b.port");
+		cfg.setInt("hosts.default.port", 81);
+		expectInt(cfg, "hosts.b.port", 81);
+		cfg.setInt("hosts.b.port", 1);
+		if(handle.getInt() != 1) {
+			out << "A handle still refers to the fallback value" << std::endl;
+			r = false;
+		}
+		cfg.eraseSubtree("hosts.default");
+		expectInt(cfg, "hosts.a.tls.enabled", std::nullopt);
+
+		auto batch = cfg.getIntBatch(apcf::KeyBatch({ "hosts.a.port", "profiles.prod.log" }));
+		if(batch.size() != 2 || batch[0] != 8080 || batch[1] != 1) {
+			out << "Batches did not fall back" << std::endl;
+			r = false;
+		}
+
+		auto copy = cfg;
+		expectInt(copy, "profiles.prod.log", std::nullopt);
+		cfg.clearFallbacks();
+		expectInt(cfg, "profiles.prod.log", std::nullopt);
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testKeyQueries(std::ostream& out) {
+		auto cfg = Config::parse(
+			"servers { a.port = 80  a.host = \"a\"  a-b.port = 81  b.port = 82.5  b.tls.port = 443  port = 1 }"
+			"tenants { x.limits.rps = 10  x.y.limits.rps = 20  z.limits.burst = 5 }"
+			"unrelated.port = 2" );
+		bool r = true;
+
+		auto expectKeys = [&](const char* pattern, std::vector<std::string_view> expected) {
+			auto found = apcf::query(cfg, apcf::KeyPattern(pattern));
+			if(found.keys != expected) {
+				out << pattern << ": unexpected keys";
+				for(auto key : found.keys) out << ' ' << key;
+				out << std::endl;
+				r = false;
+			}
+		};
+
+		expectKeys("servers.*.port", { "servers.a-b.port", "servers.a.port", "servers.b.port" });
+		expectKeys("servers.**.port", { "servers.a-b.port", "servers.a.port", "servers.b.port", "servers.b.tls.port" });
+		expectKeys("*.port", { "servers.port", "unrelated.port" });
+		expectKeys("**.port", { "servers.a-b.port", "servers.a.port", "servers.b.port", "servers.b.tls.port", "servers.port", "unrelated.port" });
+		expectKeys("servers.*", { "servers.port" });
+		expectKeys("servers.a.**", { "servers.a.host", "servers.a.port" });
+		expectKeys("tenants.**.limits.rps", { "tenants.x.limits.rps", "tenants.x.y.limits.rps" });
+		expectKeys("servers.c.*", { });
+		expectKeys("nothing.**", { });
+
+		auto rps = apcf::queryInt(cfg, "tenants.**.limits.rps");
+		if(
+			rps.captureCount != 1 || rps.values != std::vector<apcf::int_t> { 10, 20 } ||
+			rps.capturesOf(0)[0] != "x" || rps.capturesOf(1)[0] != "x.y"
+		) {
+			out << "Unexpected typed values or captures" << std::endl;
+			r = false;
+		}
+
+		auto ports = apcf::queryFloat(cfg, "servers.*.port");
+		if(ports.values != std::vector<apcf::float_t> { 81.0, 80.0, 82.5 } || ports.capturesOf(2)[0] != "b") {
+			out << "Unexpected converted values" << std::endl;
+			r = false;
+		}
+
+		try {
+			apcf::queryInt(cfg, "servers.a.*");
+			out << "A string value was converted to an integer" << std::endl;
+			r = false;
+		} catch(apcf::InvalidValue&) { }
+
+		for(auto invalid : { "", "a..b", "a.b c", "a.***", "a*" }) {
+			try {
+				apcf::KeyPattern pattern(invalid);
+				out << "The invalid pattern \"" << invalid << "\" was accepted" << std::endl;
+				r = false;
+			} catch(apcf::InvalidKey&) { }
+		}
+
+		std::vector<std::string_view> captures;
+		if(
+			! apcf::KeyPattern("a.**.c.*").matches("a.b.b.c.d", &captures) || captures != std::vector<std::string_view> { "b.b", "d" } ||
+			apcf::KeyPattern("a.**").matches("a") || apcf::KeyPattern("*.b").matches("a.b.b")
+		) {
+			out << "Unexpected matches" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testLookupHandles(std::ostream& out) {
+		auto cfg = Config::parse("a.x = 1  a.y = 2  b = \"s\"");
+		auto x = cfg.resolve("a.x");
+		auto z = cfg.resolve("a.z");
+		bool r = true;
+
+		if(x.getInt() != 1 || z.get() != nullptr || z.getInt().has_value()) {
+			out << "Handles were not resolved" << std::endl;
+			r = false;
+		}
+
+		cfg.setInt("a.x", 3);
+		if(x.getInt() != 3) {
+			out << "A handle did not follow an assigned value" << std::endl;
+			r = false;
+		}
+
+		cfg.setInt("a.z", 4);
+		cfg.setInt("a.w", 5);
+		if(z.getInt() != 4 || x.getInt() != 3) {
+			out << "Handles were not resolved again after an insertion" << std::endl;
+			r = false;
+		}
+
+		try {
+			cfg.resolve("b").getInt();
+			out << "A string value was read as an int" << std::endl;
+			r = false;
+		} catch(apcf::InvalidValue&) { }
+
+		// Replacing every entry must not leave handles pointing to the old ones
+		Config other;
+		auto otherX = other.resolve("a.x");
+		other.merge(Config(cfg));
+		if(otherX.getInt() != 3) {
+			out << "A handle did not follow a merge into an empty config" << std::endl;
+			r = false;
+		}
+		other = Config::parse("a.x = 6");
+		if(otherX.getInt() != 6) {
+			out << "A handle did not follow an assignment" << std::endl;
+			r = false;
+		}
+		auto moved = std::move(other);
+		if(otherX.get() != nullptr || moved.resolve("a.x").getInt() != 6) {
+			out << "A handle did not follow a move" << std::endl;
+			r = false;
+		}
+
+		// Moving the nodes into another storage must invalidate the handles as well
+		auto movedX = moved.resolve("a.x");
+		apcf::FlatConfig flat(std::move(moved));
+		if(movedX.get() != nullptr || movedX.getIntPtr() != nullptr || flat.getInt("a.x") != 6) {
+			out << "A handle did not follow a move into a FlatConfig" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testSubscriptions(std::ostream& out) {
+		auto cfg = Config::parse("a.x = 1  a.y = 2  ab = 3  b.c = 4");
+		std::map<std::string, std::vector<std::string>> received;
+		std::map<std::string, size_t> calls;
+		auto subscribe = [&](const char* prefix) {
+			return cfg.subscribe(Key(prefix), [&, prefix](const Config&, std::span<const Key> keys) {
+				++ calls[prefix];
+				for(const auto& key : keys) received[prefix].push_back(key);
+			});
+		};
+		subscribe("");
+		subscribe("a");
+		auto bcId = subscribe("b.c");
+		bool r = true;
+
+		auto expect = [&](const char* what, std::map<std::string, std::vector<std::string>> expected) {
+			for(const auto& call : calls) {
+				if(call.second != 1) {
+					out << what << ": \"" << call.first << "\" was notified " << call.second << " times" << std::endl;
+					r = false;
+				}
+			}
+			if(received != expected) {
+				out << what << ": unexpected notifications:\n";
+				for(const auto& rcv : received) {
+					out << "  \"" << rcv.first << "\":";
+					for(const auto& key : rcv.second) out << ' ' << key;
+					out << '\n';
+				}
+				out.flush();
+				r = false;
+			}
+			received.clear();
+			calls.clear();
+		};
+
+		cfg.setInt("a.x", 5);
+		expect("Set", { { "", { "a.x" } }, { "a", { "a.x" } } });
+		cfg.setInt("a.x", 5);
+		cfg.setInt("ab", 3);
+		expect("Set (unchanged)", { });
+		cfg.setInt("ab", 6);
+		expect("Set (adjacent key)", { { "", { "ab" } } });
+
+		cfg.merge(Config::parse("a.y = 2  a.z = 7  b.c = 8  b.d = 9"));
+		expect("Merge", {
+			{ "", { "a.z", "b.c", "b.d" } },
+			{ "a", { "a.z" } },
+			{ "b.c", { "b.c" } } });
+		cfg.mergeAsGroup("a", Config::parse("z = 7  w = 0"));
+		expect("Merge as group", { { "", { "a.w" } }, { "a", { "a.w" } } });
+
+		// Reloading replaces every entry, and reports the removed ones
+		cfg = Config::parse("a.x = 5  b.c = 8");
+		expect("Reload", {
+			{ "", { "a.w", "a.y", "a.z", "ab", "b.d" } },
+			{ "a", { "a.w", "a.y", "a.z" } } });
+
+		cfg.unsubscribe(bcId);
+		auto copy = cfg;
+		copy.setInt("b.c", 1);
+		cfg.setInt("b.c", 2);
+		expect("Unsubscribe", { { "", { "b.c" } } });
+		if(cfg.subscriptionCount() != 2 || copy.subscriptionCount() != 0) {
+			out << "Subscriptions were copied along with the entries" << std::endl;
+			r = false;
+		}
+
+		// Move construction empties the moved-from Config without notifying it
+		auto movedTo = std::move(cfg);
+		expect("Move construction", { });
+		if(cfg.entryCount() != 0 || movedTo.getInt("b.c") != 2 || movedTo.subscriptionCount() != 0) {
+			out << "Move construction did not move the entries alone" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	utest::ResultType testMemos(std::ostream& out) {
+		using namespace std::string_literals;
+		auto cfg = Config::parse("tenant.a { port = 1  host = \"a\" }  tenant.b { port = 2  host = \"b\" }");
+		std::map<std::string, size_t> builds;
+		auto portOf = [&](const char* tenant) {
+			auto prefix = "tenant."s + tenant;
+			return *cfg.memo<apcf::int_t>(prefix, [&](const Config& cfg) {
+				++ builds[tenant];
+				return cfg.getInt(prefix + ".port").value();
+			});
+		};
+		bool r = true;
+
+		auto expect = [&](const char* what, apcf::int_t a, apcf::int_t b, std::map<std::string, size_t> expectBuilds) {
+			if(portOf("a") != a || portOf("b") != b) {
+				out << what << ": a memoized value is outdated" << std::endl;
+				r = false;
+			}
+			if(builds != expectBuilds) {
+				out << what << ": built a " << builds["a"] << " times, b " << builds["b"] << " times" << std::endl;
+				r = false;
+			}
+			builds.clear();
+		};
+
+		expect("First build", 1, 2, { { "a", 1 }, { "b", 1 } });
+		expect("Unchanged", 1, 2, { });
+
+		auto generation = cfg.generation("tenant.b");
+		cfg.setString("tenant.b.host", "b");
+		cfg.setInt("tenant.a.port", 3);
+		expect("Set", 3, 2, { { "a", 1 } });
+		if(cfg.generation("tenant.b") != generation || cfg.generation("tenant.a") != cfg.generation()) {
+			out << "Subtree generations were not updated" << std::endl;
+			r = false;
+		}
+
+		cfg.merge(Config::parse("tenant.b.port = 4  tenant.c.port = 5"));
+		expect("Merge", 3, 4, { { "b", 1 } });
+
+		cfg = Config::parse("tenant.a { port = 3  host = \"a\" }  tenant.b.port = 6");
+		expect("Reload", 3, 6, { { "b", 1 } });
+
+		cfg.dropMemos();
+		expect("Dropped memos", 3, 6, { { "a", 1 }, { "b", 1 } });
+
+		// Moving the entries out invalidates the subtrees of the moved-from Config
+		auto beforeMove = cfg.generation("tenant.a");
+		auto movedTo = std::move(cfg);
+		if(cfg.generation("tenant.a") == beforeMove || movedTo.getInt("tenant.a.port") != 3) {
+			out << "Moving the entries out did not invalidate the subtrees" << std::endl;
+			r = false;
+		}
+
+		// Incremental edits are tracked as well
+		apcf::IncrementalConfig inc("tenant.a.port = 1\ntenant.b.port = 2\n");
+		auto incBuilds = 0;
+		auto incPortOf = [&](const char* prefix) {
+			return *inc.config().memo<apcf::int_t>(prefix, [&](const Config& cfg) {
+				++ incBuilds;
+				return cfg.getInt(prefix + ".port"s).value();
+			});
+		};
+		incPortOf("tenant.a");
+		incPortOf("tenant.b");
+		inc.update("tenant.a.port = 1\ntenant.b.port = 7\n");
+		if(incPortOf("tenant.a") != 1 || incPortOf("tenant.b") != 7 || incBuilds != 3) {
+			out << "Incremental edits were not tracked (" << incBuilds << " builds)" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+
+
+	#ifdef __linux__
+	utest::ResultType testConfigWatcher(std::ostream& out) {
+		using namespace std::string_literals;
+		using namespace std::chrono_literals;
+		const auto path = tmpFileBase + ".test_watch.cfg"s;
+		const auto tmpPath = tmpFileBase + ".test_watch.cfg.tmp"s;
+		struct RemoveOnExit {
+			std::string path;
+			~RemoveOnExit() { std::error_code ec; std::filesystem::remove(path, ec); }
+		} removePath = { path }, removeTmpPath = { tmpPath };
+		std::ofstream(path) << "a = 1  b = 2  c = 3";
+
+		apcf::ConfigWatcher watcher(20ms);
+		try {
+			watcher.watch(path);
+		} catch(std::system_error& err) {
+			out << "Could not watch `" << path << "`: " << err.what() << std::endl;
+			return eFailure;
+		}
+		std::vector<apcf::ConfigChanges> received;
+		watcher.onChange([&](const std::string&, const Config&, const apcf::ConfigChanges& changes) {
+			received.push_back(changes);
+		});
+		bool r = true;
+
+		// A burst of writes is reloaded once
+		std::ofstream(path) << "a = 1  b = 4  d = 5";
+		std::ofstream(path) << "a = 1  b = 5  d = 4";
+		auto reloaded = watcher.poll(1000ms);
+		if(reloaded != 1 || received.size() != 1) {
+			out << "Expected 1 reload, got " << reloaded << " with " << received.size() << " callback(s)" << std::endl;
+			return eFailure;
+		}
+		const auto& changes = received.front();
+		if(
+			changes.added != std::vector<apcf::Key> { "d" } ||
+			changes.removed != std::vector<apcf::Key> { "c" } ||
+			changes.changed != std::vector<apcf::Key> { "b" }
+		) {
+			out << "The reported changes do not match the written entries" << std::endl;
+			r = false;
+		}
+		if(watcher.config(path).getInt("b") != 5) {
+			out << "The last written version was not loaded" << std::endl;
+			r = false;
+		}
+
+		// Files replaced by a rename are detected, unchanged ones do not invoke callbacks
+		std::ofstream(tmpPath) << "b = 5  a = 1  d = 4";
+		std::filesystem::rename(tmpPath, path);
+		if(watcher.poll(1000ms) != 0 || received.size() != 1) {
+			out << "Rewriting the same entries was reported as a change" << std::endl;
+			r = false;
+		}
+		if(watcher.poll(0ms) != 0) {
+			out << "A change was reported without any write" << std::endl;
+			r = false;
+		}
+
+		// Unparsable versions are not loaded
+		std::ofstream(path) << "a = [";
+		try {
+			watcher.poll(1000ms);
+			out << "Parsing an invalid file did not throw" << std::endl;
+			r = false;
+		} catch(apcf::ConfigParsingError&) { }
+		if(watcher.config(path).getInt("a") != 1) {
+			out << "An invalid version replaced the last valid one" << std::endl;
+			r = false;
+		}
+
+		// Files that keep being written are still reloaded after the maximum debounce time
+		std::ofstream(path) << "a = 0";
+		apcf::ConfigWatcher cappedWatcher(50ms, 100ms);
+		cappedWatcher.watch(path);
+		std::atomic_bool writing = true;
+		auto writer = std::thread([&]() {
+			for(int i = 0; writing && i < 200; ++i) {
+				std::ofstream(path) << "a = " << i;
+				std::this_thread::sleep_for(5ms);
+			}
+		});
+		auto pollBegin = std::chrono::steady_clock::now();
+		try {
+			cappedWatcher.poll(1000ms);
+		} catch(apcf::ConfigParsingError&) {
+			// The file may be read while it is being written
+		}
+		auto pollTime = std::chrono::steady_clock::now() - pollBegin;
+		writing = false;
+		writer.join();
+		if(pollTime > 600ms) {
+			out << "Polling a continuously written file took " << std::chrono::duration_cast<std::chrono::milliseconds>(pollTime).count() << "ms" << std::endl;
+			r = false;
+		}
+		return r? eSuccess : eFailure;
+	}
+	#endif
+
+
+	struct BoundEndpoint {
+		apcf::string_t host;
+		apcf::int_t port;
+	};
+
+	struct BoundServer {
+		BoundEndpoint endpoint;
+		apcf::float_t timeout;
+		bool verbose;
+		apcf::array_t tags;
+		apcf::int_t workers;
+	};
+
+}
+
+
+
+template<> struct apcf::Binding<BoundEndpoint> {
+	static constexpr auto fields = std::make_tuple(
+		apcf::field<&BoundEndpoint::host>("host"),
+		apcf::field<&BoundEndpoint::port>("port") );
+};
+
+template<> struct apcf::Binding<BoundServer> {
+	static constexpr auto fields = std::make_tuple(
+		apcf::field<&BoundServer::endpoint>("server.endpoint"),
+		apcf::field<&BoundServer::timeout>("timeout"),
+		apcf::field<&BoundServer::verbose>("verbose"),
+		apcf::field<&BoundServer::tags>("tags"),
+		apcf::field<&BoundServer::workers>("workers") );
+};
+
+
+
+namespace {
+
+	utest::ResultType testBinding(std::ostream& out) {
+		BoundServer server = { };
+		server.workers = 4;
+		auto report = apcf::bindParse(server,
+			"server.endpoint { host = \"localhost\" port = 80 } "
+			"timeout = 3 verbose = true tags = [ \"a\" 2 ] unknown.key = 0 "
+			"server.endpoint.port = 8080" );
+		bool r = true;
+
+		if(server.endpoint.host != "localhost" || server.endpoint.port != 8080) {
+			out << "Unexpected endpoint `" << server.endpoint.host << ':' << server.endpoint.port << '`' << std::endl;
+			r = false;
+		}
+		if(server.timeout != 3.0 || ! server.verbose || server.tags.size() != 2) {
+			out << "Unexpected top level values" << std::endl;
+			r = false;
+		}
+		if(server.workers != 4) {
+			out << "A missing key overwrote its member" << std::endl;
+			r = false;
+		}
+
+		if(report.unknownKeys != std::vector<Key> { "unknown.key" }) {
+			out << "Unexpected unknown keys:";
+			for(const auto& key : report.unknownKeys) out << " `" << key << '`';
+			out << std::endl;
+			r = false;
+		}
+		if(report.missingKeys != std::vector<Key> { "workers" }) {
+			out << "Unexpected missing keys:";
+			for(const auto& key : report.missingKeys) out << " `" << key << '`';
+			out << std::endl;
+			r = false;
+		}
+
+		try {
+			apcf::bindParse(server, "server.endpoint.port = \"http\"");
+			out << "Binding a string to an integer did not throw" << std::endl;
+			r = false;
+		} catch(apcf::InvalidValue&) { }
+		return r? eSuccess : eFailure;
+	}
+
 }
 
 
@@ -506,15 +2073,44 @@ int main(int, char**) {
 		.RUN_("Getter and setter (float)", testSetGetFloat)
 		.RUN_("Getter and setter (string)", testSetGetString)
 		.RUN_("Getter and setter (array)", testSetGetArray)
+		.RUN_("Non-allocating getters", testGetNoAlloc)
 		.RUN_("Valid keys", testValidKeys)
 		.RUN_("Invalid keys", testInvalidKeys)
+		.RUN_("Key segments", testKeySegments)
 		.RUN_("Config merge (copy)", testMerge<false>)
 		.RUN_("Config merge (move)", testMerge<true>)
+		.RUN_("Config merge (interleaved, copy)", testMergeInterleaved<false>)
+		.RUN_("Config merge (interleaved, move)", testMergeInterleaved<true>)
 		.RUN_("Get subkeys", testGetSubkeys)
+		.RUN_("Hierarchy", testHierarchy)
 		.RUN_("Subconfig (no match)", testSubconfigNoMatch)
 		.RUN_("Subconfig", testSubconfig)
+		.RUN_("Subconfig (adjacent keys)", testSubconfigAdjacentKeys)
+		.RUN_("Config view", testConfigView)
 		.RUN_("Merge as group", testMergeAsGroup<false>)
 		.RUN_("Merge as group (existing)", testMergeAsGroup<true>)
+		.RUN_("Hash index", testIndex)
+		.RUN_("Batch lookup", testBatchLookup<false>)
+		.RUN_("Batch lookup (indexed)", testBatchLookup<true>)
+		.RUN_("Flat config", testFlatConfig)
+		.RUN_("Trie config", testTrieConfig)
+		.RUN_("Struct binding", testBinding)
+		.RUN_("Persistent config", testPersistentConfig)
+		.RUN_("Shared config", testSharedConfig)
+		.RUN_("Concurrent config", testConcurrentConfig)
+		.RUN_("Config diff", testDiff)
+		.RUN_("Incremental re-parse", testIncrementalConfig)
+		.RUN_("Layered config", testLayeredConfig)
+		.RUN_("Subtree operations", testSubtreeOperations)
+		.RUN_("Config builder", testBuilder)
+		.RUN_("Fallbacks", testFallbacks)
+		.RUN_("Key queries", testKeyQueries)
+		.RUN_("Lookup handles", testLookupHandles)
+		.RUN_("Subscriptions", testSubscriptions)
+		.RUN_("Memoized values", testMemos)
+		#ifdef __linux__
+		.RUN_("Config watcher", testConfigWatcher)
+		#endif
 		.RUN_("[parse] Single line comment, then EOL", testReadOnelineCommentEol)
 		.RUN_("[parse] Single line comment, then EOF", testReadOnelineCommentEof)
 		.RUN_("[parse] Single line empty comment", testReadOnelineCommentEmpty)
@@ -530,6 +2126,7 @@ int main(int, char**) {
 		.RUN_("[parse] Groups", testGroups)
 		.RUN_("[parse] Unclosed group", testUnclosedGroup)
 		.RUN_("[parse] Unmatched group closure", testUnmatchedGroupClosure)
+		.RUN_("[parse] Redefinition (last wins)", testRedefinition)
 		.RUN_("[serial] Simple serialization (float NaN, infinity)", testSerialNan)
 		.RUN_("[file] Write to file", testFileWrite)
 		.RUN_("[file] Read from file", testFileRead);